@@ -34,20 +34,36 @@ int main (int argc, char **argv)
         if (args.help)
             return 0;
 
+        // Get the compression options
+        compression_options opts;
+        opts.codec = spoc::compression::get_codec (args.codec);
+        if (!args.float_codec.empty ())
+            opts.float_codec = spoc::compression::get_codec (args.float_codec);
+        opts.level = args.level;
+        opts.float_filter = spoc::filters::get_filter (args.float_filter);
+        opts.integer_filter = spoc::filters::get_filter (args.integer_filter);
+        spoc::compression::check_available (opts.codec);
+        spoc::compression::check_available (opts.float_codec.value_or (opts.codec));
+        check_compression_options (opts);
+
         // Get the input stream
         input_stream is (args.verbose, args.input_fn);
 
-        // Read the input file
-        spoc_file f = read_spoc_file_uncompressed (is ());
+        // Read the header
+        const auto h = spoc::header::read_header (is ());
+        if (h.compressed)
+            throw runtime_error ("Uncompressed reader can't read a compressed file");
 
         // Get the output stream
         output_stream os (args.verbose, args.output_fn);
 
-        // Set the compression bit
-        f.set_compressed (true);
-
-        // Write it out
-        write_spoc_file_compressed (os (), f);
+        // Compress one block at a time, so that the input can be
+        // larger than memory
+        compressed_writer w (os (), h.wkt, h.extra_fields, opts);
+        point_record_reader r (is (), h);
+        for (auto pc = r.read_columns (opts.block_size); !pc.empty (); pc = r.read_columns (opts.block_size))
+            w.write (pc);
+        w.close ();
 
         return 0;
     }
@@ -15,6 +15,11 @@ struct args
     bool help = false;
     bool verbose = false;
     bool version = false;
+    std::string codec = "zlib";
+    std::string float_codec;
+    int level = -1;
+    std::string float_filter = "none";
+    std::string integer_filter = "none";
     std::string input_fn;
     std::string output_fn;
 };
@@ -29,10 +34,15 @@ inline args get_args (int argc, char **argv, const std::string &usage)
             {"help", no_argument, 0, 'h'},
             {"verbose", no_argument, 0, 'v'},
             {"version", no_argument, 0, 'e'},
+            {"codec", required_argument, 0, 'c'},
+            {"float-codec", required_argument, 0, 'x'},
+            {"level", required_argument, 0, 'l'},
+            {"float-filter", required_argument, 0, 'f'},
+            {"integer-filter", required_argument, 0, 'i'},
             {0, 0, 0, 0}
         };
 
-        int c = getopt_long(argc, argv, "hve", long_options, &option_index);
+        int c = getopt_long(argc, argv, "hvec:x:l:f:i:", long_options, &option_index);
         if (c == -1)
             break;
 
@@ -50,6 +60,11 @@ inline args get_args (int argc, char **argv, const std::string &usage)
             }
             case 'v': { args.verbose = true; break; }
             case 'e': { args.version = true; break; }
+            case 'c': { args.codec = std::string (optarg); break; }
+            case 'x': { args.float_codec = std::string (optarg); break; }
+            case 'l': { args.level = std::atoi (optarg); break; }
+            case 'f': { args.float_filter = std::string (optarg); break; }
+            case 'i': { args.integer_filter = std::string (optarg); break; }
         }
     }
 
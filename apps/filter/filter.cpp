@@ -57,8 +57,9 @@ int main (int argc, char **argv)
         // Get the input stream
         input_stream is (args.verbose, args.input_fn);
 
-        // Read the input file
-        spoc_file f = read_spoc_file (is ());
+        // Read the input file, skipping blocks whose points would all
+        // be removed
+        spoc_file f = read_spoc_file_if (is (), get_block_predicate (args));
 
         // Process it
         if (!args.keep_classes.empty ())
@@ -104,43 +104,25 @@ inline T subsample_file (const T &f, const double res, const size_t random_seed)
     return g;
 }
 
-// Filter based on coordinates less than or greater than some threshold
-template<typename T>
-inline T remove_coords (const T &f, const std::string &op)
+// A parsed 'remove-coords' option
+struct coords_op
 {
-    // Get an empty clone of the spoc file
-    T g = f.clone_empty ();
+    char coord;
+    char comparison;
+    double value;
+};
 
+inline coords_op parse_coords_op (const std::string &op)
+{
     auto ops = detail::split(op, " ");
 
     if (ops.size() != 3)
         throw std::runtime_error("Did not find correct number of arguments for remove-coords option");
 
-    // Generic value access function
-    std::function<double(const spoc::point_record::point_record &p)> value;
-    if (ops[0] == "x")
-        value = [](const spoc::point_record::point_record &p) { return p.x; };
-    else if (ops[0] == "y")
-        value = [](const spoc::point_record::point_record &p) { return p.y; };
-    else if (ops[0] == "z")
-        value = [](const spoc::point_record::point_record &p) { return p.z; };
-    else
+    if (ops[0] != "x" && ops[0] != "y" && ops[0] != "z")
         throw std::runtime_error("An invalid coordinate value was given");
 
-    std::function<double(const double v1, const double v2)> compare;
-    if (ops[1] == ">")
-    {
-        compare = [](const double v1, const double v2) {
-            return v1 > v2;
-        };
-    }
-    else if (ops[1] == "<")
-    {
-        compare = [](const double v1, const double v2) {
-            return v1 < v2;
-        };
-    }
-    else
+    if (ops[1] != ">" && ops[1] != "<")
         throw std::runtime_error("An invalid comparison operator was given");
 
     double compare_value = std::numeric_limits<double>::quiet_NaN();
@@ -155,6 +137,70 @@ inline T remove_coords (const T &f, const std::string &op)
         throw std::runtime_error(err_str);
     }
 
+    return coords_op {ops[0][0], ops[1][0], compare_value};
+}
+
+// Check if 'remove_coords()' could keep any of the points in a block
+inline bool may_keep_coords (const spoc::stats::block_stats &s, const std::string &op)
+{
+    const auto o = parse_coords_op (op);
+    const double lo = o.coord == 'x' ? s.e.minp.x : (o.coord == 'y' ? s.e.minp.y : s.e.minp.z);
+    const double hi = o.coord == 'x' ? s.e.maxp.x : (o.coord == 'y' ? s.e.maxp.y : s.e.maxp.z);
+
+    // If every point passes the comparison, they are all removed
+    if (o.comparison == '>')
+        return !(lo > o.value);
+    else
+        return !(hi < o.value);
+}
+
+// Get a predicate that returns false for blocks whose points the
+// filters would remove. Options that select points based on their
+// neighbors can't skip blocks, so they are only considered when they
+// are applied before those options.
+template<typename T>
+inline auto get_block_predicate (const T &args)
+{
+    return [&args](const spoc::stats::block_stats &s)
+    {
+        if (!args.keep_classes.empty ()
+            && !spoc::stats::may_contain_any_class (s, args.keep_classes))
+            return false;
+        if (!args.remove_classes.empty ()
+            && spoc::stats::contains_only_classes (s, args.remove_classes))
+            return false;
+        if (!args.remove_coords.empty ()
+            && !args.unique_xyz && args.subsample <= 0.0
+            && !may_keep_coords (s, args.remove_coords))
+            return false;
+        return true;
+    };
+}
+
+// Filter based on coordinates less than or greater than some threshold
+template<typename T>
+inline T remove_coords (const T &f, const std::string &op)
+{
+    // Get an empty clone of the spoc file
+    T g = f.clone_empty ();
+
+    const auto o = parse_coords_op (op);
+
+    // Generic value access function
+    std::function<double(const spoc::point_record::point_record &p)> value;
+    switch (o.coord)
+    {
+        case 'x': value = [](const spoc::point_record::point_record &p) { return p.x; }; break;
+        case 'y': value = [](const spoc::point_record::point_record &p) { return p.y; }; break;
+        case 'z': value = [](const spoc::point_record::point_record &p) { return p.z; }; break;
+    }
+
+    std::function<double(const double v1, const double v2)> compare;
+    switch (o.comparison)
+    {
+        case '>': compare = [](const double v1, const double v2) { return v1 > v2; }; break;
+        case '<': compare = [](const double v1, const double v2) { return v1 < v2; }; break;
+    }
     // Get a reference to the records
     const auto &prs = f.get_point_records ();
 
@@ -162,7 +208,7 @@ inline T remove_coords (const T &f, const std::string &op)
     for (const auto &p : prs)
         // Keep points that fail the comparison, i.e. remove points that pass
         // the comparison
-        if (!compare(value(p), compare_value))
+        if (!compare(value(p), o.value))
             g.push_back (p);
 
     return g;
@@ -48,18 +48,29 @@ int main (int argc, char **argv)
             clog << "filenames\t" << args.fns.size () << endl;
         }
 
+        // Only read the fields that are needed
+        spoc::columns::field_mask m;
+        if (args.summary_info)
+            m = spoc::columns::field_mask::all ();
+        if (args.classification_info)
+            m.set ("c");
+        if (args.metric_info)
+            m.set ("x").set ("y").set ("z");
+
         if (args.fns.empty ())
         {
             if (args.verbose)
                 clog << "Reading from stdin" << endl;
 
             // Read the file
-            spoc_file f = read_spoc_file (cin);
+            const auto h = spoc::header::read_header (cin);
+            const auto pc = read_point_columns (cin, h, m);
+            const spoc_file f (h.wkt, h.compressed, spoc::columns::to_point_records (pc));
 
             process (cout, f,
                 args.json, args.header_info, args.summary_info,
                 args.classification_info, args.metric_info,
-                args.compact, args.quartiles);
+                args.compact, args.quartiles, h.e);
         }
         else
         {
@@ -74,12 +85,14 @@ int main (int argc, char **argv)
                     throw runtime_error ("Could not open file for reading");
 
                 // Read into spoc_file struct
-                spoc_file f = read_spoc_file (ifs);
+                const auto h = spoc::header::read_header (ifs);
+                const auto pc = read_point_columns (ifs, h, m);
+                const spoc_file f (h.wkt, h.compressed, spoc::columns::to_point_records (pc));
 
                 process (cout, f,
                     args.json, args.header_info, args.summary_info,
                     args.classification_info, args.metric_info,
-                    args.compact, args.quartiles);
+                    args.compact, args.quartiles, h.e);
             }
         }
 
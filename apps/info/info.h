@@ -3,6 +3,7 @@
 #include "spoc/spoc.h"
 #include <iostream>
 #include <map>
+#include <optional>
 #include <sstream>
 #include <unordered_map>
 
@@ -37,11 +38,12 @@ inline std::map<std::string,size_t> get_class_count_map (const T &c)
 }
 
 template<typename T>
-inline std::map<std::string,double> get_metric_values (const T &p)
+inline std::map<std::string,double> get_metric_values (const T &p,
+    const std::optional<spoc::extent::extent> &known_extent = std::nullopt)
 {
     using namespace spoc::extent;
     using namespace spoc::voxel;
-    const auto e = get_extent (p);
+    const auto e = known_extent ? *known_extent : get_extent (p);
     // Get the area
     const auto area = (e.maxp.x - e.minp.x) * (e.maxp.y - e.minp.y);
     const double resolution = 1.0;
@@ -211,7 +213,8 @@ inline void process (std::ostream &os,
     const bool classification_info,
     const bool metric_info,
     const bool compact,
-    const bool quartiles)
+    const bool quartiles,
+    const std::optional<spoc::extent::extent> &e = std::nullopt)
 {
     using namespace std;
     using namespace spoc;
@@ -269,7 +272,7 @@ inline void process (std::ostream &os,
 
         if (metric_info)
         {
-            const auto metric_value_map = get_metric_values (f.get_point_records ());
+            const auto metric_value_map = get_metric_values (f.get_point_records (), e);
 
             json::object c;
 
@@ -338,7 +341,7 @@ inline void process (std::ostream &os,
 
         if (metric_info)
         {
-            const auto metric_value_map = get_metric_values (f.get_point_records ());
+            const auto metric_value_map = get_metric_values (f.get_point_records (), e);
             const auto metric_units_map = get_metric_units ();
 
             for (auto i : metric_value_map)
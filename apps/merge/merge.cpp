@@ -2,14 +2,15 @@
 #include "spoc/spoc.h"
 #include "merge.h"
 #include "merge_cmd.h"
+#include <fstream>
 #include <iostream>
+#include <memory>
 #include <stdexcept>
+#include <vector>
 
 int main (int argc, char **argv)
 {
     using namespace std;
-    using namespace spoc::extent;
-    using namespace spoc::file;
     using namespace spoc::io;
     using namespace spoc::merge_app;
     using namespace spoc::merge_cmd;
@@ -41,6 +42,10 @@ int main (int argc, char **argv)
             clog << "verbose\t" << args.verbose << endl;
             clog << "quiet\t" << args.quiet << endl;
             clog << "point-id\t" << args.point_id << endl;
+            clog << "codec\t" << args.codec << endl;
+            clog << "level\t" << args.level << endl;
+            clog << "jobs\t" << args.jobs << endl;
+            clog << "drop-halo\t" << args.drop_halo << endl;
             clog << "filenames\t" << args.fns.size () << endl;
         }
 
@@ -48,92 +53,30 @@ int main (int argc, char **argv)
         if (args.fns.size () < 2)
             throw runtime_error ("At least two input files are required to merge");
 
-        // The result goes here
-        spoc_file g;
+        // Get the compression options
+        compression_options opts;
+        opts.codec = spoc::compression::get_codec (args.codec);
+        opts.level = args.level;
+        spoc::compression::check_available (opts.codec);
 
-        // Set the compression bit
-        //
-        // Assume that all of the inputs are compressed
-        g.set_compressed (true);
-
-        double area_sum = 0.0;
-
-        for (size_t i = 0; i < args.fns.size (); ++i)
+        // Open the inputs
+        vector<unique_ptr<ifstream>> ifs;
+        vector<istream *> is;
+        for (const auto &fn : args.fns)
         {
-            // Get the filename
-            const auto fn = args.fns[i];
-
-            // Read it in
             if (args.verbose)
-                clog << "Reading " << fn << endl;
-
-            ifstream ifs (fn);
-
-            if (!ifs)
+                clog << "Opening " << fn << endl;
+            ifs.push_back (make_unique<ifstream> (fn, ios::binary));
+            if (!*ifs.back ())
                 throw runtime_error ("Could not open file for reading");
-
-            // Read into spoc_file struct
-            spoc_file f = read_spoc_file (ifs);
-
-            // Set the compression bit
-            //
-            // If any of the inputs are uncompressed, the output will be
-            // uncompressed. Otherwise, if all inputs are compressed,
-            // the output will be compressed.
-            if (f.get_compressed () == false)
-                g.set_compressed (false);
-
-            // Set the wkt to the first file's wkt
-            if (i == 0)
-                g.set_wkt (f.get_wkt ());
-
-            // Get the xyz's
-            const auto p = f.get_point_records ();
-
-            // Get the extent
-            const auto e = get_extent (p);
-
-            // Get the area
-            const auto a = (e.maxp.x - e.minp.x) * (e.maxp.y - e.minp.y);
-
-            // Sum areas
-            area_sum += a;
-
-            // Get the point ID
-            const auto id = args.point_id < 0 ? i : args.point_id;
-
-            // Add it to the result
-            append (f, g, id, args.quiet);
-        }
-
-        // Check the area ratios
-        if (!args.quiet)
-        {
-            // Get the points
-            const auto p = g.get_point_records ();
-
-            // Get the extent
-            const auto e = get_extent (p);
-
-            // Get the area
-            const auto a = (e.maxp.x - e.minp.x) * (e.maxp.y - e.minp.y);
-
-            // What is the ratio of the total final area to the sum
-            // of the areas of each individual file?
-            const double r = a / area_sum;
-
-            // If the area grew by too much, give a warning
-            if (r > 100)
-                clog
-                    << "WARNING: 99% of the final merged area does not contain any points"
-                    << endl;
+            is.push_back (ifs.back ().get ());
         }
 
         if (args.verbose)
             clog << "Writing to stdout" << endl;
 
-        // Write it out
-        write_spoc_file (cout, g);
+        // Merge them, one chunk at a time
+        merge (is, cout, args.point_id, opts, args.jobs, args.drop_halo, args.quiet);
 
         return 0;
     }
@@ -1,8 +1,13 @@
 #pragma once
 
 #include "spoc/spoc.h"
+#include <algorithm>
 #include <cassert>
+#include <future>
 #include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <vector>
 
 namespace spoc
 {
@@ -10,28 +15,246 @@ namespace spoc
 namespace merge_app
 {
 
-void append (
-    const spoc::file::spoc_file &f1,
-    spoc::file::spoc_file &f2,
-    const unsigned id,
+/// Get the header of a merged file from the headers of its inputs
+/// @param hs Input headers
+/// @param quiet Don't warn about inputs that have different spatial
+/// reference systems
+/// @param s Warning stream
+///
+/// The merged file is compressed when all of the inputs are. The
+/// number of points and the extent come from the input headers, so no
+/// points need to be read. If any input is streaming, so is the merged
+/// file.
+inline spoc::header::header get_merged_header (const std::vector<spoc::header::header> &hs,
     const bool quiet,
     std::ostream &s = std::clog)
 {
-    // Check the SRS
-    if (!quiet && (f1.get_header ().wkt != f2.get_header ().wkt))
+    REQUIRE (!hs.empty ());
+
+    // Files without points don't know how many extra fields they have
+    const auto nonempty = [](const spoc::header::header &h)
+        { return h.streaming || h.total_points != 0; };
+    const auto first = std::find_if (hs.begin (), hs.end (), nonempty);
+    const size_t extra_fields = first == hs.end () ? hs[0].extra_fields : first->extra_fields;
+
+    spoc::header::header h (hs[0].wkt, extra_fields, 0, true);
+    bool same_wkt = true;
+    bool known_extent = true;
+    auto e = spoc::extent::get_extent (spoc::point_record::point_records ());
+    for (size_t i = 0; i < hs.size (); ++i)
+    {
+        if (nonempty (hs[i]) && hs[i].extra_fields != h.extra_fields)
+            throw std::runtime_error ("The input files have different numbers of extra fields");
+        same_wkt = same_wkt && hs[i].wkt == h.wkt;
+        h.compressed = h.compressed && hs[i].compressed;
+        h.streaming = h.streaming || hs[i].streaming;
+        h.total_points += hs[i].total_points;
+        if (!nonempty (hs[i]))
+            continue;
+        known_extent = known_extent && hs[i].e;
+        if (known_extent)
+            e = spoc::extent::get_total_extent (e, *hs[i].e);
+    }
+
+    if (!quiet && !same_wkt)
         s << "WARNING: The spatial reference systems differ" << std::endl;
+    if (h.streaming)
+        h.total_points = 0;
+    else if (known_extent && h.total_points != 0)
+        h.e = e;
+
+    return h;
+}
 
-    // Append 'f1' to 'f2'
-    for (size_t i = 0; i < f1.get_point_records ().size (); ++i)
+/// Merge files, one chunk at a time
+/// @param is Input streams, positioned at the start of each file
+/// @param os Output stream
+/// @param point_id Point ID of every merged point, or -1 to use the
+/// index of each point's input
+/// @param opts Compression options, used if every input is compressed
+/// @param jobs Number of inputs to read at the same time. Each input
+/// that is read ahead is held in memory.
+/// @param drop_halo Drop the halo points that spoc_tile added to the
+/// inputs, along with their halo flag field
+/// @param quiet Don't warn about common mistakes
+/// @param s Warning stream
+///
+/// With one job, only a few chunks are held in memory at a time, no
+/// matter how large the inputs are.
+inline void merge (const std::vector<std::istream *> &is,
+    std::ostream &os,
+    const int point_id,
+    const spoc::io::compression_options &opts,
+    const size_t jobs = 1,
+    const bool drop_halo = false,
+    const bool quiet = false,
+    std::ostream &s = std::clog)
+{
+    using namespace spoc::io;
+
+    REQUIRE (!is.empty ());
+
+    // Size the output from the input headers
+    std::vector<spoc::header::header> hs;
+    for (auto i : is)
+        hs.push_back (spoc::header::read_header (*i));
+    auto h = get_merged_header (hs, quiet, s);
+
+    // The halo flag is the last extra field
+    if (drop_halo)
     {
-        // Get the point from 'f1'
-        auto p = f1.get_point_record (i);
+        if (h.extra_fields == 0)
+            throw std::runtime_error ("The input files don't have a halo flag field");
+        --h.extra_fields;
+    }
+
+    // The extents of the inputs, for the area check
+    std::vector<spoc::extent::extent> es (is.size (),
+        columns::get_extent (columns::point_columns ()));
+    for (size_t i = 0; i < hs.size (); ++i)
+        if (hs[i].e)
+            es[i] = *hs[i].e;
 
-        // Set its ID
-        p.p = id;
+    size_t total_points = 0;
+    auto written_extent = columns::get_extent (columns::point_columns ());
+
+    // The uncompressed header may wait for the first points, see below
+    bool header_written = true;
+    const auto merge_inputs = [&](auto &w)
+    {
+        // Stamp the IDs and write each chunk as it arrives
+        const auto write = [&](columns::point_columns &pc, const size_t i)
+        {
+            if (pc.empty ())
+                return;
+            if (!hs[i].e)
+                es[i] = spoc::extent::get_total_extent (es[i], columns::get_extent (pc));
+            if (drop_halo)
+            {
+                std::vector<size_t> keep;
+                for (size_t k = 0; k < pc.size (); ++k)
+                    if (pc.extra[h.extra_fields][k] == 0)
+                        keep.push_back (k);
+                columns::point_columns q (0, h.extra_fields + 1);
+                columns::gather (q, pc, keep.begin (), keep.end ());
+                q.resize_extra_fields (h.extra_fields);
+                pc = std::move (q);
+                if (pc.empty ())
+                    return;
+                written_extent = spoc::extent::get_total_extent (written_extent, columns::get_finite_extent (pc));
+            }
+            const uint32_t id = point_id < 0 ? i : point_id;
+            std::fill (pc.p.begin (), pc.p.end (), id);
+            total_points += pc.size ();
+            if (!header_written)
+            {
+                write_header (os, h);
+                header_written = true;
+            }
+            w.write (pc);
+        };
+
+        if (jobs <= 1)
+        {
+            for (size_t i = 0; i < is.size (); ++i)
+            {
+                point_columns_reader r (*is[i], hs[i]);
+                for (auto pc = r.read (); !pc.empty (); pc = r.read ())
+                    write (pc, i);
+            }
+            return;
+        }
+
+        // Read up to 'jobs' inputs at once, and write them in order
+        std::vector<std::future<columns::point_columns>> fs (is.size ());
+        const auto start = [&](const size_t i)
+        {
+            if (i < is.size ())
+                fs[i] = std::async (std::launch::async,
+                    [&, i] { return read_point_columns (*is[i], hs[i]); });
+        };
+        for (size_t i = 0; i < jobs; ++i)
+            start (i);
+        for (size_t i = 0; i < is.size (); ++i)
+        {
+            auto pc = fs[i].get ();
+            start (i + jobs);
+            write (pc, i);
+        }
+    };
+
+    if (h.compressed)
+    {
+        compressed_writer w (os, h.wkt, h.extra_fields, opts);
+        merge_inputs (w);
+        w.close ();
+    }
+    else
+    {
+        // Dropping halo points changes the number of points, so the
+        // header is filled in afterward, or, if the output stream can't
+        // seek, marked as streaming. The header is written with the
+        // first points, so that a file without points doesn't reserve
+        // room for an extent.
+        const auto start = os.tellp ();
+        const bool patch = drop_halo && !h.streaming && start != -1;
+        if (drop_halo && !h.streaming && !patch)
+        {
+            h.streaming = true;
+            h.total_points = 0;
+            h.e.reset ();
+        }
+        if (patch)
+        {
+            h.e = written_extent;
+            header_written = false;
+        }
+        else
+            write_header (os, h);
+
+        point_record_writer w (os, h);
+        merge_inputs (w);
+        w.close ();
+
+        if (patch && !header_written)
+        {
+            h.total_points = 0;
+            h.e.reset ();
+            write_header (os, h);
+        }
+        else if (patch)
+        {
+            h.total_points = total_points;
+            h.e = spoc::io::get_header_extent (written_extent, total_points);
+            const auto end = os.tellp ();
+            os.seekp (start);
+            write_header (os, h);
+            os.seekp (end);
+            if (!os)
+                throw std::runtime_error ("Error writing the merged header");
+        }
+        else if (!h.streaming && total_points != h.total_points)
+            throw std::runtime_error ("The number of points does not match the input headers");
+    }
+
+    // What is the ratio of the total final area to the sum of the
+    // areas of each individual file?
+    if (!quiet && total_points != 0)
+    {
+        double area_sum = 0.0;
+        spoc::extent::extent total_extent = es[0];
+        for (const auto &e : es)
+        {
+            if (e.minp.x > e.maxp.x)
+                continue;
+            area_sum += spoc::extent::get_area (e);
+            total_extent = spoc::extent::get_total_extent (total_extent, e);
+        }
+        const double r = spoc::extent::get_area (total_extent) / area_sum;
 
-        // Add it to 'b'
-        f2.push_back (p);
+        // If the area grew by too much, give a warning
+        if (r > 100)
+            s << "WARNING: 99% of the final merged area does not contain any points" << std::endl;
     }
 }
 
@@ -18,6 +18,10 @@ struct args
     bool version = false;
     bool quiet = false;
     int point_id = -1;
+    std::string codec = "zlib";
+    int level = -1;
+    size_t jobs = 1;
+    bool drop_halo = false;
     std::vector<std::string> fns;
 };
 
@@ -33,10 +37,14 @@ inline args get_args (int argc, char **argv, const std::string &usage)
             {"version", no_argument, 0, 'e'},
             {"quiet", no_argument, 0, 'q'},
             {"point-id", required_argument, 0, 'p'},
+            {"codec", required_argument, 0, 'c'},
+            {"level", required_argument, 0, 'l'},
+            {"jobs", required_argument, 0, 'j'},
+            {"drop-halo", no_argument, 0, 'd'},
             {0, 0, 0, 0}
         };
 
-        int c = getopt_long(argc, argv, "hveqp:", long_options, &option_index);
+        int c = getopt_long(argc, argv, "hveqp:c:l:j:d", long_options, &option_index);
         if (c == -1)
             break;
 
@@ -56,6 +64,10 @@ inline args get_args (int argc, char **argv, const std::string &usage)
             case 'e': args.version = true; break;
             case 'q': args.quiet = !args.quiet; break;
             case 'p': args.point_id = std::atoi (optarg); break;
+            case 'c': args.codec = std::string (optarg); break;
+            case 'l': args.level = std::atoi (optarg); break;
+            case 'j': args.jobs = spoc::cmd::get_jobs (optarg); break;
+            case 'd': args.drop_halo = true; break;
         }
     }
 
@@ -0,0 +1,127 @@
+#include "spoc/app_utils.h"
+#include "spoc/spoc.h"
+#include "query.h"
+#include "query_cmd.h"
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+
+int main (int argc, char **argv)
+{
+    using namespace std;
+    using namespace spoc::file;
+    using namespace spoc::io;
+    using namespace spoc::query_app;
+    using namespace spoc::query_cmd;
+
+    try
+    {
+        // Parse command line
+        const args args = get_args (argc, argv,
+                string (argv[0]) + " [options] --bbox=minx,miny,maxx,maxy spocfile\n"
+                + string (argv[0]) + " [options] --build-index input output");
+
+        // If version was requested, print it and exit
+        if (args.version)
+        {
+            cout << "Version "
+                << static_cast<int> (spoc::MAJOR_VERSION)
+                << "."
+                << static_cast<int> (spoc::MINOR_VERSION)
+                << endl;
+            return 0;
+        }
+
+        // If you are getting help, exit without an error
+        if (args.help)
+            return 0;
+
+        // Show args
+        if (args.verbose)
+        {
+            clog << "verbose\t" << args.verbose << endl;
+            clog << "bbox\t'" << args.bbox << "'" << endl;
+            clog << "build-index\t" << args.build_index << endl;
+            clog << "cell-size\t" << args.cell_size << endl;
+            clog << "filenames\t" << args.fns.size () << endl;
+        }
+
+        if (args.build_index)
+        {
+            if (args.fns.size () != 2)
+                throw runtime_error ("When building an index, you need to specify one input file and one output file");
+            if (!args.bbox.empty ())
+                throw runtime_error ("You can't specify both 'build-index' and 'bbox'");
+
+            if (args.verbose)
+                clog << "Reading " << args.fns[0] << endl;
+
+            ifstream ifs (args.fns[0]);
+
+            if (!ifs)
+                throw runtime_error ("Could not open file for reading");
+
+            // Read into spoc_file struct
+            spoc_file f = read_spoc_file (ifs);
+
+            // Sort the points by cell and index them
+            auto prs = f.move_point_records ();
+            const auto idx = spoc::index::build_index (prs, args.cell_size);
+            f.move_point_records (prs);
+
+            if (args.verbose)
+                clog << "Grid is " << idx.nx << " X " << idx.ny
+                    << " cells of size " << idx.cell_size << endl;
+
+            if (args.verbose)
+                clog << "Writing " << args.fns[1] << endl;
+
+            ofstream ofs (args.fns[1]);
+
+            if (!ofs)
+                throw runtime_error ("Could not open file for writing");
+
+            write_spoc_file (ofs, f);
+
+            // Write the index
+            const auto ifn = spoc::index::get_index_filename (args.fns[1]);
+
+            if (args.verbose)
+                clog << "Writing " << ifn << endl;
+
+            ofstream idx_ofs (ifn, ios::binary);
+
+            if (!idx_ofs)
+                throw runtime_error ("Could not open file for writing");
+
+            spoc::index::write_index (idx_ofs, idx);
+        }
+        else
+        {
+            if (args.bbox.empty ())
+                throw runtime_error ("No bounding box was specified");
+            if (args.fns.size () != 1)
+                throw runtime_error ("When querying, you need to specify one input file");
+
+            const auto e = parse_bbox (args.bbox);
+
+            if (args.verbose)
+                clog << "Querying " << args.fns[0] << endl;
+
+            // Read the points in the box
+            const auto f = spoc::index::query_box (args.fns[0], e);
+
+            if (args.verbose)
+                clog << "Writing " << f.get_point_records ().size () << " points to stdout" << endl;
+
+            write_spoc_file (cout, f);
+        }
+
+        return 0;
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what () << endl;
+        return -1;
+    }
+}
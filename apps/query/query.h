@@ -0,0 +1,44 @@
+#pragma once
+
+#include "spoc/app_utils.h"
+#include "spoc/spoc.h"
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace spoc
+{
+
+namespace query_app
+{
+
+// Parse a bounding box
+//
+// The box is either 'minx,miny,maxx,maxy', which includes all z values,
+// or 'minx,miny,minz,maxx,maxy,maxz'.
+inline spoc::extent::extent parse_bbox (const std::string &bbox)
+{
+    std::string s (bbox);
+    std::vector<double> v;
+    while (!s.empty ())
+        v.push_back (spoc::app_utils::consume_double (s));
+
+    const double inf = std::numeric_limits<double>::infinity ();
+    spoc::extent::extent e;
+    if (v.size () == 4)
+        e = spoc::extent::extent { { v[0], v[1], -inf }, { v[2], v[3], inf } };
+    else if (v.size () == 6)
+        e = spoc::extent::extent { { v[0], v[1], v[2] }, { v[3], v[4], v[5] } };
+    else
+        throw std::runtime_error ("A bounding box must have 4 or 6 values: " + bbox);
+
+    if (!spoc::extent::all_less_equal (e.minp, e.maxp))
+        throw std::runtime_error ("The bounding box minimum is greater than its maximum: " + bbox);
+
+    return e;
+}
+
+} // namespace query_app
+
+} // namespace spoc
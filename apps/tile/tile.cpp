@@ -3,11 +3,16 @@
 #include "tile.h"
 #include "tile_cmd.h"
 #include <algorithm>
+#include <cmath>
 #include <filesystem>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
 #include <limits>
+#include <mutex>
 #include <sstream>
 #include <stdexcept>
+#include <unordered_set>
 
 int main (int argc, char **argv)
 {
@@ -51,6 +56,14 @@ int main (int argc, char **argv)
             clog << "tile-size-x\t" << args.tile_size_x << endl;
             clog << "tile-size-y\t" << args.tile_size_y << endl;
             clog << "prefix\t'" << args.prefix << "'" << endl;
+            clog << "codec\t" << args.codec << endl;
+            clog << "level\t" << args.level << endl;
+            clog << "streaming\t" << args.streaming << endl;
+            clog << "max-points-in-memory\t" << args.max_points_in_memory << endl;
+            clog << "temp-dir\t'" << args.temp_dir << "'" << endl;
+            clog << "jobs\t" << args.jobs << endl;
+            clog << "max-points-per-tile\t" << args.max_points_per_tile << endl;
+            clog << "buffer\t" << args.buffer << endl;
             clog << "Reading " << args.fn << endl;
         }
 
@@ -59,15 +72,15 @@ int main (int argc, char **argv)
             throw runtime_error("If using stdin as input you must specify an output prefix");
         }
 
+        // Get the compression options
+        compression_options opts;
+        opts.codec = spoc::compression::get_codec (args.codec);
+        opts.level = args.level;
+        spoc::compression::check_available (opts.codec);
+
         // Get the input stream
         input_stream is (args.verbose, args.fn);
 
-        // Read into spoc_file struct
-        spoc_file f = read_spoc_file (is ());
-
-        if (args.verbose)
-            clog << "Total points " << f.get_point_records ().size () << endl;
-
         // Check the arguments
         if (args.tile_size > 0.0 && args.tile_size_x > 0.0)
             throw runtime_error ("You can't specify both 'tile-size' and 'tile-size-x'");
@@ -79,50 +92,58 @@ int main (int argc, char **argv)
             throw runtime_error ("You can't specify both 'tile-size-x' and 'target-tile-size'");
         if (args.tile_size_y > 0.0 && args.target_tile_size > 0.0)
             throw runtime_error ("You can't specify both 'tile-size-y' and 'target-tile-size'");
-
-        // Get the extent
-        const auto e = get_extent (f.get_point_records ());
+        if (args.max_points_per_tile > 0 && (args.tile_size > 0.0
+            || args.tile_size_x > 0.0 || args.tile_size_y > 0.0 || args.target_tile_size > 0.0))
+            throw runtime_error ("You can't specify a tile size with 'max-points-per-tile'");
+        if (args.max_points_per_tile > 0 && args.streaming)
+            throw runtime_error ("You can't use 'max-points-per-tile' when streaming");
+        if (args.buffer < 0.0)
+            throw runtime_error ("'buffer' must not be negative");
+        if (args.max_points_in_memory == 0)
+            throw runtime_error ("'max-points-in-memory' must be greater than 0");
+
+        const auto h = spoc::header::read_header (is ());
 
         // Get independent sizes
         double tile_size_x = -1.0;
         double tile_size_y = -1.0;
 
-        // Get the tile size when X and Y are not independent
-        if (args.tile_size > 0.0)
-        {
-            tile_size_x = args.tile_size;
-            tile_size_y = args.tile_size;
-        }
-        else if (args.tile_size_x > 0.0 || args.tile_size_y > 0.0)
-        {
-            tile_size_x = args.tile_size_x;
-            tile_size_y = args.tile_size_y;
-        }
-        else if (args.target_tile_size > 0.0)
-        {
-            const auto tile_sizes = get_target_tile_size (e, args.target_tile_size);
-            tile_size_x = tile_sizes.first;
-            tile_size_y = tile_sizes.second;
-        }
-        else
+        // The tiles must cover a finite area
+        const auto check_extent = [] (const spoc::extent::extent &e)
         {
-            const auto tile_size = get_tile_size (e, args.tiles);
-            tile_size_x = tile_size;
-            tile_size_y = tile_size;
-        }
-
-        if (args.verbose)
-            clog << "Tiles are " << tile_size_x << " X " << tile_size_y << endl;
+            if (!isfinite (e.minp.x) || !isfinite (e.minp.y) || !isfinite (e.maxp.x) || !isfinite (e.maxp.y))
+                throw runtime_error ("The X and Y coordinates of the points don't have a finite extent");
+        };
 
-        // Get the tile index of each point in the point cloud
-        const auto indexes = get_tile_indexes (f.get_point_records (), e, tile_size_x, tile_size_y);
-
-        // Map each tile index to a vector of point cloud indexes
-        const auto tile_map = get_tile_map (indexes);
+        const auto set_tile_sizes = [&] (const spoc::extent::extent &e)
+        {
+            // Get the tile size when X and Y are not independent
+            if (args.tile_size > 0.0)
+            {
+                tile_size_x = args.tile_size;
+                tile_size_y = args.tile_size;
+            }
+            else if (args.tile_size_x > 0.0 || args.tile_size_y > 0.0)
+            {
+                tile_size_x = args.tile_size_x;
+                tile_size_y = args.tile_size_y;
+            }
+            else if (args.target_tile_size > 0.0)
+            {
+                const auto tile_sizes = get_target_tile_size (e, args.target_tile_size);
+                tile_size_x = tile_sizes.first;
+                tile_size_y = tile_sizes.second;
+            }
+            else
+            {
+                const auto tile_size = get_tile_size (e, args.tiles);
+                tile_size_x = tile_size;
+                tile_size_y = tile_size;
+            }
 
-        // Write each tile
-        if (args.verbose)
-            clog << "Writing tiles" << endl;
+            if (args.verbose)
+                clog << "Tiles are " << tile_size_x << " X " << tile_size_y << endl;
+        };
 
         // Check the prefix
         const auto prefix = args.prefix.empty ()
@@ -131,46 +152,13 @@ int main (int argc, char **argv)
 
         assert (!prefix.empty ());
 
-        // Get the map keys
-        vector<size_t> keys;
-        for (const auto &i : tile_map)
-            keys.push_back (i.first);
-
-        // Sort the map keys
-        sort (begin (keys), end (keys));
-
-        // For each tile number
-        for (const auto tile : keys)
+        // Get the filename of a tile
+        const auto get_tile_filename = [&] (const size_t tile)
         {
-            // Get the vector of point cloud indexes in this tile
-            const auto &v = tile_map.at (tile);
-
-            // It won't have an entry in the map if the vector is empty
-            assert (!v.empty ());
-
-            // The file to write
-            spoc_file t;
-
-            // Set the SRS
-            t.set_wkt (f.get_wkt ());
-
-            // Set the compression bit
-            t.set_compressed (f.get_compressed ());
-
-            // For each point index in this tile...
-            for (size_t j = 0; j < v.size (); ++j)
-            {
-                // Get the point from the input file
-                const auto p = f.get_point_record (v[j]);
-
-                // Add it to the output file
-                t.push_back (p);
-            }
-
             // Get the filename extension
             const string ext = args.fn.empty ()
                 ?
-                (t.get_compressed () ? string (".zpoc") : string (".spoc"))
+                (h.compressed ? string (".zpoc") : string (".spoc"))
                 :
                 filesystem::path (args.fn).extension().string ();
 
@@ -179,13 +167,18 @@ int main (int argc, char **argv)
             sfn << prefix;
             sfn << setw(args.digits) << setfill('0') << tile;
             sfn << ext;
+            return sfn.str ();
+        };
 
+        // Open a file for writing
+        const auto open_file = [&] (ofstream &ofs, const string &fn)
+        {
             // Check if file already exists
             if (!args.force)
             {
                 if (args.verbose)
-                    clog << "Checking if '" << sfn.str () << "' exists" << endl;
-                ifstream tmp_ifs (sfn.str ());
+                    clog << "Checking if '" << fn << "' exists" << endl;
+                ifstream tmp_ifs (fn);
                 if (tmp_ifs.good())
                     throw runtime_error ("File already exists. "
                         "Use the force option to overwrite. "
@@ -193,15 +186,184 @@ int main (int argc, char **argv)
             }
 
             if (args.verbose)
-                clog << "Writing " << sfn.str () << endl;
+                clog << "Writing " << fn << endl;
 
-            ofstream ofs (sfn.str ());
+            ofs.open (fn, ios::binary);
 
             if (!ofs)
                 throw runtime_error ("Could not open file for writing");
+        };
+
+        if (args.streaming)
+        {
+            // First pass: get the extent, from the header if it's there
+            spoc::extent::extent e;
+            if (h.e)
+                e = *h.e;
+            else if (args.fn.empty ())
+                throw runtime_error ("Streaming from stdin requires an input header with an extent");
+            else
+            {
+                if (args.verbose)
+                    clog << "Scanning for the extent" << endl;
+                ifstream ifs (args.fn, ios::binary);
+                if (!ifs)
+                    throw runtime_error ("Could not open file for reading");
+                e = read_extent (ifs);
+            }
+
+            check_extent (e);
+            set_tile_sizes (e);
+
+            // Second pass: route each chunk of points to its tiles
+            const auto temp_dir = args.temp_dir.empty ()
+                ? filesystem::temp_directory_path ()
+                : filesystem::path (args.temp_dir);
+            const size_t extra_fields = h.extra_fields + (args.buffer > 0.0);
+            tile_spooler spooler (temp_dir, extra_fields, args.max_points_in_memory);
+            const size_t chunk_size = std::min (args.max_points_in_memory, DEFAULT_BLOCK_SIZE);
+            point_columns_reader r (is (), h, chunk_size);
+            size_t total_points = 0;
+            for (auto pc = r.read (); !pc.empty (); pc = r.read ())
+            {
+                total_points += pc.size ();
+                const size_t owned = pc.size ();
+                auto indexes = get_tile_indexes (pc, e, tile_size_x, tile_size_y);
+                if (args.buffer > 0.0)
+                {
+                    const auto halo = get_halo_indexes (pc, indexes, e, tile_size_x, tile_size_y, args.buffer);
+                    add_halo_points (pc, indexes, halo);
+                }
+
+                // The spooler keeps the halo points after each tile's own
+                // points, as they are when the points are tiled in memory
+                spooler.add (pc, indexes, owned);
+            }
+
+            if (args.verbose)
+            {
+                clog << "Total points " << total_points << endl;
+                clog << "Writing tiles" << endl;
+            }
+
+            // Write each tile. Tiles that only have halo points are
+            // skipped.
+            for (const auto tile : spooler.get_tiles ())
+            {
+                ofstream ofs;
+                open_file (ofs, get_tile_filename (tile));
+
+                if (h.compressed)
+                {
+                    compressed_writer w (ofs, h.wkt, extra_fields, opts);
+                    spooler.read_tile (tile, [&] (const auto &pc) { w.write (pc); });
+                    w.close ();
+                }
+                else
+                {
+                    spoc::header::header th (h.wkt, extra_fields, spooler.get_total_points (tile), false);
+                    th.e = get_header_extent (spooler.get_extent (tile), th.total_points);
+                    write_header (ofs, th);
+                    point_record_writer w (ofs, th);
+                    spooler.read_tile (tile, [&] (const auto &pc) { w.write (pc); });
+                    w.close ();
+                }
+
+                if (!ofs)
+                    throw runtime_error ("Error writing tile");
+            }
+
+            return 0;
+        }
+
+        // Read the points
+        auto pc = read_point_columns (is (), h);
+
+        if (args.verbose)
+            clog << "Total points " << pc.size () << endl;
+
+        // Get the extent, from the header if it's there
+        const auto e = h.e ? *h.e : spoc::columns::get_finite_extent (pc);
+        check_extent (e);
+
+        // Get the tile index of each point
+        vector<size_t> indexes;
+        quadtree_tiling q;
+        if (args.max_points_per_tile > 0)
+        {
+            q = get_quadtree_tiles (pc, e, args.max_points_per_tile,
+                DEFAULT_MAX_QUADTREE_DEPTH, args.buffer);
+            indexes = std::move (q.indexes);
+            if (args.buffer > 0.0)
+                add_halo_points (pc, indexes, q.halo);
+            if (args.verbose)
+                clog << "Split into " << q.leaves.size () << " tiles" << endl;
+        }
+        else
+        {
+            set_tile_sizes (e);
+            indexes = get_tile_indexes (pc, e, tile_size_x, tile_size_y);
+            if (args.buffer > 0.0)
+            {
+                // Only add halo points to tiles that have points
+                const unordered_set<size_t> owned (indexes.begin (), indexes.end ());
+                auto halo = get_halo_indexes (pc, indexes, e, tile_size_x, tile_size_y, args.buffer);
+                erase_if (halo, [&] (const auto &i) { return owned.count (i.second) == 0; });
+                add_halo_points (pc, indexes, halo);
+            }
+        }
+
+        // Group the points by tile
+        const auto t = get_tile_order (indexes, args.jobs);
+
+        // Write each tile
+        if (args.verbose)
+            clog << "Writing tiles" << endl;
+
+        mutex m;
+        write_tiles (pc, t, [&] (const size_t tile, const spoc::columns::point_columns &tc)
+        {
+            ofstream ofs;
+            {
+                lock_guard<mutex> lock (m);
+                open_file (ofs, get_tile_filename (tile));
+            }
 
             // Write it out
-            write_spoc_file (ofs, t);
+            if (h.compressed)
+            {
+                write_spoc_file_compressed (ofs, h.wkt, tc, opts);
+            }
+            else
+            {
+                spoc::header::header th (h.wkt, tc.get_extra_fields (), tc.size (), false);
+                th.e = get_header_extent (spoc::columns::get_finite_extent (tc), tc.size ());
+                write_header (ofs, th);
+                point_record_writer w (ofs, th);
+                w.write (tc);
+                w.close ();
+            }
+
+            if (!ofs)
+                throw runtime_error ("Error writing tile");
+        }, args.jobs, args.max_points_in_memory);
+
+        // Describe the adaptive tiles
+        if (args.max_points_per_tile > 0)
+        {
+            vector<string> filenames;
+            for (size_t tile = 0; tile < q.leaves.size (); ++tile)
+                filenames.push_back (get_tile_filename (tile));
+
+            ofstream ofs;
+            open_file (ofs, prefix + "manifest.json");
+            ofs.precision (15);
+            ofs << fixed;
+            spoc::json::pretty_print (ofs, get_manifest (q, filenames), 0);
+            ofs << endl;
+
+            if (!ofs)
+                throw runtime_error ("Error writing manifest");
         }
 
         return 0;
@@ -1,12 +1,32 @@
 #pragma once
 
+#include "spoc/columns.h"
 #include "spoc/extent.h"
+#include "spoc/io.h"
+#include "spoc/json.h"
+#include "spoc/utils.h"
+#include "tile_defaults.h"
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cmath>
+#include <condition_variable>
+#include <exception>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
 #include <limits>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <tuple>
 #include <vector>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <unistd.h>
 
 namespace spoc
 {
@@ -87,6 +107,10 @@ std::vector<size_t> get_tile_indexes (const T &p,
         const double xo = p[i].x - e.minp.x;
         const double yo = p[i].y - e.minp.y;
 
+        // Converting a NaN to an integer is undefined
+        if (!std::isfinite (xo) || !std::isfinite (yo))
+            throw std::runtime_error ("Points with a NaN or infinite X or Y can't be tiled");
+
         // Get the x and y indexes
         const size_t xi = tile_size_x > 0.0 ? xo / tile_size_x : 0.0;
         const size_t yi = tile_size_y > 0.0 ? yo / tile_size_y : 0.0;
@@ -102,6 +126,183 @@ std::vector<size_t> get_tile_indexes (const T &p,
     return indexes;
 }
 
+namespace detail
+{
+
+// Lets get_tile_indexes() read the locations in point columns
+struct xy_view
+{
+    const spoc::columns::point_columns &pc;
+    size_t size () const { return pc.size (); }
+    spoc::point::point<double> operator[] (const size_t i) const { return { pc.x[i], pc.y[i], 0.0 }; }
+};
+
+} // namespace detail
+
+inline std::vector<size_t> get_tile_indexes (const spoc::columns::point_columns &pc,
+    const spoc::extent::extent &e,
+    const double tile_size_x,
+    const double tile_size_y)
+{
+    return get_tile_indexes (detail::xy_view {pc}, e, tile_size_x, tile_size_y);
+}
+
+/// Default maximum depth of an adaptive tiling
+constexpr size_t DEFAULT_MAX_QUADTREE_DEPTH = 32;
+
+/// @brief A tile in an adaptive tiling
+struct quadtree_leaf
+{
+    /// The tile's cell, which is a quadrant of its parent's cell. The Z
+    /// extent is the Z extent of the whole point cloud.
+    spoc::extent::extent e;
+    /// Number of times the extent was split to get this cell
+    size_t depth = 0;
+    /// Number of points in the tile
+    size_t total_points = 0;
+    /// Number of halo points in the tile
+    size_t halo_points = 0;
+};
+
+/// @brief An adaptive tiling of a point cloud
+struct quadtree_tiling
+{
+    /// The leaf index of each point
+    std::vector<size_t> indexes;
+    /// The leaves that have points, in depth first order
+    std::vector<quadtree_leaf> leaves;
+    /// Point index and leaf index of each halo point
+    std::vector<std::pair<size_t, size_t>> halo;
+};
+
+/// @brief Split an extent into quadrants until each one holds a maximum
+/// number of points
+/// @param p Point locations
+/// @param e Extent of the points
+/// @param max_points Maximum number of points in each leaf
+/// @param max_depth Maximum number of splits. Leaves at this depth, or
+/// leaves that are too small to split, can hold more than 'max_points'.
+/// @param buffer Points outside of a leaf's cell, but within this
+/// distance of it, are the leaf's halo points
+///
+/// The children of a cell are ordered by Y and then by X, like the
+/// tiles in a grid. Empty cells are dropped.
+template<typename T>
+quadtree_tiling get_quadtree_tiles (const T &p,
+    const spoc::extent::extent &e,
+    const size_t max_points,
+    const size_t max_depth = DEFAULT_MAX_QUADTREE_DEPTH,
+    const double buffer = 0.0)
+{
+    REQUIRE (max_points != 0);
+
+    quadtree_tiling q;
+    q.indexes.resize (p.size ());
+
+    std::vector<size_t> order (p.size ());
+    std::iota (order.begin (), order.end (), 0);
+
+    const auto near = [&](const size_t i, const spoc::extent::extent &cell)
+    {
+        return p[i].x >= cell.minp.x - buffer && p[i].x <= cell.maxp.x + buffer
+            && p[i].y >= cell.minp.y - buffer && p[i].y <= cell.maxp.y + buffer;
+    };
+
+    // 'halo' holds the points outside of 'cell' that are near it
+    const auto split = [&](auto &&split, const auto first, const auto last,
+        const std::vector<size_t> &halo,
+        const spoc::extent::extent &cell, const size_t depth) -> void
+    {
+        const size_t n = last - first;
+        if (n == 0)
+            return;
+
+        const double mx = cell.minp.x + (cell.maxp.x - cell.minp.x) / 2.0;
+        const double my = cell.minp.y + (cell.maxp.y - cell.minp.y) / 2.0;
+        const bool too_small = !(mx > cell.minp.x) && !(my > cell.minp.y);
+        if (n <= max_points || depth >= max_depth || too_small)
+        {
+            for (auto i = first; i != last; ++i)
+                q.indexes[*i] = q.leaves.size ();
+            for (const auto i : halo)
+                q.halo.push_back ({ i, q.leaves.size () });
+            q.leaves.push_back ({ cell, depth, n, halo.size () });
+            return;
+        }
+
+        // Partition by Y, then each half by X
+        const auto below = [&](const size_t i) { return p[i].y < my; };
+        const auto left = [&](const size_t i) { return p[i].x < mx; };
+        const auto y = std::stable_partition (first, last, below);
+        const auto x0 = std::stable_partition (first, y, left);
+        const auto x1 = std::stable_partition (y, last, left);
+
+        // Split a quadrant. Its halo comes from its parent's halo and
+        // from the parent's other quadrants.
+        const std::vector<std::pair<decltype (first), decltype (first)>> quadrants {
+            { first, x0 }, { x0, y }, { y, x1 }, { x1, last } };
+        for (size_t k = 0; k < quadrants.size (); ++k)
+        {
+            auto c = cell;
+            (k % 2 == 0 ? c.maxp.x : c.minp.x) = mx;
+            (k / 2 == 0 ? c.maxp.y : c.minp.y) = my;
+            std::vector<size_t> h;
+            if (buffer > 0.0)
+            {
+                for (const auto i : halo)
+                    if (near (i, c))
+                        h.push_back (i);
+                for (size_t j = 0; j < quadrants.size (); ++j)
+                    if (j != k)
+                        std::copy_if (quadrants[j].first, quadrants[j].second,
+                            std::back_inserter (h),
+                            [&](const size_t i) { return near (i, c); });
+            }
+            split (split, quadrants[k].first, quadrants[k].second, h, c, depth + 1);
+        }
+    };
+    split (split, order.begin (), order.end (), std::vector<size_t> (), e, 0);
+
+    return q;
+}
+
+inline quadtree_tiling get_quadtree_tiles (const spoc::columns::point_columns &pc,
+    const spoc::extent::extent &e,
+    const size_t max_points,
+    const size_t max_depth = DEFAULT_MAX_QUADTREE_DEPTH,
+    const double buffer = 0.0)
+{
+    return get_quadtree_tiles (detail::xy_view {pc}, e, max_points, max_depth, buffer);
+}
+
+/// @brief Describe the tiles of an adaptive tiling
+/// @param q The tiling
+/// @param filenames The filename of each leaf
+inline spoc::json::object get_manifest (const quadtree_tiling &q,
+    const std::vector<std::string> &filenames)
+{
+    REQUIRE (q.leaves.size () == filenames.size ());
+
+    spoc::json::array tiles;
+    for (size_t k = 0; k < q.leaves.size (); ++k)
+    {
+        const auto &l = q.leaves[k];
+        spoc::json::object t;
+        t["filename"] = filenames[k];
+        t["depth"] = uint64_t (l.depth);
+        t["total_points"] = uint64_t (l.total_points);
+        t["halo_points"] = uint64_t (l.halo_points);
+        t["min_x"] = l.e.minp.x;
+        t["min_y"] = l.e.minp.y;
+        t["max_x"] = l.e.maxp.x;
+        t["max_y"] = l.e.maxp.y;
+        tiles.push_back (t);
+    }
+    spoc::json::object m;
+    m["tiles"] = tiles;
+    return m;
+}
+
 using tile_map = std::unordered_map<size_t, std::vector<size_t>>;
 
 template<typename T>
@@ -117,6 +318,487 @@ tile_map get_tile_map (const T &indexes)
     return m;
 }
 
+/// @brief Find the grid tiles that each point is a halo point of
+/// @param p Point locations
+/// @param indexes The tile index of each point, see get_tile_indexes()
+/// @param e Extent used to get the tile indexes
+/// @param tile_size_x Tile size in X
+/// @param tile_size_y Tile size in Y
+/// @param buffer Points outside of a tile, but within this distance of
+/// it, are the tile's halo points
+/// @return The point index and tile index of each halo point. Tiles
+/// that might not have points of their own are included. Points with a
+/// NaN or infinite X or Y aren't near any tile, so they are skipped.
+template<typename T>
+std::vector<std::pair<size_t, size_t>> get_halo_indexes (const T &p,
+    const std::vector<size_t> &indexes,
+    const spoc::extent::extent &e,
+    const double tile_size_x,
+    const double tile_size_y,
+    const double buffer)
+{
+    REQUIRE (p.size () == indexes.size ());
+
+    // Get the number of tiles in X and Y
+    const double dx = e.maxp.x - e.minp.x;
+    const double dy = e.maxp.y - e.minp.y;
+    const size_t stride = tile_size_x > 0.0 ? dx / tile_size_x + 1.0 : 1.0;
+    const size_t rows = tile_size_y > 0.0 ? dy / tile_size_y + 1.0 : 1.0;
+
+    // Get the first and last tile within 'buffer' of an offset
+    const auto get_range = [&](const double o, const double tile_size, const size_t n)
+    {
+        if (tile_size <= 0.0)
+            return std::make_pair (size_t (0), size_t (0));
+        const double lo = std::floor ((o - buffer) / tile_size);
+        const double hi = std::floor ((o + buffer) / tile_size);
+        return std::make_pair (
+            size_t (std::clamp (lo, 0.0, double (n - 1))),
+            size_t (std::clamp (hi, 0.0, double (n - 1))));
+    };
+
+    std::vector<std::pair<size_t, size_t>> halo;
+    for (size_t i = 0; i < p.size (); ++i)
+    {
+        // Converting a NaN to an integer is undefined
+        if (!std::isfinite (p[i].x) || !std::isfinite (p[i].y))
+            continue;
+        const auto xr = get_range (p[i].x - e.minp.x, tile_size_x, stride);
+        const auto yr = get_range (p[i].y - e.minp.y, tile_size_y, rows);
+        for (size_t yi = yr.first; yi <= yr.second; ++yi)
+        {
+            for (size_t xi = xr.first; xi <= xr.second; ++xi)
+            {
+                const size_t index = yi * stride + xi;
+                if (index != indexes[i])
+                    halo.push_back ({ i, index });
+            }
+        }
+    }
+
+    return halo;
+}
+
+inline std::vector<std::pair<size_t, size_t>> get_halo_indexes (const spoc::columns::point_columns &pc,
+    const std::vector<size_t> &indexes,
+    const spoc::extent::extent &e,
+    const double tile_size_x,
+    const double tile_size_y,
+    const double buffer)
+{
+    return get_halo_indexes (detail::xy_view {pc}, indexes, e, tile_size_x, tile_size_y, buffer);
+}
+
+/// @brief Copy halo points into their tiles
+/// @param pc Points
+/// @param indexes The tile index of each point
+/// @param halo The point index and tile index of each halo point
+///
+/// A halo flag is added to each point after its extra fields. The flag
+/// is 0 for the points in 'pc', and 1 for the copies of the halo points,
+/// which are appended to 'pc'. Their tiles are appended to 'indexes'.
+inline void add_halo_points (spoc::columns::point_columns &pc,
+    std::vector<size_t> &indexes,
+    const std::vector<std::pair<size_t, size_t>> &halo)
+{
+    REQUIRE (pc.size () == indexes.size ());
+
+    const size_t extra_fields = pc.get_extra_fields ();
+    pc.resize_extra_fields (extra_fields + 1);
+
+    std::vector<size_t> points (halo.size ());
+    for (size_t k = 0; k < halo.size (); ++k)
+    {
+        points[k] = halo[k].first;
+        indexes.push_back (halo[k].second);
+    }
+
+    spoc::columns::point_columns q (0, extra_fields + 1);
+    spoc::columns::gather (q, pc, points.begin (), points.end ());
+    std::fill (q.extra[extra_fields].begin (), q.extra[extra_fields].end (), 1);
+    spoc::columns::append (pc, q);
+}
+
+/// @brief Point indexes grouped by tile
+///
+/// The points in tile 'tiles[k]' are 'order[offsets[k]]' up to
+/// 'order[offsets[k + 1]]', in the same order as the input.
+struct tile_order
+{
+    std::vector<size_t> tiles;
+    std::vector<size_t> offsets;
+    std::vector<size_t> order;
+};
+
+/// @brief Group point indexes by tile with a counting sort
+/// @param indexes The tile index of each point, see get_tile_indexes()
+/// @param jobs Number of pieces to count and scatter in parallel
+inline tile_order get_tile_order (const std::vector<size_t> &indexes, size_t jobs = 1)
+{
+    const size_t n = indexes.size ();
+    tile_order t;
+    t.offsets.push_back (0);
+    if (n == 0)
+        return t;
+    jobs = std::clamp (jobs, size_t (1), n);
+
+    // Number the tiles that have points. Tile indexes are usually dense,
+    // so use a lookup table unless they are spread far apart.
+    const size_t max_index = *std::max_element (indexes.begin (), indexes.end ());
+    std::vector<size_t> table;
+    if (max_index < 4 * n + (1 << 16))
+    {
+        table.assign (max_index + 1, 0);
+        for (const auto i : indexes)
+            table[i] = 1;
+        for (size_t i = 0; i < table.size (); ++i)
+        {
+            if (table[i] == 0)
+                continue;
+            table[i] = t.tiles.size ();
+            t.tiles.push_back (i);
+        }
+    }
+    else
+    {
+        t.tiles = indexes;
+        std::sort (t.tiles.begin (), t.tiles.end ());
+        t.tiles.erase (std::unique (t.tiles.begin (), t.tiles.end ()), t.tiles.end ());
+    }
+    const auto get_tile = [&](const size_t i)
+    {
+        return table.empty ()
+            ? std::lower_bound (t.tiles.begin (), t.tiles.end (), i) - t.tiles.begin ()
+            : table[i];
+    };
+
+    // Count the points in each tile, one piece of the input per job
+    const size_t ntiles = t.tiles.size ();
+    const auto first = [&](const size_t j) { return j * n / jobs; };
+    std::vector<std::vector<size_t>> counts (jobs, std::vector<size_t> (ntiles));
+    spoc::utils::parallel_for (jobs, [&](const size_t j)
+    {
+        for (size_t i = first (j); i < first (j + 1); ++i)
+            ++counts[j][get_tile (indexes[i])];
+    });
+
+    // Each piece's points follow the previous piece's points in a tile
+    t.offsets.resize (ntiles + 1);
+    size_t total = 0;
+    for (size_t k = 0; k < ntiles; ++k)
+    {
+        t.offsets[k] = total;
+        for (size_t j = 0; j < jobs; ++j)
+        {
+            const size_t c = counts[j][k];
+            counts[j][k] = total;
+            total += c;
+        }
+    }
+    t.offsets[ntiles] = total;
+    assert (total == n);
+
+    // Scatter
+    t.order.resize (n);
+    spoc::utils::parallel_for (jobs, [&](const size_t j)
+    {
+        for (size_t i = first (j); i < first (j + 1); ++i)
+            t.order[counts[j][get_tile (indexes[i])]++] = i;
+    });
+
+    return t;
+}
+
+/// @brief Sorts points into tiles in bounded memory
+///
+/// Points are buffered per tile. When too many points are buffered,
+/// the largest buffers are appended to per-tile spill files, as
+/// uncompressed records. Reading a tile gives its points in the order
+/// that they were added, followed by its halo points in the order that
+/// they were added.
+class tile_spooler
+{
+    private:
+    struct part
+    {
+        spoc::columns::point_columns buffer;
+        size_t spilled = 0;
+    };
+    struct tile
+    {
+        part owned;
+        part halo;
+        spoc::extent::extent e = spoc::columns::get_extent (spoc::columns::point_columns ());
+    };
+    std::filesystem::path dir;
+    size_t extra_fields;
+    size_t max_points;
+    size_t buffered = 0;
+    std::map<size_t, tile> tiles;
+
+    std::filesystem::path get_spill_filename (const size_t t, const bool halo) const
+    {
+        return dir / ("tile" + std::to_string (t) + (halo ? ".halo" : "") + ".spill");
+    }
+
+    void spill (const size_t t, const bool halo)
+    {
+        auto &x = halo ? tiles.at (t).halo : tiles.at (t).owned;
+        std::ofstream ofs (get_spill_filename (t, halo), std::ios::binary | std::ios::app);
+        if (!ofs)
+            throw std::runtime_error ("Could not open a tile spill file for writing");
+        spoc::io::point_record_writer w (ofs, extra_fields);
+        w.write (x.buffer);
+        w.flush ();
+        if (!ofs)
+            throw std::runtime_error ("Error writing a tile spill file");
+        x.spilled += x.buffer.size ();
+        buffered -= x.buffer.size ();
+        x.buffer = spoc::columns::point_columns (0, extra_fields);
+    }
+
+    void spill_largest ()
+    {
+        // Spill the largest buffers until half of the budget is free,
+        // so that spills are large and infrequent
+        std::vector<std::tuple<size_t, size_t, bool>> sizes;
+        for (const auto &i : tiles)
+        {
+            if (!i.second.owned.buffer.empty ())
+                sizes.push_back ({ i.second.owned.buffer.size (), i.first, false });
+            if (!i.second.halo.buffer.empty ())
+                sizes.push_back ({ i.second.halo.buffer.size (), i.first, true });
+        }
+        std::sort (sizes.rbegin (), sizes.rend ());
+        for (const auto &i : sizes)
+        {
+            if (buffered <= max_points / 2)
+                break;
+            spill (std::get<1> (i), std::get<2> (i));
+        }
+    }
+
+    void add (part &x, const spoc::columns::point_columns &pc,
+        std::vector<size_t>::const_iterator first,
+        std::vector<size_t>::const_iterator last)
+    {
+        if (x.buffer.get_extra_fields () != extra_fields)
+            x.buffer.resize_extra_fields (extra_fields);
+        spoc::columns::gather (x.buffer, pc, first, last);
+    }
+
+    template<typename F>
+    void read (const size_t t, const bool halo, F &&f, const size_t chunk_size) const
+    {
+        const auto &x = halo ? tiles.at (t).halo : tiles.at (t).owned;
+        if (x.spilled != 0)
+        {
+            std::ifstream ifs (get_spill_filename (t, halo), std::ios::binary);
+            if (!ifs)
+                throw std::runtime_error ("Could not open a tile spill file for reading");
+            for (size_t i = 0; i < x.spilled; i += chunk_size)
+            {
+                const size_t n = std::min (chunk_size, x.spilled - i);
+                const auto pc = spoc::io::read_uncompressed_columns (ifs, n, extra_fields);
+                if (!ifs)
+                    throw std::runtime_error ("Error reading a tile spill file");
+                f (pc);
+            }
+        }
+        if (!x.buffer.empty ())
+            f (x.buffer);
+    }
+
+    public:
+    /// @brief CTOR
+    /// @param parent Directory in which the spill files' directory is made
+    /// @param extra_fields Number of extra fields in each record
+    /// @param max_points Maximum number of points to keep in memory
+    tile_spooler (const std::filesystem::path &parent,
+        const size_t extra_fields,
+        const size_t max_points = DEFAULT_MAX_POINTS_IN_MEMORY)
+        : extra_fields (extra_fields)
+        , max_points (max_points)
+    {
+        std::string d = (parent / "spoc_tile_XXXXXX").string ();
+        if (mkdtemp (d.data ()) == nullptr)
+            throw std::runtime_error ("Could not create a directory for the tile spill files");
+        dir = d;
+    }
+    tile_spooler (const tile_spooler &) = delete;
+    tile_spooler &operator= (const tile_spooler &) = delete;
+    /// @brief DTOR
+    ~tile_spooler ()
+    {
+        std::error_code ec;
+        std::filesystem::remove_all (dir, ec);
+    }
+
+    /// @brief Add points to their tiles
+    /// @param pc Point columns
+    /// @param indexes The tile index of each point, see get_tile_indexes()
+    /// @param owned The number of points that belong to their tiles. The
+    /// points after them are halo points, see add_halo_points().
+    void add (const spoc::columns::point_columns &pc,
+        const std::vector<size_t> &indexes,
+        const size_t owned = std::numeric_limits<size_t>::max ())
+    {
+        REQUIRE (pc.size () == indexes.size ());
+        if (pc.get_extra_fields () != extra_fields)
+            throw std::runtime_error ("The number of extra fields is incorrect");
+        const size_t n = std::min (owned, pc.size ());
+
+        // Group the points by tile, keeping their order within each
+        // tile, and the halo points after the owned points
+        std::vector<size_t> order (pc.size ());
+        std::iota (order.begin (), order.end (), 0);
+        std::stable_sort (order.begin (), order.end (),
+            [&](const size_t a, const size_t b)
+            {
+                return indexes[a] != indexes[b] ? indexes[a] < indexes[b] : (a < n && b >= n);
+            });
+
+        // Copy each group
+        for (auto first = order.cbegin (); first != order.cend (); )
+        {
+            const size_t t = indexes[*first];
+            const auto last = std::find_if (first, order.cend (),
+                [&](const size_t i) { return indexes[i] != t; });
+            const auto middle = std::find_if (first, last,
+                [&](const size_t i) { return i >= n; });
+            auto &x = tiles.try_emplace (t).first->second;
+            add (x.owned, pc, first, middle);
+            add (x.halo, pc, middle, last);
+            std::vector<spoc::point::point<double>> ps;
+            for (auto i = first; i != last; ++i)
+                ps.push_back ({ pc.x[*i], pc.y[*i], pc.z[*i] });
+            x.e = spoc::extent::get_total_extent (x.e, spoc::extent::get_finite_extent (ps));
+            first = last;
+        }
+
+        buffered += pc.size ();
+        if (buffered > max_points)
+            spill_largest ();
+    }
+
+    /// @brief Get the indexes of the tiles that have points of their
+    /// own, in order. Tiles that only have halo points are left out.
+    std::vector<size_t> get_tiles () const
+    {
+        std::vector<size_t> ts;
+        for (const auto &i : tiles)
+            if (i.second.owned.spilled != 0 || !i.second.owned.buffer.empty ())
+                ts.push_back (i.first);
+        return ts;
+    }
+
+    /// @brief Get the number of points in a tile, including its halo points
+    size_t get_total_points (const size_t t) const
+    {
+        const auto &x = tiles.at (t);
+        return x.owned.spilled + x.owned.buffer.size () + x.halo.spilled + x.halo.buffer.size ();
+    }
+
+    /// @brief Get the extent of the finite coordinates in a tile, see
+    /// extent::get_finite_extent()
+    const spoc::extent::extent &get_extent (const size_t t) const
+    {
+        return tiles.at (t).e;
+    }
+
+    /// @brief Get the number of points that are kept in memory
+    size_t get_buffered_points () const { return buffered; }
+
+    /// @brief Read the points in a tile, a chunk at a time
+    /// @param t Tile index
+    /// @param f Function that takes each 'columns::point_columns' chunk
+    /// @param chunk_size Maximum number of points in each chunk that is
+    /// read from a spill file. The points in memory are passed as one
+    /// chunk.
+    ///
+    /// The tile's own points are read first, and then its halo points.
+    template<typename F>
+    void read_tile (const size_t t, F &&f, const size_t chunk_size = spoc::io::DEFAULT_BLOCK_SIZE) const
+    {
+        REQUIRE (chunk_size != 0);
+        read (t, false, f, chunk_size);
+        read (t, true, f, chunk_size);
+    }
+};
+
+/// @brief Gather and write tiles on several threads
+/// @param pc Points to tile
+/// @param t Points grouped by tile, see get_tile_order()
+/// @param write_tile Function that takes a tile index and the
+/// 'columns::point_columns' in that tile, and writes them. It is called
+/// on several threads at once.
+/// @param jobs Number of tiles to write at a time
+/// @param max_points Maximum number of gathered points to hold at a
+/// time. A tile that is larger than this is written by itself.
+template<typename F>
+inline void write_tiles (const spoc::columns::point_columns &pc,
+    const tile_order &t,
+    F &&write_tile,
+    const size_t jobs = 1,
+    const size_t max_points = DEFAULT_MAX_POINTS_IN_MEMORY)
+{
+    REQUIRE (t.offsets.size () == t.tiles.size () + 1);
+
+    std::atomic<size_t> next (0);
+    std::mutex m;
+    std::condition_variable cv;
+    size_t in_flight = 0;
+    std::exception_ptr e;
+
+    const auto worker = [&]
+    {
+        for (size_t k = next++; k < t.tiles.size (); k = next++)
+        {
+            const size_t n = t.offsets[k + 1] - t.offsets[k];
+
+            // Wait for room
+            {
+                std::unique_lock<std::mutex> lock (m);
+                cv.wait (lock, [&] { return e || in_flight == 0 || in_flight + n <= max_points; });
+                if (e)
+                    return;
+                in_flight += n;
+            }
+
+            try
+            {
+                spoc::columns::point_columns q (0, pc.get_extra_fields ());
+                spoc::columns::gather (q, pc,
+                    t.order.begin () + t.offsets[k],
+                    t.order.begin () + t.offsets[k + 1]);
+                write_tile (t.tiles[k], q);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock (m);
+                if (!e)
+                    e = std::current_exception ();
+            }
+
+            {
+                std::lock_guard<std::mutex> lock (m);
+                in_flight -= n;
+            }
+            cv.notify_all ();
+        }
+    };
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < jobs; ++i)
+        threads.emplace_back (worker);
+    worker ();
+    for (auto &i : threads)
+        i.join ();
+
+    if (e)
+        std::rethrow_exception (e);
+}
+
 } // namespace tile_app
 
 } // namespace spoc
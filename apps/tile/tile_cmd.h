@@ -1,6 +1,7 @@
 #pragma once
 
 #include "spoc/cmd.h"
+#include "tile_defaults.h"
 #include <stdexcept>
 #include <string>
 
@@ -23,11 +24,22 @@ struct args
     double tile_size_y = -1;
     double target_tile_size = -1;
     std::string prefix;
+    std::string codec = "zlib";
+    int level = -1;
+    bool streaming = false;
+    size_t max_points_in_memory = spoc::tile_app::DEFAULT_MAX_POINTS_IN_MEMORY;
+    std::string temp_dir;
+    size_t jobs = 1;
+    size_t max_points_per_tile = 0;
+    double buffer = 0.0;
     std::string fn;
 };
 
 inline args get_args (int argc, char **argv, const std::string &usage)
 {
+    // Long-only options
+    enum { STREAMING = 256, TEMP_DIR };
+
     args args;
     while (1)
     {
@@ -44,10 +56,18 @@ inline args get_args (int argc, char **argv, const std::string &usage)
             {"tile-size-y", required_argument, 0, 'y'},
             {"target-tile-size", required_argument, 0, 'a'},
             {"prefix", required_argument, 0, 'p'},
+            {"codec", required_argument, 0, 'c'},
+            {"level", required_argument, 0, 'l'},
+            {"streaming", no_argument, 0, STREAMING},
+            {"max-points-in-memory", required_argument, 0, 'm'},
+            {"temp-dir", required_argument, 0, TEMP_DIR},
+            {"jobs", required_argument, 0, 'j'},
+            {"max-points-per-tile", required_argument, 0, 'n'},
+            {"buffer", required_argument, 0, 'b'},
             {0, 0, 0, 0}
         };
 
-        int c = getopt_long(argc, argv, "hveft:d:s:x:y:p:a:", long_options, &option_index);
+        int c = getopt_long(argc, argv, "hveft:d:s:x:y:p:a:c:l:m:j:n:b:", long_options, &option_index);
         if (c == -1)
             break;
 
@@ -73,6 +93,14 @@ inline args get_args (int argc, char **argv, const std::string &usage)
             case 'y': args.tile_size_y = atof (optarg); break;
             case 'p': args.prefix = std::string (optarg); break;
             case 'a': args.target_tile_size = atof (optarg); break;
+            case 'c': args.codec = std::string (optarg); break;
+            case 'l': args.level = atoi (optarg); break;
+            case STREAMING: args.streaming = true; break;
+            case 'm': args.max_points_in_memory = atoll (optarg); break;
+            case TEMP_DIR: args.temp_dir = std::string (optarg); break;
+            case 'j': args.jobs = spoc::cmd::get_jobs (optarg); break;
+            case 'n': args.max_points_per_tile = atoll (optarg); break;
+            case 'b': args.buffer = atof (optarg); break;
         }
     }
 
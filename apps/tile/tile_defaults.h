@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstddef>
+
+namespace spoc
+{
+
+namespace tile_app
+{
+
+/// Default maximum number of points that a tile_spooler keeps in memory
+constexpr size_t DEFAULT_MAX_POINTS_IN_MEMORY = 1 << 22;
+
+} // namespace tile_app
+
+} // namespace spoc
@@ -54,19 +54,23 @@ int main (int argc, char **argv)
         // Get the input stream
         input_stream is (args.verbose, args.input_fn);
 
-        // Read the input file
-        spoc_file f = read_spoc_file (is ());
-
         if (args.command.name == "get-field")
         {
             string s = args.command.params;
             const auto l = consume_field_name (s);
+
+            // Only read the requested field
+            const spoc_file f = read_spoc_file (is (), spoc::columns::field_mask {l});
             get_field (f, cout, l);
 
             // Short-circuit so that the SPOC file is not written
             return 0;
         }
-        else if (args.command.name == "recenter-xy")
+
+        // Read the input file
+        spoc_file f = read_spoc_file (is ());
+
+        if (args.command.name == "recenter-xy")
             f = recenter (f);
         else if (args.command.name == "recenter-xyz")
             f = recenter (f, true);
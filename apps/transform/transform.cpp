@@ -43,6 +43,8 @@ int main (int argc, char **argv)
         {
             clog << "verbose\t" << args.verbose << endl;
             clog << "random-seed\t" << args.random_seed << endl;
+            clog << "compress\t" << args.compress << endl;
+            clog << "jobs\t" << args.jobs << endl;
             clog << "commands:" << endl;
             for (auto c : args.commands)
                 clog << "\t" << c.name << "\t" << c.params << endl;
@@ -55,7 +57,7 @@ int main (int argc, char **argv)
         output_stream os (args.verbose, args.output_fn);
 
         // Apply each command in order they appeared on command line
-        apply (is (), os (), args.commands, args.random_seed);
+        apply (is (), os (), args.commands, args.random_seed, args.compress, args.jobs);
 
         return 0;
     }
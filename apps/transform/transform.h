@@ -2,10 +2,14 @@
 
 #include "spoc/app_utils.h"
 #include "spoc/spoc.h"
+#include <algorithm>
 #include <cassert>
+#include <functional>
+#include <future>
 #include <iostream>
 #include <limits>
-#include <random>
+#include <string>
+#include <type_traits>
 #include <vector>
 #include <unordered_map>
 
@@ -38,128 +42,97 @@ const spoc::header::header read_header_uncompressed (std::istream &is)
 
 }
 
-using PR = spoc::point_record::point_record;
-using OP = std::function<PR(PR)>;
+using BLOCK = spoc::columns::point_columns;
+/// An operation on a block of points. The second argument is the index
+/// of the block's first point in the file.
+using OP = std::function<void(BLOCK &, size_t)>;
 
-OP get_add_x_op (double v)
+namespace detail
 {
-    OP op = [=] (PR p) { p.x += v; return p; };
-    return op;
-}
 
-OP get_add_y_op (double v)
+// Get the column index of a field name, see columns::visit_column()
+inline size_t get_field_index (const std::string &field_name, const size_t extra_fields)
 {
-    OP op = [=] (PR p) { p.y += v; return p; };
-    return op;
+    using namespace spoc::app_utils;
+
+    if (!is_extra_field (field_name))
+        return std::string ("xyzcpirgb").find (field_name[0]);
+
+    const int j = get_extra_index (field_name);
+    if (j < 0 || static_cast<size_t> (j) >= extra_fields)
+        throw std::runtime_error ("Invalid extra field specification");
+    return spoc::columns::FIXED_FIELDS + j;
 }
 
-OP get_add_z_op (double v)
+// Check that a field is not a floating point field
+inline void check_integer_field (const std::string &field_name, const std::string &command)
 {
-    OP op = [=] (PR p) { p.z += v; return p; };
-    return op;
+    switch (field_name[0])
+    {
+        case 'x':
+        case 'y':
+        case 'z':
+            throw std::runtime_error ("Cannot run the " + command + " command on floating point fields (X, Y, Z)");
+    }
+}
+
 }
 
 OP get_copy_field_op (const std::string &field_name1,
     const std::string &field_name2,
     const size_t extra_fields)
 {
-    using namespace spoc::app_utils;
-
     // Check to make sure x, y, z, is not being used
-    switch (field_name1[0])
-    {
-        case 'x':
-        case 'y':
-        case 'z':
-            throw std::runtime_error ("Cannot run the copy command on floating point fields (X, Y, Z)");
-    }
-    switch (field_name2[0])
-    {
-        case 'x':
-        case 'y':
-        case 'z':
-            throw std::runtime_error ("Cannot run the copy command on floating point fields (X, Y, Z)");
-    }
+    detail::check_integer_field (field_name1, "copy");
+    detail::check_integer_field (field_name2, "copy");
 
-    // Get the extra indexes
-    const size_t j1 = is_extra_field (field_name1)
-        ? get_extra_index (field_name1)
-        : extra_fields + 1;
-    const size_t j2 = is_extra_field (field_name2)
-        ? get_extra_index (field_name2)
-        : extra_fields + 1;
+    // Get the column indexes
+    const size_t j1 = detail::get_field_index (field_name1, extra_fields);
+    const size_t j2 = detail::get_field_index (field_name2, extra_fields);
 
     // Get the operation
-    OP op = [=] (PR p)
+    OP op = [=] (BLOCK &b, size_t)
     {
-        // Get the value of the source field
-        size_t src = 0;
-        switch (field_name1[0])
-        {
-            case 'c': src = p.c; break;
-            case 'p': src = p.p; break;
-            case 'i': src = p.i; break;
-            case 'r': src = p.r; break;
-            case 'g': src = p.g; break;
-            case 'b': src = p.b; break;
-            case 'e': // extra
-            {
-                assert (is_extra_field (field_name1));
-                if (j1 >= p.extra.size ())
-                    throw std::runtime_error ("Invalid extra field specification");
-                src = p.extra[j1];
-            }
-            break;
-        }
-
-        // Set it in the dest field
-        switch (field_name2[0])
+        spoc::columns::visit_column (b, j1, [&] (const auto &src)
         {
-            case 'c': p.c = src; break;
-            case 'p': p.p = src; break;
-            case 'i': p.i = src; break;
-            case 'r': p.r = src; break;
-            case 'g': p.g = src; break;
-            case 'b': p.b = src; break;
-            case 'e': // extra
+            spoc::columns::visit_column (b, j2, [&] (auto &dst)
             {
-                assert (is_extra_field (field_name2));
-                if (j2 >= p.extra.size ())
-                    throw std::runtime_error ("Invalid extra field specification");
-                p.extra[j2] = src;
-            }
-            break;
-        }
-
-        return p;
+                using T = typename std::decay_t<decltype (dst)>::value_type;
+                for (size_t k = 0; k < b.size (); ++k)
+                    dst[k] = static_cast<T> (static_cast<size_t> (src[k]));
+            });
+        });
     };
 
     return op;
 }
 
 OP get_gaussian_noise_op (const size_t random_seed,
+    const size_t stream,
     const double std_x,
     const double std_y,
     const double std_z)
 {
     // Create rng
-    std::default_random_engine rng (random_seed);
-
-    // Create the distributions
-    std::normal_distribution<double> dx (0.0, std_x);
-    std::normal_distribution<double> dy (0.0, std_y);
-    std::normal_distribution<double> dz (0.0, std_z);
+    const spoc::utils::counter_rng rng (random_seed, stream);
 
     // Get the operation
-    OP op = [=] (PR p) mutable
+    //
+    // Each number comes from the point's index in the file, so the noise
+    // does not depend on the block size, or on the order that blocks
+    // are transformed in
+    OP op = [=] (BLOCK &b, const size_t first)
     {
-        if (std_x != 0.0)
-            p.x += dx (rng);
-        if (std_y != 0.0)
-            p.y += dy (rng);
-        if (std_z != 0.0)
-            p.z += dz (rng);
-        return p;
+        for (size_t k = 0; k < b.size (); ++k)
+        {
+            const uint64_t n = 3 * (first + k);
+            if (std_x != 0.0)
+                b.x[k] += std_x * rng.gaussian (n);
+            if (std_y != 0.0)
+                b.y[k] += std_y * rng.gaussian (n + 1);
+            if (std_z != 0.0)
+                b.z[k] += std_z * rng.gaussian (n + 2);
+        }
     };
 
     return op;
@@ -169,13 +142,11 @@ OP get_gaussian_noise_op (const size_t random_seed,
 OP get_quantize_op (const double precision)
 {
     // Get the operation
-    OP op = [=] (PR p)
+    OP op = [=] (BLOCK &b, size_t)
     {
-        // Quantize the point
-        p.x = static_cast<int> (p.x / precision) * precision;
-        p.y = static_cast<int> (p.y / precision) * precision;
-        p.z = static_cast<int> (p.z / precision) * precision;
-        return p;
+        for (auto v : { &b.x, &b.y, &b.z })
+            for (auto &i : *v)
+                i = static_cast<int> (i / precision) * precision;
     };
 
     return op;
@@ -187,45 +158,21 @@ OP get_replace_op (const std::string &field_name,
     const unsigned v2,
     const size_t extra_fields)
 {
-    using namespace spoc::app_utils;
-
     // Check to make sure x, y, z, is not being used
-    switch (field_name[0])
-    {
-        case 'x': throw std::runtime_error ("Cannot run the replace command on floating point fields (X, Y, Z)");
-        case 'y': throw std::runtime_error ("Cannot run the replace command on floating point fields (X, Y, Z)");
-        case 'z': throw std::runtime_error ("Cannot run the replace command on floating point fields (X, Y, Z)");
-    }
+    detail::check_integer_field (field_name, "replace");
 
-    // Get the extra index
-    const size_t j = is_extra_field (field_name)
-        ? get_extra_index (field_name)
-        : extra_fields + 1;
+    // Get the column index
+    const size_t j = detail::get_field_index (field_name, extra_fields);
 
     // Get the operation
-    OP op = [=] (PR p)
+    OP op = [=] (BLOCK &b, size_t)
     {
-        // Process the point
-        switch (field_name[0])
+        spoc::columns::visit_column (b, j, [&] (auto &v)
         {
-            case 'c': if (p.c == v1) p.c = v2; break;
-            case 'p': if (p.p == v1) p.p = v2; break;
-            case 'i': if (p.i == v1) p.i = v2; break;
-            case 'r': if (p.r == v1) p.r = v2; break;
-            case 'g': if (p.g == v1) p.g = v2; break;
-            case 'b': if (p.b == v1) p.b = v2; break;
-            case 'e': // extra
-            {
-                assert (is_extra_field (field_name));
-                if (j >= p.extra.size ())
-                    throw std::runtime_error ("Invalid extra field specification");
-                if (p.extra[j] == v1)
-                    p.extra[j] = v2;
-            }
-            break;
-        }
-
-        return p;
+            for (auto &i : v)
+                if (i == v1)
+                    i = v2;
+        });
     };
 
     return op;
@@ -236,15 +183,8 @@ OP get_replace_not_op (const std::string &field_name,
     std::vector<unsigned> v,
     const size_t extra_fields)
 {
-    using namespace spoc::app_utils;
-
     // Check to make sure x, y, z, is not being used
-    switch (field_name[0])
-    {
-        case 'x': throw std::runtime_error ("Cannot run the replace command on floating point fields (X, Y, Z)");
-        case 'y': throw std::runtime_error ("Cannot run the replace command on floating point fields (X, Y, Z)");
-        case 'z': throw std::runtime_error ("Cannot run the replace command on floating point fields (X, Y, Z)");
-    }
+    detail::check_integer_field (field_name, "replace");
 
     // Get the last value from the vector for the value to replace with
     if (v.size () < 2)
@@ -256,259 +196,164 @@ OP get_replace_not_op (const std::string &field_name,
     // Remove it
     v.pop_back ();
 
-    // Get the extra index
-    const size_t j = is_extra_field (field_name)
-        ? get_extra_index (field_name)
-        : extra_fields + 1;
+    // Get the column index
+    const size_t j = detail::get_field_index (field_name, extra_fields);
 
     // Get the operation
-    OP op = [=] (PR p)
+    OP op = [=] (BLOCK &b, size_t)
     {
-        // Assume that it will get replaced
-        bool replace = true;
-
-        // For each value in the list
-        for (auto i : v)
+        spoc::columns::visit_column (b, j, [&] (auto &x)
         {
             // If the field's value is equal to one of those in the
             // list, it does not get replaced
-            switch (field_name[0])
-            {
-                case 'c': if (p.c == i) replace = false; break;
-                case 'p': if (p.p == i) replace = false; break;
-                case 'i': if (p.i == i) replace = false; break;
-                case 'r': if (p.r == i) replace = false; break;
-                case 'g': if (p.g == i) replace = false; break;
-                case 'b': if (p.b == i) replace = false; break;
-                case 'e': // extra
-                {
-                    assert (is_extra_field (field_name));
-                    if (j >= p.extra.size ())
-                        throw std::runtime_error ("Invalid extra field specification");
-                    if (p.extra[j] == i)
-                        replace = false;
-                }
-                break;
-            }
-
-            // Short circuit if you can
-            if (replace == false)
-                break;
-        }
-
-        // Replace if needed
-        if (replace)
-        {
-            switch (field_name[0])
-            {
-                case 'c': p.c = r; break;
-                case 'p': p.c = r; break;
-                case 'i': p.c = r; break;
-                case 'r': p.c = r; break;
-                case 'g': p.c = r; break;
-                case 'b': p.c = r; break;
-                case 'e': // extra
-                {
-                    assert (is_extra_field (field_name));
-                    p.extra[j] = r;
-                }
-                break;
-            }
-        }
-
-        return p;
-    };
-
-    return op;
-}
-
-OP get_rotate_x_op (const double degrees)
-{
-    // Convert degrees to radians
-    const double r = degrees * M_PI / 180.0;
-
-    // Get the operation
-    OP op = [=] (PR p)
-    {
-        // Rotate the point about X axis
-        const auto y = p.y * cos (r) - p.z * sin (r);
-        const auto z = p.y * sin (r) + p.z * cos (r);
-        p.y = y;
-        p.z = z;
-        return p;
+            for (auto &i : x)
+                if (std::find (v.begin (), v.end (), i) == v.end ())
+                    i = r;
+        });
     };
 
     return op;
 }
 
-OP get_rotate_y_op (const double degrees)
-{
-    // Convert degrees to radians
-    const double r = degrees * M_PI / 180.0;
-
-    // Get the operation
-    OP op = [=] (PR p)
-    {
-        // Rotate the point about Y axis
-        const auto x =  p.x * cos (r) + p.z * sin (r);
-        const auto z = -p.x * sin (r) + p.z * cos (r);
-        p.x = x;
-        p.z = z;
-        return p;
-    };
-
-    return op;
-}
-
-OP get_rotate_z_op (const double degrees)
-{
-    // Convert degrees to radians
-    const double r = degrees * M_PI / 180.0;
-
-    // Get the operation
-    OP op = [=] (PR p)
-    {
-        // Rotate the point about Z axis
-        const auto x = p.x * cos (r) - p.y * sin (r);
-        const auto y = p.x * sin (r) + p.y * cos (r);
-        p.x = x;
-        p.y = y;
-        return p;
-    };
-
-    return op;
-}
-
-OP get_scale_x_op (double v)
-{
-    OP op = [=] (PR p) { p.x *= v; return p; };
-    return op;
-}
-
-OP get_scale_y_op (double v)
-{
-    OP op = [=] (PR p) { p.y *= v; return p; };
-    return op;
-}
-
-OP get_scale_z_op (double v)
-{
-    OP op = [=] (PR p) { p.z *= v; return p; };
-    return op;
-}
-
 OP get_set_op (const std::string &field_name, const double v, const size_t extra_fields)
 {
-    using namespace spoc::app_utils;
-
-    // Get the extra index
-    const size_t j = is_extra_field (field_name)
-        ? get_extra_index (field_name)
-        : extra_fields + 1;
+    // Get the column index
+    const size_t j = detail::get_field_index (field_name, extra_fields);
 
     // Get the operation
-    OP op = [=] (PR p)
+    OP op = [=] (BLOCK &b, size_t)
     {
-        switch (field_name[0])
+        spoc::columns::visit_column (b, j, [&] (auto &x)
         {
-            case 'x': p.x = v; break;
-            case 'y': p.y = v; break;
-            case 'z': p.z = v; break;
-            case 'c': p.c = v; break;
-            case 'p': p.p = v; break;
-            case 'i': p.i = v; break;
-            case 'r': p.r = v; break;
-            case 'g': p.g = v; break;
-            case 'b': p.b = v; break;
-            case 'e': // extra
-            {
-                assert (is_extra_field (field_name));
-                if (j >= p.extra.size ())
-                    throw std::runtime_error ("Invalid extra field specification");
-                p.extra[j] = v;
-            }
-            break;
-        }
-
-        return p;
+            using T = typename std::decay_t<decltype (x)>::value_type;
+            std::fill (x.begin (), x.end (), static_cast<T> (v));
+        });
     };
 
     return op;
 }
 
 OP get_uniform_noise_op (const size_t random_seed,
+    const size_t stream,
     const double mag_x,
     const double mag_y,
     const double mag_z)
 {
     // Create rng
-    std::default_random_engine rng (random_seed);
-
-    // Create the distributions
-    std::uniform_real_distribution<double> dx (-mag_x, mag_x);
-    std::uniform_real_distribution<double> dy (-mag_y, mag_y);
-    std::uniform_real_distribution<double> dz (-mag_z, mag_z);
+    const spoc::utils::counter_rng rng (random_seed, stream);
 
     // Get the operation
-    OP op = [=] (PR p) mutable
+    OP op = [=] (BLOCK &b, const size_t first)
     {
-        if (mag_x != 0.0)
-            p.x += dx (rng);
-        if (mag_y != 0.0)
-            p.y += dy (rng);
-        if (mag_z != 0.0)
-            p.z += dz (rng);
-        return p;
+        for (size_t k = 0; k < b.size (); ++k)
+        {
+            const uint64_t n = 3 * (first + k);
+            if (mag_x != 0.0)
+                b.x[k] += mag_x * (2.0 * rng.uniform (n) - 1.0);
+            if (mag_y != 0.0)
+                b.y[k] += mag_y * (2.0 * rng.uniform (n + 1) - 1.0);
+            if (mag_z != 0.0)
+                b.z[k] += mag_z * (2.0 * rng.uniform (n + 2) - 1.0);
+        }
     };
 
     return op;
 }
 
-template<typename T>
-void apply (std::istream &is,
-    std::ostream &os,
-    const T &commands,
-    const size_t random_seed)
+/// @brief A sequence of operations on blocks of points
+///
+/// Runs of affine operations, like offsets, rotations, and scales, are
+/// composed into a single matrix, so X, Y, and Z are swept once for
+/// each run, and sines and cosines are computed once.
+class block_transform
 {
-    // Check preconditions
-    REQUIRE (is.good ());
-    REQUIRE (os.good ());
-
-    // Read the header and make sure it's uncompressed
-    const auto h = detail::read_header_uncompressed (is);
-    REQUIRE (h.is_valid ());
-
-    // Write the same header to the output stream
-    write_header (os, h);
-
-    using PR = spoc::point_record::point_record;
-    std::vector<std::function<PR(PR)>> ops;
+    private:
+    struct step
+    {
+        spoc::affine::matrix m;
+        OP op;
+    };
+    std::vector<step> steps;
 
+    public:
+    /// @brief Add an affine operation
+    /// @param m Transform matrix
+    void push_back (const spoc::affine::matrix &m)
+    {
+        if (steps.empty () || steps.back ().op)
+            steps.push_back ({ m, OP () });
+        else
+            steps.back ().m = spoc::affine::multiply (m, steps.back ().m);
+    }
+    /// @brief Add an operation
+    /// @param op Operation
+    void push_back (OP op)
+    {
+        steps.push_back ({ spoc::affine::identity_matrix (), std::move (op) });
+    }
+    /// @brief Get the number of passes over each block
+    size_t size () const { return steps.size (); }
+
+    /// @brief Transform a block of points in place
+    /// @param b Points
+    /// @param first Index of the block's first point in the file
+    ///
+    /// The operations don't hold any state, so blocks can be transformed
+    /// in any order, and at the same time.
+    void operator() (BLOCK &b, const size_t first = 0) const
+    {
+        for (const auto &i : steps)
+        {
+            if (i.op)
+                i.op (b, first);
+            else
+                spoc::affine::transform (i.m, b.x, b.y, b.z);
+        }
+    }
+};
+
+/// @brief Get the block transform for a list of commands
+/// @param commands Commands
+/// @param random_seed Seed for the noise operations
+/// @param extra_fields Number of extra fields in each point
+///
+/// Each noise command draws from its own stream of random numbers, so
+/// repeating a command adds different noise.
+template<typename T>
+block_transform get_block_transform (const T &commands,
+    const size_t random_seed,
+    const size_t extra_fields)
+{
+    using namespace spoc::affine;
     using namespace spoc::app_utils;
 
+    block_transform t;
+
     // Check the commands
+    size_t stream = 0;
     for (auto c : commands)
     {
+        ++stream;
         if (c.name == "add-x")
         {
             // Get offset
             std::string s = c.params;
             const auto v = consume_double (s);
-            ops.push_back (get_add_x_op (v));
+            t.push_back (translation (v, 0.0, 0.0));
         }
         else if (c.name == "add-y")
         {
             // Get offset
             std::string s = c.params;
             const auto v = consume_double (s);
-            ops.push_back (get_add_y_op (v));
+            t.push_back (translation (0.0, v, 0.0));
         }
         else if (c.name == "add-z")
         {
             // Get offset
             std::string s = c.params;
             const auto v = consume_double (s);
-            ops.push_back (get_add_z_op (v));
+            t.push_back (translation (0.0, 0.0, v));
         }
         else if (c.name == "copy-field")
         {
@@ -516,42 +361,42 @@ void apply (std::istream &is,
             std::string s = c.params;
             const auto f1 = consume_field_name (s);
             const auto f2 = consume_field_name (s);
-            ops.push_back (get_copy_field_op (f1, f2, h.extra_fields));
+            t.push_back (get_copy_field_op (f1, f2, extra_fields));
         }
         else if (c.name == "gaussian-noise")
         {
             // Get variance for X, Y, Z
             std::string s = c.params;
             const auto v = consume_double (s);
-            ops.push_back (get_gaussian_noise_op (random_seed, v, v, v));
+            t.push_back (get_gaussian_noise_op (random_seed, stream, v, v, v));
         }
         else if (c.name == "gaussian-noise-x")
         {
             // Get variance for X
             std::string s = c.params;
             const auto v = consume_double (s);
-            ops.push_back (get_gaussian_noise_op (random_seed, v, 0.0, 0.0));
+            t.push_back (get_gaussian_noise_op (random_seed, stream, v, 0.0, 0.0));
         }
         else if (c.name == "gaussian-noise-y")
         {
             // Get variance for Y
             std::string s = c.params;
             const auto v = consume_double (s);
-            ops.push_back (get_gaussian_noise_op (random_seed, 0.0, v, 0.0));
+            t.push_back (get_gaussian_noise_op (random_seed, stream, 0.0, v, 0.0));
         }
         else if (c.name == "gaussian-noise-z")
         {
             // Get variance for Z
             std::string s = c.params;
             const auto v = consume_double (s);
-            ops.push_back (get_gaussian_noise_op (random_seed, 0.0, 0.0, v));
+            t.push_back (get_gaussian_noise_op (random_seed, stream, 0.0, 0.0, v));
         }
         else if (c.name == "quantize-xyz")
         {
             // Get precision
             std::string s = c.params;
             const auto v = consume_double (s);
-            ops.push_back (get_quantize_op (v));
+            t.push_back (get_quantize_op (v));
         }
         else if (c.name == "replace")
         {
@@ -560,7 +405,7 @@ void apply (std::istream &is,
             const auto l = consume_field_name (s);
             const auto v1 = consume_int (s);
             const auto v2 = consume_int (s);
-            ops.push_back (get_replace_op (l, v1, v2, h.extra_fields));
+            t.push_back (get_replace_op (l, v1, v2, extra_fields));
         }
         else if (c.name == "replace-not")
         {
@@ -568,49 +413,49 @@ void apply (std::istream &is,
             std::string s = c.params;
             const auto l = consume_field_name (s);
             auto v = consume_ints (s);
-            ops.push_back (get_replace_not_op (l, v, h.extra_fields));
+            t.push_back (get_replace_not_op (l, v, extra_fields));
         }
         else if (c.name == "rotate-x")
         {
             // Get degrees
             std::string s = c.params;
             const auto v = consume_double (s);
-            ops.push_back (get_rotate_x_op (v));
+            t.push_back (rotation_x (v));
         }
         else if (c.name == "rotate-y")
         {
             // Get degrees
             std::string s = c.params;
             const auto v = consume_double (s);
-            ops.push_back (get_rotate_y_op (v));
+            t.push_back (rotation_y (v));
         }
         else if (c.name == "rotate-z")
         {
             // Get degrees
             std::string s = c.params;
             const auto v = consume_double (s);
-            ops.push_back (get_rotate_z_op (v));
+            t.push_back (rotation_z (v));
         }
         else if (c.name == "scale-x")
         {
             // Get magnitude
             std::string s = c.params;
             const auto v = consume_double (s);
-            ops.push_back (get_scale_x_op (v));
+            t.push_back (scaling (v, 1.0, 1.0));
         }
         else if (c.name == "scale-y")
         {
             // Get magnitude
             std::string s = c.params;
             const auto v = consume_double (s);
-            ops.push_back (get_scale_y_op (v));
+            t.push_back (scaling (1.0, v, 1.0));
         }
         else if (c.name == "scale-z")
         {
             // Get magnitude
             std::string s = c.params;
             const auto v = consume_double (s);
-            ops.push_back (get_scale_z_op (v));
+            t.push_back (scaling (1.0, 1.0, v));
         }
         else if (c.name == "set")
         {
@@ -618,59 +463,133 @@ void apply (std::istream &is,
             std::string s = c.params;
             const auto l = consume_field_name (s);
             const auto v = consume_double (s);
-            ops.push_back (get_set_op (l, v, h.extra_fields));
+            t.push_back (get_set_op (l, v, extra_fields));
         }
         else if (c.name == "uniform-noise")
         {
             // Get magnitude
             std::string s = c.params;
             const auto v = consume_double (s);
-            ops.push_back (get_uniform_noise_op (random_seed, v, v, v));
+            t.push_back (get_uniform_noise_op (random_seed, stream, v, v, v));
         }
         else if (c.name == "uniform-noise-x")
         {
             // Get magnitude
             std::string s = c.params;
             const auto v = consume_double (s);
-            ops.push_back (get_uniform_noise_op (random_seed, v, 0.0, 0.0));
+            t.push_back (get_uniform_noise_op (random_seed, stream, v, 0.0, 0.0));
         }
         else if (c.name == "uniform-noise-y")
         {
             // Get magnitude
             std::string s = c.params;
             const auto v = consume_double (s);
-            ops.push_back (get_uniform_noise_op (random_seed, 0.0, v, 0.0));
+            t.push_back (get_uniform_noise_op (random_seed, stream, 0.0, v, 0.0));
         }
         else if (c.name == "uniform-noise-z")
         {
             // Get magnitude
             std::string s = c.params;
             const auto v = consume_double (s);
-            ops.push_back (get_uniform_noise_op (random_seed, 0.0, 0.0, v));
+            t.push_back (get_uniform_noise_op (random_seed, stream, 0.0, 0.0, v));
         }
         else
             throw std::runtime_error (std::string ("An unknown command was encountered: ") + c.name);
     }
 
-    // Process the points
-    for (size_t i = 0; i < h.total_points; ++i)
+    return t;
+}
+
+/// @brief Transform the points in a file
+/// @param is Input stream
+/// @param os Output stream
+/// @param commands Commands, applied in order
+/// @param random_seed Seed for the noise operations
+/// @param compress Compress the output
+/// @param jobs Number of blocks to transform at the same time
+///
+/// The output does not depend on the number of jobs.
+template<typename T>
+void apply (std::istream &is,
+    std::ostream &os,
+    const T &commands,
+    const size_t random_seed,
+    const bool compress = false,
+    const size_t jobs = 1)
+{
+    // Check preconditions
+    REQUIRE (is.good ());
+    REQUIRE (os.good ());
+    REQUIRE (jobs > 0);
+
+    // Read the header and make sure it's uncompressed
+    auto h = detail::read_header_uncompressed (is);
+    REQUIRE (h.is_valid ());
+
+    // Get the operations
+    const auto t = get_block_transform (commands, random_seed, h.extra_fields);
+
+    // Process the points a block at a time
+    const auto process = [&](auto &w)
     {
-        // Read a point
-        auto p = spoc::point_record::read_point_record (is, h.extra_fields);
-
-        // Apply each operation, one by one
-        //
-        // The reference to 'op' is required because some operations
-        // hold state that is changed, like for example a random
-        // number generator. Cppcheck is an error for suggesting
-        // otherwise.
-        for (const auto &op : ops)
-            p = op (p);
-
-        // Write it back out
-        write_point_record (os, p);
-    }
+        spoc::io::point_record_reader r (is, h);
+        size_t first = 0;
+        if (jobs == 1)
+        {
+            for (auto b = r.read_columns (spoc::io::DEFAULT_BLOCK_SIZE); !b.empty ();
+                b = r.read_columns (spoc::io::DEFAULT_BLOCK_SIZE))
+            {
+                t (b, first);
+                first += b.size ();
+                w.write (b);
+            }
+            return;
+        }
 
+        // Read up to 'jobs' blocks, transform them at the same time, and
+        // write them in order
+        std::vector<BLOCK> bs (jobs);
+        std::vector<std::future<void>> fs (jobs);
+        for (bool done = false; !done; )
+        {
+            size_t n = 0;
+            while (n < jobs)
+            {
+                bs[n] = r.read_columns (spoc::io::DEFAULT_BLOCK_SIZE);
+                if (bs[n].empty ())
+                {
+                    done = true;
+                    break;
+                }
+                fs[n] = std::async (std::launch::async,
+                    [&, n, first] { t (bs[n], first); });
+                first += bs[n].size ();
+                ++n;
+            }
+            for (size_t i = 0; i < n; ++i)
+                fs[i].get ();
+            for (size_t i = 0; i < n; ++i)
+                w.write (bs[i]);
+        }
+    };
+
+    if (compress)
+    {
+        // Compress the points as they stream through
+        spoc::io::compressed_writer w (os, h.wkt, h.extra_fields);
+        process (w);
+        w.close ();
+    }
+    else
+    {
+        // Write the same header to the output stream. The points are
+        // transformed as they stream through, so the extent isn't known.
+        h.e.reset ();
+        write_header (os, h);
+        spoc::io::point_record_writer w (os, h);
+        process (w);
+        w.close ();
+    }
 }
 
 } // namespace transform_app
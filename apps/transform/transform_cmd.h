@@ -23,6 +23,8 @@ struct args
     bool help = false;
     bool verbose = false;
     bool version = false;
+    bool compress = false;
+    size_t jobs = 1;
     std::vector<spoc::transform_cmd::command> commands;
     size_t random_seed = 0;
     std::string input_fn;
@@ -74,6 +76,8 @@ inline args get_args (int argc, char **argv, const std::string &usage)
             {"help", no_argument, 0, 'h'},
             {"verbose", no_argument, 0, 'v'},
             {"version", no_argument, 0, 'e'},
+            {"compress", no_argument, 0, 'z'},
+            {"jobs", required_argument, 0, 'j'},
             {"add-x", required_argument, 0, ADD_X},
             {"add-y", required_argument, 0, ADD_Y},
             {"add-z", required_argument, 0, ADD_Z},
@@ -100,7 +104,7 @@ inline args get_args (int argc, char **argv, const std::string &usage)
             {0, 0, 0, 0}
         };
 
-        int c = getopt_long(argc, argv, "hve", long_options, &option_index);
+        int c = getopt_long(argc, argv, "hvezj:", long_options, &option_index);
         if (c == -1)
             break;
 
@@ -118,6 +122,8 @@ inline args get_args (int argc, char **argv, const std::string &usage)
             }
             case 'v': { args.verbose = true; break; }
             case 'e': { args.version = true; break; }
+            case 'z': { args.compress = true; break; }
+            case 'j': { args.jobs = spoc::cmd::get_jobs (optarg); break; }
             case ADD_X:
             {
                 args.commands.push_back (get_command ("add-x", optarg));
@@ -34,6 +34,26 @@ void benchmark_write_uncompressed (const T &p, const size_t extra_fields)
     clog << t.elapsed_ms () << "ms" << endl;
 }
 
+template<typename T>
+void benchmark_write_uncompressed_buffered (const T &p, const size_t extra_fields)
+{
+    ofstream ofs (fn);
+    if (!ofs)
+        throw runtime_error ("Can't open file for writing");
+
+    clog << "Writing " << p.size () << " point records uncompressed, buffered" << endl;
+
+    // Write them to the stream and time it
+    timer t;
+
+    point_record_writer w (ofs, extra_fields);
+    for (const auto &i : p)
+        w.write (i);
+    w.flush ();
+
+    clog << t.elapsed_ms () << "ms" << endl;
+}
+
 template<typename T>
 void benchmark_read_uncompressed (const T &p, const size_t extra_fields)
 {
@@ -43,8 +63,8 @@ void benchmark_read_uncompressed (const T &p, const size_t extra_fields)
         throw runtime_error ("Can't open file for writing");
 
     // Write them to the stream
-    for (const auto &i : p)
-        write_point_record (ofs, i);
+    point_record_writer w (ofs, extra_fields);
+    w.write (p);
     }
 
     clog << "Reading " << p.size () << " point records uncompressed" << endl;
@@ -119,6 +139,7 @@ int main (int argc, char **argv)
         std::cout.imbue (l);
 
         benchmark_write_uncompressed (p, extra_fields);
+        benchmark_write_uncompressed_buffered (p, extra_fields);
         benchmark_read_uncompressed (p, extra_fields);
         benchmark_write_compressed (p, extra_fields);
         benchmark_read_compressed (p, extra_fields);
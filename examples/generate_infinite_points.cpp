@@ -17,12 +17,13 @@ int main (int argc, char **argv)
 
     try
     {
-        // Create a header with effectively infinite points
+        // Create a streaming header, since the number of points isn't
+        // known
         const string wkt = "Test WKT";
         const size_t extra_fields = 4;
-        const size_t total_points = numeric_limits<size_t>::max ();
         const bool compressed = false;
-        header h (wkt, extra_fields, total_points, compressed);
+        header h (wkt, extra_fields, 0, compressed);
+        h.streaming = true;
 
         // Write it
         write_header (cout, h);
@@ -34,6 +35,9 @@ int main (int argc, char **argv)
         clog << "Generating points to stdout" << endl;
         clog << "Press CRTL-C to stop" << endl;
 
+        // Stage points and write them out in large blocks
+        point_record_writer w (cout, h);
+
         // Infinite loop
         for/*ever*/ (;;)
         {
@@ -46,7 +50,7 @@ int main (int argc, char **argv)
             p.z = d (g);
 
             // Write it
-            write_point_record (cout, p);
+            w.write (p);
         }
 
         return 0;
@@ -33,17 +33,19 @@ int main (int argc, char **argv)
         // Write the header
         write_header (cout, h);
 
-        // Process the points
-        for (size_t i = 0; i < h.total_points; ++i)
+        // Process the points. Streaming files are passed through as
+        // streaming files.
+        point_record_reader r (cin, h);
+        point_record_writer w (cout, h);
+        point_record p;
+        while (r.read (p))
         {
-            // Read a point
-            const auto p = read_point_record (cin, h.extra_fields);
-
             // Do something to the point
 
             // Write it back out
-            write_point_record (cout, p);
+            w.write (p);
         }
+        w.close ();
 
         return 0;
     }
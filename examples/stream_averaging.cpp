@@ -42,12 +42,11 @@ int main (int argc, char **argv)
         // Print the column header
         clog << "Total\tavg_x\tavg_y\tavg_z" << endl;
 
-        // Process the points
-        for (size_t i = 0; i < h.total_points; ++i)
+        // Process the points until the stream ends
+        point_record_reader r (cin, h);
+        point_record p;
+        while (r.read (p))
         {
-            // Read a point
-            const auto p = read_point_record (cin, h.extra_fields);
-
             // Update stats
             ++total_points;
             sumx += p.x;
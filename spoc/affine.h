@@ -1,6 +1,8 @@
 #pragma once
 
+#include <array>
 #include <cmath>
+#include <cstddef>
 
 namespace spoc
 {
@@ -127,6 +129,120 @@ void scale_z (T &p, const double v)
         p[i].z = p[i].z * v;
 }
 
+/// @brief A 4 X 4 affine transform, in row major order
+///
+/// Points are column vectors, so the transform 'multiply (b, a)'
+/// applies 'a' and then 'b'.
+using matrix = std::array<double, 16>;
+
+inline matrix identity_matrix ()
+{
+    return { 1.0, 0.0, 0.0, 0.0,
+             0.0, 1.0, 0.0, 0.0,
+             0.0, 0.0, 1.0, 0.0,
+             0.0, 0.0, 0.0, 1.0 };
+}
+
+inline matrix multiply (const matrix &a, const matrix &b)
+{
+    matrix m;
+    for (size_t i = 0; i < 4; ++i)
+    {
+        for (size_t j = 0; j < 4; ++j)
+        {
+            double sum = 0.0;
+            for (size_t k = 0; k < 4; ++k)
+                sum += a[i * 4 + k] * b[k * 4 + j];
+            m[i * 4 + j] = sum;
+        }
+    }
+    return m;
+}
+
+inline matrix translation (const double x, const double y, const double z)
+{
+    auto m = identity_matrix ();
+    m[3] = x;
+    m[7] = y;
+    m[11] = z;
+    return m;
+}
+
+inline matrix scaling (const double x, const double y, const double z)
+{
+    auto m = identity_matrix ();
+    m[0] = x;
+    m[5] = y;
+    m[10] = z;
+    return m;
+}
+
+// Rotate about the X, Y, or Z axis, the same way as rotate_x(),
+// rotate_y(), and rotate_z()
+inline matrix rotation_x (const double degrees)
+{
+    const double r = degrees * M_PI / 180.0;
+    const double c = cos (r);
+    const double s = sin (r);
+    auto m = identity_matrix ();
+    m[5] = c; m[6] = -s;
+    m[9] = s; m[10] = c;
+    return m;
+}
+
+inline matrix rotation_y (const double degrees)
+{
+    const double r = degrees * M_PI / 180.0;
+    const double c = cos (r);
+    const double s = sin (r);
+    auto m = identity_matrix ();
+    m[0] = c; m[2] = s;
+    m[8] = -s; m[10] = c;
+    return m;
+}
+
+inline matrix rotation_z (const double degrees)
+{
+    const double r = degrees * M_PI / 180.0;
+    const double c = cos (r);
+    const double s = sin (r);
+    auto m = identity_matrix ();
+    m[0] = c; m[1] = -s;
+    m[4] = s; m[5] = c;
+    return m;
+}
+
+// Transform coordinates that are stored in columns
+//
+// Terms with a zero coefficient are left out of each sum, so an axis
+// only depends on the axes that change it. NaN and infinite values don't
+// spread to the other axes, and an axis that isn't changed keeps all of
+// its bits, including the sign of zero. Since -0.0 is the identity for
+// addition, a term that is left out adds -0.0.
+template<typename T>
+void transform (const matrix &m, T &x, T &y, T &z)
+{
+    const size_t n = x.size ();
+    double *px = x.data ();
+    double *py = y.data ();
+    double *pz = z.data ();
+    const auto term = [](const double k, const double v)
+        { return k != 0.0 ? k * v : -0.0; };
+    const double tx = m[3] != 0.0 ? m[3] : -0.0;
+    const double ty = m[7] != 0.0 ? m[7] : -0.0;
+    const double tz = m[11] != 0.0 ? m[11] : -0.0;
+#pragma omp simd
+    for (size_t i = 0; i < n; ++i)
+    {
+        const double a = px[i];
+        const double b = py[i];
+        const double c = pz[i];
+        px[i] = term (m[0], a) + term (m[1], b) + term (m[2], c) + tx;
+        py[i] = term (m[4], a) + term (m[5], b) + term (m[6], c) + ty;
+        pz[i] = term (m[8], a) + term (m[9], b) + term (m[10], c) + tz;
+    }
+}
+
 } // namespace affine
 
 } // namespace spoc
@@ -0,0 +1,163 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace spoc
+{
+
+namespace bitpack
+{
+
+// Frame-of-reference bit packing
+//
+// Integer attributes rarely use all of their bits. Classifications fit
+// in 8 bits, and point ids and extra fields are often small, or close
+// together. Each value is stored as its difference from the minimum
+// value, using just enough bits for the largest difference.
+//
+// Bits are packed least significant first.
+
+/// Minimum value and number of bits per value
+struct frame
+{
+    uint64_t min = 0;
+    unsigned width = 0;
+};
+
+/// Number of bytes used to store a frame
+constexpr size_t FRAME_BYTES = sizeof(uint64_t) + sizeof(uint8_t);
+
+/// Get the number of bytes needed to pack 'n' values
+inline size_t get_packed_bytes (const size_t n, const unsigned width)
+{
+    return (n * width + 7) / 8;
+}
+
+/// Get the frame that covers a set of values
+/// @tparam U Unsigned integer type
+/// @param x Values
+/// @param n Number of values
+template<typename U>
+inline frame get_frame (const U *x, const size_t n)
+{
+    static_assert (std::is_unsigned_v<U>);
+    if (n == 0)
+        return frame ();
+
+    U lo = std::numeric_limits<U>::max ();
+    U hi = 0;
+    #pragma omp simd reduction(min:lo) reduction(max:hi)
+    for (size_t i = 0; i < n; ++i)
+    {
+        lo = std::min (lo, x[i]);
+        hi = std::max (hi, x[i]);
+    }
+    return frame {lo, static_cast<unsigned> (std::bit_width (static_cast<U> (hi - lo)))};
+}
+
+/// Write a frame
+/// @param f Frame
+/// @param out At least FRAME_BYTES bytes
+inline void write_frame (const frame &f, uint8_t *out)
+{
+    std::memcpy (out, &f.min, sizeof(uint64_t));
+    out[sizeof(uint64_t)] = static_cast<uint8_t> (f.width);
+}
+
+/// Read a frame
+/// @tparam U Type of the values that the frame describes
+/// @param in Frame bytes
+/// @param nbytes Number of bytes available
+template<typename U>
+inline frame read_frame (const uint8_t *in, const size_t nbytes)
+{
+    if (nbytes < FRAME_BYTES)
+        throw std::runtime_error ("The packed data are truncated");
+    frame f;
+    std::memcpy (&f.min, in, sizeof(uint64_t));
+    f.width = in[sizeof(uint64_t)];
+    if (f.width > sizeof(U) * 8 || f.min > std::numeric_limits<U>::max ())
+        throw std::runtime_error ("The packed data are corrupt");
+    return f;
+}
+
+/// Pack values
+/// @tparam U Unsigned integer type
+/// @param x Values, all of which must be in the frame
+/// @param n Number of values
+/// @param f Frame
+/// @param out Packed bytes, 'get_packed_bytes(n, f.width)' bytes long
+template<typename U>
+inline void pack (const U *x, const size_t n, const frame &f, uint8_t *out)
+{
+    static_assert (std::is_unsigned_v<U>);
+    const size_t nbytes = get_packed_bytes (n, f.width);
+    if (f.width == 0)
+        return;
+
+    // Each value touches at most two words, so the scatter can't be
+    // vectorized, but it is branch free
+    std::vector<uint64_t> words (nbytes / 8 + 2);
+    const U min = static_cast<U> (f.min);
+    for (size_t i = 0; i < n; ++i)
+    {
+        const uint64_t v = static_cast<U> (x[i] - min);
+        const size_t bit = i * f.width;
+        const size_t k = bit / 64;
+        const unsigned shift = bit % 64;
+        words[k] |= v << shift;
+        // Spill into the next word, if needed
+        words[k + 1] |= shift == 0 ? 0 : v >> (64 - shift);
+    }
+    std::memcpy (out, words.data (), nbytes);
+}
+
+/// Unpack values
+/// @tparam U Unsigned integer type
+/// @param in Packed bytes, 'get_packed_bytes(n, f.width)' bytes long
+/// @param n Number of values
+/// @param f Frame
+/// @param x Values
+template<typename U>
+inline void unpack (const uint8_t *in, const size_t n, const frame &f, U *x)
+{
+    static_assert (std::is_unsigned_v<U>);
+    const U min = static_cast<U> (f.min);
+    if (f.width == 0)
+    {
+        std::fill (x, x + n, min);
+        return;
+    }
+
+    // Pad the words so that every value can read two of them
+    const size_t nbytes = get_packed_bytes (n, f.width);
+    std::vector<uint64_t> words (nbytes / 8 + 2);
+    std::memcpy (words.data (), in, nbytes);
+
+    const unsigned width = f.width;
+    const uint64_t mask = width == 64 ? ~uint64_t (0) : (uint64_t (1) << width) - 1;
+    const uint64_t *w = words.data ();
+
+    // Every value is independent, so this vectorizes as a gather
+    #pragma omp simd
+    for (size_t i = 0; i < n; ++i)
+    {
+        const size_t bit = i * width;
+        const size_t k = bit / 64;
+        const unsigned shift = bit % 64;
+        const uint64_t lo = w[k] >> shift;
+        const uint64_t hi = shift == 0 ? 0 : w[k + 1] << (64 - shift);
+        x[i] = static_cast<U> (min + ((lo | hi) & mask));
+    }
+}
+
+} // namespace bitpack
+
+} // namespace spoc
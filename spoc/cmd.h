@@ -2,8 +2,11 @@
 
 #include "spoc/contracts.h"
 
+#include <cerrno>
+#include <cstdlib>
 #include <getopt.h>
 #include <iostream>
+#include <stdexcept>
 
 namespace spoc
 {
@@ -42,6 +45,19 @@ void print_help (std::ostream &os, const std::string &usage, const size_t noptio
     }
 }
 
+/// Parse the argument to a '--jobs' option, which must be a number greater than 0
+size_t get_jobs (const char *s)
+{
+    REQUIRE (s != nullptr);
+
+    char *end = nullptr;
+    errno = 0;
+    const long n = std::strtol (s, &end, 10);
+    if (end == s || *end != '\0' || errno == ERANGE || n <= 0)
+        throw std::runtime_error ("'jobs' must be greater than 0");
+    return n;
+}
+
 } // namespace cmd
 
 } // namespace spoc
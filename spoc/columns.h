@@ -0,0 +1,463 @@
+#pragma once
+#include "spoc/contracts.h"
+#include "spoc/extent.h"
+#include "spoc/file.h"
+#include "spoc/point_record.h"
+#include <algorithm>
+#include <cassert>
+#include <cctype>
+#include <cmath>
+#include <cstdint>
+#include <initializer_list>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace spoc
+{
+
+namespace columns
+{
+
+/// @brief Structure-of-arrays point cloud container
+///
+/// Each point record field is stored in its own contiguous vector,
+/// and each extra field is stored in its own contiguous vector. This
+/// avoids the per-record heap allocation of the extra fields, and it
+/// allows column scans to run over contiguous memory.
+struct point_columns
+{
+    std::vector<double> x;
+    std::vector<double> y;
+    std::vector<double> z;
+    std::vector<uint32_t> c; // classification
+    std::vector<uint32_t> p; // point ID
+    std::vector<uint16_t> i; // intensity/NIR
+    std::vector<uint16_t> r; // red
+    std::vector<uint16_t> g; // green
+    std::vector<uint16_t> b; // blue
+    std::vector<std::vector<uint64_t>> extra;
+
+    // CTORs
+    point_columns ()
+    {
+    }
+    point_columns (const size_t total_points, const size_t extra_fields)
+        : x (total_points) , y (total_points) , z (total_points)
+        , c (total_points) , p (total_points) , i (total_points)
+        , r (total_points) , g (total_points) , b (total_points)
+        , extra (extra_fields, std::vector<uint64_t> (total_points))
+    {
+    }
+
+    /// @brief Get the number of points
+    size_t size () const { return x.size (); }
+
+    /// @brief Check for zero points
+    bool empty () const { return x.empty (); }
+
+    /// @brief Get the number of extra fields
+    size_t get_extra_fields () const { return extra.size (); }
+
+    /// @brief Contract support
+    bool is_valid () const
+    {
+        const size_t n = x.size ();
+        if (y.size () != n || z.size () != n) return false;
+        if (c.size () != n || p.size () != n) return false;
+        if (i.size () != n || r.size () != n) return false;
+        if (g.size () != n || b.size () != n) return false;
+        if (std::any_of (extra.cbegin (), extra.cend (),
+            [&](const std::vector<uint64_t> &e) { return e.size () != n; }))
+            return false;
+        return true;
+    }
+
+    /// @brief Change the number of points
+    void resize (const size_t total_points)
+    {
+        x.resize (total_points); y.resize (total_points); z.resize (total_points);
+        c.resize (total_points); p.resize (total_points); i.resize (total_points);
+        r.resize (total_points); g.resize (total_points); b.resize (total_points);
+        for (auto &e : extra)
+            e.resize (total_points);
+    }
+
+    /// @brief Reserve space for points
+    void reserve (const size_t total_points)
+    {
+        x.reserve (total_points); y.reserve (total_points); z.reserve (total_points);
+        c.reserve (total_points); p.reserve (total_points); i.reserve (total_points);
+        r.reserve (total_points); g.reserve (total_points); b.reserve (total_points);
+        for (auto &e : extra)
+            e.reserve (total_points);
+    }
+
+    /// @brief Change the number of extra fields
+    void resize_extra_fields (const size_t extra_fields)
+    {
+        extra.resize (extra_fields, std::vector<uint64_t> (size ()));
+    }
+
+    /// @brief Gather a point record from the columns
+    /// @param n Point index
+    point_record::point_record get_point_record (const size_t n) const
+    {
+        assert (n < size ());
+        point_record::point_record pr (x[n], y[n], z[n],
+            c[n], p[n], i[n], r[n], g[n], b[n]);
+        pr.extra.resize (extra.size ());
+        for (size_t j = 0; j < extra.size (); ++j)
+            pr.extra[j] = extra[j][n];
+        return pr;
+    }
+
+    /// @brief Scatter a point record into the columns
+    /// @param n Point index
+    /// @param pr Point record value
+    void set_point_record (const size_t n, const point_record::point_record &pr)
+    {
+        REQUIRE (n < size ());
+        if (pr.extra.size () != extra.size ())
+            throw std::runtime_error ("point_columns::set_point_record(): the point record extra fields size is inconsistent with the columns");
+        x[n] = pr.x; y[n] = pr.y; z[n] = pr.z;
+        c[n] = pr.c; p[n] = pr.p; i[n] = pr.i;
+        r[n] = pr.r; g[n] = pr.g; b[n] = pr.b;
+        for (size_t j = 0; j < extra.size (); ++j)
+            extra[j][n] = pr.extra[j];
+    }
+
+    /// @brief Add a point record
+    void push_back (const point_record::point_record &pr)
+    {
+        // The first point determines the number of extra fields
+        if (empty () && extra.empty ())
+            extra.resize (pr.extra.size ());
+
+        // Check size of extra fields
+        if (pr.extra.size () != extra.size ())
+            throw std::runtime_error ("The number of extra fields is incorrect");
+
+        x.push_back (pr.x); y.push_back (pr.y); z.push_back (pr.z);
+        c.push_back (pr.c); p.push_back (pr.p); i.push_back (pr.i);
+        r.push_back (pr.r); g.push_back (pr.g); b.push_back (pr.b);
+        for (size_t j = 0; j < extra.size (); ++j)
+            extra[j].push_back (pr.extra[j]);
+    }
+};
+
+/// Number of fields in a point record, not counting extra fields
+constexpr size_t FIXED_FIELDS = 9;
+
+/// Apply a function to one of the columns
+/// @param pc Point columns, const or non-const
+/// @param j Field index: x, y, z, c, p, i, r, g, b, then extra fields
+/// @param f Function that takes a reference to the column's vector
+template<typename PC, typename F>
+inline void visit_column (PC &pc, const size_t j, F &&f)
+{
+    switch (j)
+    {
+        case 0: f (pc.x); break;
+        case 1: f (pc.y); break;
+        case 2: f (pc.z); break;
+        case 3: f (pc.c); break;
+        case 4: f (pc.p); break;
+        case 5: f (pc.i); break;
+        case 6: f (pc.r); break;
+        case 7: f (pc.g); break;
+        case 8: f (pc.b); break;
+        default:
+            assert (j - FIXED_FIELDS < pc.extra.size ());
+            f (pc.extra[j - FIXED_FIELDS]);
+            break;
+    }
+}
+
+/// Append a range of points from other point columns
+/// @param pc Point columns to append to
+/// @param other Point columns to copy from
+/// @param first Index of the first point to copy
+/// @param n Number of points to copy
+///
+/// Each column is copied in bulk.
+inline void append (point_columns &pc, const point_columns &other, const size_t first, const size_t n)
+{
+    REQUIRE (pc.is_valid ());
+    REQUIRE (other.is_valid ());
+    REQUIRE (first + n <= other.size ());
+    if (pc.get_extra_fields () != other.get_extra_fields ())
+        throw std::runtime_error ("The number of extra fields is incorrect");
+    for (size_t j = 0; j < FIXED_FIELDS + pc.get_extra_fields (); ++j)
+    {
+        visit_column (pc, j, [&](auto &v)
+        {
+            visit_column (other, j, [&](const auto &u)
+            {
+                if constexpr (std::is_same_v<std::decay_t<decltype(v)>, std::decay_t<decltype(u)>>)
+                    v.insert (v.end (), u.begin () + first, u.begin () + first + n);
+            });
+        });
+    }
+}
+
+/// Append all of the points from other point columns
+/// @param pc Point columns to append to
+/// @param other Point columns to copy from
+inline void append (point_columns &pc, const point_columns &other)
+{
+    append (pc, other, 0, other.size ());
+}
+
+/// Append the points at a range of indexes from other point columns
+/// @tparam It Iterator over indexes
+/// @param pc Point columns to append to
+/// @param other Point columns to copy from
+/// @param first Iterator to the first index
+/// @param last Iterator past the last index
+template<typename It>
+inline void gather (point_columns &pc, const point_columns &other, It first, It last)
+{
+    REQUIRE (pc.is_valid ());
+    REQUIRE (other.is_valid ());
+    if (pc.get_extra_fields () != other.get_extra_fields ())
+        throw std::runtime_error ("The number of extra fields is incorrect");
+    for (size_t j = 0; j < FIXED_FIELDS + pc.get_extra_fields (); ++j)
+    {
+        visit_column (pc, j, [&](auto &v)
+        {
+            visit_column (other, j, [&](const auto &u)
+            {
+                if constexpr (std::is_same_v<std::decay_t<decltype(v)>, std::decay_t<decltype(u)>>)
+                    for (auto i = first; i != last; ++i)
+                        v.push_back (u[*i]);
+            });
+        });
+    }
+}
+
+/// @brief A set of fields, using the same field indexes as visit_column()
+///
+/// Readers use a mask to skip fields that the caller doesn't need.
+/// Fields that are not in the mask are set to zero.
+class field_mask
+{
+    private:
+    std::vector<bool> fields;
+    bool all_extra = false;
+
+    public:
+    /// Construct a mask that contains no fields
+    field_mask ()
+    {
+    }
+    /// Construct a mask from field names
+    /// @param names 'x', 'y', 'z', 'c', 'p', 'i', 'r', 'g', 'b', 'e#' for
+    /// extra field '#', or 'extra' for all extra fields
+    field_mask (std::initializer_list<std::string> names)
+    {
+        for (const auto &n : names)
+            set (n);
+    }
+    /// Get a mask that contains every field
+    static field_mask all ()
+    {
+        field_mask m;
+        m.fields.assign (FIXED_FIELDS, true);
+        m.all_extra = true;
+        return m;
+    }
+
+    /// Add a field by index
+    field_mask &set (const size_t j)
+    {
+        if (j >= fields.size ())
+            fields.resize (j + 1);
+        fields[j] = true;
+        return *this;
+    }
+    /// Add a field by name, see the CTOR
+    field_mask &set (const std::string &name)
+    {
+        const std::string names = "xyzcpirgb";
+        if (name == "extra")
+            all_extra = true;
+        else if (name.size () == 1 && names.find (name[0]) != std::string::npos)
+            set (names.find (name[0]));
+        else if (name.size () > 1 && name[0] == 'e'
+            && std::all_of (name.begin () + 1, name.end (), ::isdigit))
+            set (FIXED_FIELDS + std::stoul (name.substr (1)));
+        else
+            throw std::runtime_error ("Invalid field name: " + name);
+        return *this;
+    }
+    /// Check if a field is in the mask
+    bool test (const size_t j) const
+    {
+        if (j >= FIXED_FIELDS && all_extra)
+            return true;
+        return j < fields.size () && fields[j];
+    }
+    /// Check if every field up to 'total_fields' is in the mask
+    bool test_all (const size_t total_fields) const
+    {
+        for (size_t j = 0; j < total_fields; ++j)
+            if (!test (j))
+                return false;
+        return true;
+    }
+};
+
+/// Zero the columns that are not in a mask
+/// @param pc Point columns
+/// @param m Field mask
+inline void clear_unselected (point_columns &pc, const field_mask &m)
+{
+    for (size_t j = 0; j < FIXED_FIELDS + pc.get_extra_fields (); ++j)
+        if (!m.test (j))
+            visit_column (pc, j, [](auto &v) { std::fill (v.begin (), v.end (), 0); });
+}
+
+/// Helper relational operator
+inline bool operator== (const point_columns &a, const point_columns &b)
+{
+    return a.x == b.x
+        && a.y == b.y
+        && a.z == b.z
+        && a.c == b.c
+        && a.p == b.p
+        && a.i == b.i
+        && a.r == b.r
+        && a.g == b.g
+        && a.b == b.b
+        && a.extra == b.extra;
+}
+
+/// Helper relational operator
+inline bool operator!= (const point_columns &a, const point_columns &b)
+{
+    return !(a == b);
+}
+
+/// Convert point records to columns
+/// @param prs Point records
+inline point_columns to_point_columns (const point_record::point_records &prs)
+{
+    const size_t extra_fields = point_record::get_extra_fields_size (prs);
+    point_columns pc (prs.size (), extra_fields);
+
+    #pragma omp parallel for
+    for (size_t n = 0; n < prs.size (); ++n)
+    {
+        assert (prs[n].extra.size () == extra_fields);
+        pc.x[n] = prs[n].x;
+        pc.y[n] = prs[n].y;
+        pc.z[n] = prs[n].z;
+        pc.c[n] = prs[n].c;
+        pc.p[n] = prs[n].p;
+        pc.i[n] = prs[n].i;
+        pc.r[n] = prs[n].r;
+        pc.g[n] = prs[n].g;
+        pc.b[n] = prs[n].b;
+        for (size_t j = 0; j < extra_fields; ++j)
+            pc.extra[j][n] = prs[n].extra[j];
+    }
+
+    return pc;
+}
+
+/// Convert columns to point records
+/// @param pc Point columns
+inline point_record::point_records to_point_records (const point_columns &pc)
+{
+    REQUIRE (pc.is_valid ());
+
+    const size_t extra_fields = pc.get_extra_fields ();
+    point_record::point_records prs (pc.size (), point_record::point_record (extra_fields));
+
+    #pragma omp parallel for
+    for (size_t n = 0; n < prs.size (); ++n)
+    {
+        prs[n].x = pc.x[n];
+        prs[n].y = pc.y[n];
+        prs[n].z = pc.z[n];
+        prs[n].c = pc.c[n];
+        prs[n].p = pc.p[n];
+        prs[n].i = pc.i[n];
+        prs[n].r = pc.r[n];
+        prs[n].g = pc.g[n];
+        prs[n].b = pc.b[n];
+        for (size_t j = 0; j < extra_fields; ++j)
+            prs[n].extra[j] = pc.extra[j][n];
+    }
+
+    return prs;
+}
+
+/// Convert a spoc file's point records to columns
+/// @param f Spoc file
+inline point_columns to_point_columns (const spoc::file::spoc_file &f)
+{
+    return to_point_columns (f.get_point_records ());
+}
+
+/// Create a spoc file from columns
+/// @param wkt OGC WKT string
+/// @param compressed Compression flag
+/// @param pc Point columns
+inline spoc::file::spoc_file to_spoc_file (const std::string &wkt,
+    const bool compressed,
+    const point_columns &pc)
+{
+    auto prs = to_point_records (pc);
+    spoc::file::spoc_file f (wkt, compressed);
+    f.move_point_records (prs);
+    return f;
+}
+
+/// Get the extent of the points using column scans
+/// @param pc Point columns
+inline spoc::extent::extent get_extent (const point_columns &pc)
+{
+    spoc::point::point<double> minp { std::numeric_limits<double>::max (),
+        std::numeric_limits<double>::max (),
+        std::numeric_limits<double>::max ()};
+    spoc::point::point<double> maxp { std::numeric_limits<double>::lowest (),
+        std::numeric_limits<double>::lowest (),
+        std::numeric_limits<double>::lowest ()};
+    if (!pc.empty ())
+    {
+        const auto x = std::minmax_element (pc.x.begin (), pc.x.end ());
+        const auto y = std::minmax_element (pc.y.begin (), pc.y.end ());
+        const auto z = std::minmax_element (pc.z.begin (), pc.z.end ());
+        minp = spoc::point::point<double> {*x.first, *y.first, *z.first};
+        maxp = spoc::point::point<double> {*x.second, *y.second, *z.second};
+    }
+    return spoc::extent::extent {minp, maxp};
+}
+
+// Get the extent of the finite coordinates, see extent::get_finite_extent()
+inline spoc::extent::extent get_finite_extent (const point_columns &pc)
+{
+    auto e = get_extent (point_columns ());
+    const auto get_range = [](const std::vector<double> &v, double &lo, double &hi)
+    {
+        for (const auto x : v)
+        {
+            if (!std::isfinite (x))
+                continue;
+            lo = std::min (lo, x);
+            hi = std::max (hi, x);
+        }
+    };
+    get_range (pc.x, e.minp.x, e.maxp.x);
+    get_range (pc.y, e.minp.y, e.maxp.y);
+    get_range (pc.z, e.minp.z, e.maxp.z);
+    return e;
+}
+
+} // namespace columns
+
+} // namespace spoc
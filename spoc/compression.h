@@ -1,5 +1,7 @@
 #pragma once
 
+#include "spoc/gorilla.h"
+#include <algorithm>
 #include <cassert>
 #include <cstdint>
 #include <iostream>
@@ -7,6 +9,13 @@
 #include <string>
 #include <vector>
 #include <zlib.h>
+#ifdef SPOC_HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef SPOC_HAVE_LZ4
+#include <lz4.h>
+#include <lz4hc.h>
+#endif
 
 namespace spoc
 {
@@ -78,41 +87,84 @@ struct zlib_inflator
     }
 };
 
+// Zlib counts bytes with 32-bit integers, so large buffers are fed to
+// it in pieces
+constexpr size_t MAX_ZLIB_CHUNK = (1u << 30);
+
+// Compress 'nbytes' pointed to by 'p' into 'output' using an
+// initialized deflator. Returns the number of compressed bytes.
+inline size_t deflate_into (zlib_deflator &deflator,
+    const uint8_t *p,
+    const size_t nbytes,
+    uint8_t *output,
+    const size_t output_bytes)
+{
+    deflator.s.next_in = const_cast<unsigned char *> (p);
+    deflator.s.next_out = output;
+    size_t in_left = nbytes;
+    size_t out_left = output_bytes;
+
+    int ret = Z_OK;
+    while (ret != Z_STREAM_END)
+    {
+        const size_t in_chunk = std::min (in_left, MAX_ZLIB_CHUNK);
+        const size_t out_chunk = std::min (out_left, MAX_ZLIB_CHUNK);
+        deflator.s.avail_in = in_chunk;
+        deflator.s.avail_out = out_chunk;
+        ret = deflate (&deflator.s, in_chunk == in_left ? Z_FINISH : Z_NO_FLUSH);
+        in_left -= in_chunk - deflator.s.avail_in;
+        out_left -= out_chunk - deflator.s.avail_out;
+        if (ret == Z_STREAM_END)
+            break;
+        if (out_left == 0)
+            throw std::runtime_error ("Can't compress: the output buffer is too small");
+        // GCOV_EXCL_START
+        if (ret != Z_OK)
+            throw std::runtime_error (zlib_error_string (ret));
+        // GCOV_EXCL_STOP
+    }
+    return output_bytes - out_left;
+}
+
+// Get the maximum number of bytes that compressing 'nbytes' at
+// compression level 'level' can produce
+inline size_t compress_bound (const size_t nbytes, const int level = -1)
+{
+    zlib_deflator deflator (level);
+    return deflateBound (&deflator.s, nbytes);
+}
+
+// Compress 'nbytes' pointed to by 'p' into caller-provided memory. The
+// output should be at least 'compress_bound()' bytes. Returns the
+// number of compressed bytes.
+inline size_t compress (const uint8_t *p,
+    const size_t nbytes,
+    uint8_t *output,
+    const size_t output_bytes,
+    const int level = -1)
+{
+    zlib_deflator deflator (level);
+    return deflate_into (deflator, p, nbytes, output, output_bytes);
+}
+
 // Compress 'nbytes' pointed to by 'p'. The 'level' parameter can be 1
 // to 9, where 1 is the fastest, and 9 is the best compression. 0 means
 // no compression, and -1 means use the default compression.
 inline std::vector<uint8_t> compress (const uint8_t *p, const size_t nbytes, const int level = -1)
 {
-    constexpr size_t BUFFER_SIZE = (1 << 20);
-    std::vector<uint8_t> output_buffer (BUFFER_SIZE);
-    std::vector<uint8_t> output;
-
     zlib_deflator deflator (level);
 
-    // Get bytes directly from the input vector
-    deflator.s.avail_in = nbytes;
-    deflator.s.next_in = const_cast<unsigned char *> (p);
-
-    do {
-        // Compress from input to output buffer
-        deflator.s.avail_out = BUFFER_SIZE;
-        deflator.s.next_out = &output_buffer[0];
-        deflate (&deflator.s, Z_FINISH);
-        const auto compressed_bytes = BUFFER_SIZE - deflator.s.avail_out;
-
-        // Save compressed bytes
-        assert (compressed_bytes <= output_buffer.size ());
-        output.insert (output.end (),
-            output_buffer.begin (),
-            output_buffer.begin () + compressed_bytes);
-    } while (deflator.s.avail_out == 0);
+    // Compress in one pass into a buffer that is big enough
+    std::vector<uint8_t> output (deflateBound (&deflator.s, nbytes));
+    const size_t n = deflate_into (deflator, p, nbytes, output.data (), output.size ());
+    output.resize (n);
 
     return output;
 }
 
 inline std::vector<uint8_t> compress (const std::vector<uint8_t> &input, const int level = -1)
 {
-    return compress (&input[0], input.size (), level);
+    return compress (input.data (), input.size (), level);
 }
 
 inline void compress (std::istream &is, std::ostream &os, const int level)
@@ -183,14 +235,56 @@ inline std::vector<uint8_t> decompress (const std::vector<uint8_t> &input)
     return output;
 }
 
+// Decompress 'input_bytes' pointed to by 'input' into caller-provided
+// memory. The number of decompressed bytes must be exactly
+// 'output_bytes'.
+inline void decompress (const uint8_t *input,
+    const size_t input_bytes,
+    uint8_t *output,
+    const size_t output_bytes)
+{
+    zlib_inflator inflator;
+
+    // Zlib won't accept a null output pointer, even with no room
+    uint8_t empty = 0;
+    inflator.s.next_in = const_cast<unsigned char *> (input);
+    inflator.s.next_out = output ? output : &empty;
+    size_t in_left = input_bytes;
+    size_t out_left = output_bytes;
+
+    int ret = Z_OK;
+    while (ret != Z_STREAM_END)
+    {
+        const size_t in_chunk = std::min (in_left, MAX_ZLIB_CHUNK);
+        const size_t out_chunk = std::min (out_left, MAX_ZLIB_CHUNK);
+        inflator.s.avail_in = in_chunk;
+        inflator.s.avail_out = out_chunk;
+        ret = inflate (&inflator.s, Z_NO_FLUSH);
+        in_left -= in_chunk - inflator.s.avail_in;
+        out_left -= out_chunk - inflator.s.avail_out;
+        switch (ret)
+        {
+            case Z_OK:
+            case Z_STREAM_END:
+                break;
+            case Z_BUF_ERROR:
+                // No progress was possible
+                throw std::runtime_error (out_left == 0
+                    ? "Can't decompress: unexpected number of decompressed bytes"
+                    : "Can't decompress: the compressed data is incomplete");
+            // GCOV_EXCL_START
+            default:
+                throw std::runtime_error (zlib_error_string (ret));
+            // GCOV_EXCL_STOP
+        }
+    }
+    if (out_left != 0)
+        throw std::runtime_error ("Can't decompress: unexpected number of decompressed bytes");
+}
+
 inline void decompress (const std::vector<uint8_t> &input, uint8_t *output, const size_t output_bytes)
 {
-    const auto d = decompress (input);
-    // GCOV_EXCL_START
-    if (d.size () != output_bytes)
-        throw std::runtime_error ("Can't decompress: unexpected number of decompressed bytes");;
-    // GCOV_EXCL_STOP
-    std::copy (&d[0], &d[0] + output_bytes, output);
+    decompress (input.data (), input.size (), output, output_bytes);
 }
 
 inline void decompress (std::istream &is, std::ostream &os)
@@ -242,6 +336,273 @@ inline void decompress (std::istream &is, std::ostream &os)
     } while (!done);
 }
 
+/// Compression algorithms
+///
+/// The values are stored in compressed files, so they must never change.
+enum class codec : uint8_t
+{
+    zero = 0, ///< No stored bytes: everything decompresses to zeros
+    zlib = 1, ///< Deflate, portable and always available
+    none = 2, ///< Stored as-is
+    zstd = 3, ///< Good ratios, optional
+    lz4 = 4,  ///< Very fast decoding, optional
+    gorilla = 5, ///< XOR encoding of 8 byte values, see 'gorilla.h'
+};
+
+/// Get the name of a codec
+inline std::string get_codec_name (const codec c)
+{
+    switch (c)
+    {
+        case codec::zero: return "zero";
+        case codec::zlib: return "zlib";
+        case codec::none: return "none";
+        case codec::zstd: return "zstd";
+        case codec::lz4: return "lz4";
+        case codec::gorilla: return "gorilla";
+    }
+    return "unknown";
+}
+
+/// Get a codec from its name
+/// @param name One of 'zlib', 'zstd', 'lz4', 'gorilla', or 'none'
+inline codec get_codec (const std::string &name)
+{
+    if (name == "zlib") return codec::zlib;
+    if (name == "zstd") return codec::zstd;
+    if (name == "lz4") return codec::lz4;
+    if (name == "gorilla") return codec::gorilla;
+    if (name == "none") return codec::none;
+    throw std::runtime_error ("Unknown codec name: " + name);
+}
+
+/// Check if a codec was enabled in this build
+inline bool is_available (const codec c)
+{
+    switch (c)
+    {
+        case codec::zero:
+        case codec::zlib:
+        case codec::none:
+        case codec::gorilla:
+            return true;
+        case codec::zstd:
+#ifdef SPOC_HAVE_ZSTD
+            return true;
+#else
+            return false;
+#endif
+        case codec::lz4:
+#ifdef SPOC_HAVE_LZ4
+            return true;
+#else
+            return false;
+#endif
+    }
+    return false;
+}
+
+// GCOV_EXCL_START
+inline void check_available (const codec c)
+{
+    if (get_codec_name (c) == "unknown")
+        throw std::runtime_error ("Unknown codec");
+    if (!is_available (c))
+        throw std::runtime_error ("Support for the '" + get_codec_name (c) + "' codec was not enabled in this build");
+}
+// GCOV_EXCL_STOP
+
+#ifdef SPOC_HAVE_LZ4
+inline int lz4_size (const size_t nbytes)
+{
+    if (nbytes > LZ4_MAX_INPUT_SIZE)
+        throw std::runtime_error ("Too many bytes for the 'lz4' codec");
+    return static_cast<int> (nbytes);
+}
+#endif
+
+/// Get the maximum number of bytes that compressing 'nbytes' can produce
+/// @param c Codec
+/// @param nbytes Number of bytes to compress
+/// @param level Compression level, where -1 means the codec's default
+inline size_t compress_bound (const codec c, const size_t nbytes, const int level = -1)
+{
+    check_available (c);
+    switch (c)
+    {
+        case codec::zero:
+            return 0;
+        case codec::zlib:
+            return compress_bound (nbytes, level);
+        case codec::none:
+            return nbytes;
+        case codec::gorilla:
+            return gorilla::encode_bound (nbytes);
+        case codec::zstd:
+#ifdef SPOC_HAVE_ZSTD
+            return ZSTD_compressBound (nbytes);
+#else
+            break;
+#endif
+        case codec::lz4:
+#ifdef SPOC_HAVE_LZ4
+            return LZ4_compressBound (lz4_size (nbytes));
+#else
+            break;
+#endif
+        default:
+            break;
+    }
+    throw std::runtime_error ("Unknown codec");
+}
+
+/// Compress into caller-provided memory
+/// @param c Codec
+/// @param p Bytes to compress
+/// @param nbytes Number of bytes to compress
+/// @param output Compressed bytes, at least 'compress_bound()' bytes
+/// @param output_bytes Size of the output
+/// @param level Compression level, where -1 means the codec's default
+/// @return The number of compressed bytes
+inline size_t compress (const codec c,
+    const uint8_t *p,
+    const size_t nbytes,
+    uint8_t *output,
+    const size_t output_bytes,
+    const int level = -1)
+{
+    check_available (c);
+    switch (c)
+    {
+        case codec::zero:
+            return 0;
+        case codec::zlib:
+            return compress (p, nbytes, output, output_bytes, level);
+        case codec::none:
+            if (output_bytes < nbytes)
+                throw std::runtime_error ("Can't compress: the output buffer is too small");
+            std::copy (p, p + nbytes, output);
+            return nbytes;
+        case codec::gorilla:
+            return gorilla::encode (p, nbytes, output, output_bytes);
+        case codec::zstd:
+#ifdef SPOC_HAVE_ZSTD
+        {
+            const auto n = ZSTD_compress (output, output_bytes, p, nbytes,
+                level < 0 ? ZSTD_CLEVEL_DEFAULT : level);
+            if (ZSTD_isError (n))
+                throw std::runtime_error (ZSTD_getErrorName (n));
+            return n;
+        }
+#else
+            break;
+#endif
+        case codec::lz4:
+#ifdef SPOC_HAVE_LZ4
+        {
+            const auto src = reinterpret_cast<const char *> (p);
+            const auto dst = reinterpret_cast<char *> (output);
+            const int cap = output_bytes > LZ4_MAX_INPUT_SIZE
+                ? LZ4_compressBound (LZ4_MAX_INPUT_SIZE)
+                : static_cast<int> (output_bytes);
+            // Levels above 1 use the slower high-compression encoder
+            const int n = level > 1
+                ? LZ4_compress_HC (src, dst, lz4_size (nbytes), cap, level)
+                : LZ4_compress_default (src, dst, lz4_size (nbytes), cap);
+            if (n <= 0 && nbytes != 0)
+                throw std::runtime_error ("Can't compress: the output buffer is too small");
+            return n;
+        }
+#else
+            break;
+#endif
+        default:
+            break;
+    }
+    throw std::runtime_error ("Unknown codec");
+}
+
+/// Compress bytes
+/// @param c Codec
+/// @param p Bytes to compress
+/// @param nbytes Number of bytes to compress
+/// @param level Compression level, where -1 means the codec's default
+inline std::vector<uint8_t> compress (const codec c,
+    const uint8_t *p,
+    const size_t nbytes,
+    const int level = -1)
+{
+    // Zlib needs its deflator to get the bound
+    if (c == codec::zlib)
+        return compress (p, nbytes, level);
+
+    std::vector<uint8_t> output (compress_bound (c, nbytes, level));
+    output.resize (compress (c, p, nbytes, output.data (), output.size (), level));
+    return output;
+}
+
+/// Decompress into caller-provided memory
+/// @param c Codec
+/// @param input Compressed bytes
+/// @param input_bytes Number of compressed bytes
+/// @param output Decompressed bytes
+/// @param output_bytes Exact number of decompressed bytes
+inline void decompress (const codec c,
+    const uint8_t *input,
+    const size_t input_bytes,
+    uint8_t *output,
+    const size_t output_bytes)
+{
+    check_available (c);
+    switch (c)
+    {
+        case codec::zero:
+            std::fill (output, output + output_bytes, 0);
+            return;
+        case codec::zlib:
+            decompress (input, input_bytes, output, output_bytes);
+            return;
+        case codec::none:
+            if (input_bytes != output_bytes)
+                throw std::runtime_error ("Can't decompress: unexpected number of decompressed bytes");
+            std::copy (input, input + input_bytes, output);
+            return;
+        case codec::gorilla:
+            gorilla::decode (input, input_bytes, output, output_bytes);
+            return;
+        case codec::zstd:
+#ifdef SPOC_HAVE_ZSTD
+        {
+            const auto n = ZSTD_decompress (output, output_bytes, input, input_bytes);
+            if (ZSTD_isError (n))
+                throw std::runtime_error (ZSTD_getErrorName (n));
+            if (n != output_bytes)
+                throw std::runtime_error ("Can't decompress: unexpected number of decompressed bytes");
+            return;
+        }
+#else
+            break;
+#endif
+        case codec::lz4:
+#ifdef SPOC_HAVE_LZ4
+        {
+            const int n = LZ4_decompress_safe (reinterpret_cast<const char *> (input),
+                reinterpret_cast<char *> (output),
+                lz4_size (input_bytes),
+                lz4_size (output_bytes));
+            if (n < 0 || static_cast<size_t> (n) != output_bytes)
+                throw std::runtime_error ("Can't decompress: unexpected number of decompressed bytes");
+            return;
+        }
+#else
+            break;
+#endif
+        default:
+            break;
+    }
+    throw std::runtime_error ("Unknown codec");
+}
+
 } // namespace compression
 
 } // namespace spoc
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cassert>
+#include <cmath>
 #include <limits>
 #include <utility>
 #include <vector>
@@ -52,6 +53,36 @@ extent get_extent (const T &points)
     return extent {minp, maxp};
 }
 
+// Get the extent of the finite coordinates
+//
+// NaN and infinite coordinates are skipped. An axis that doesn't have
+// any finite coordinates is left empty, the same as when there are no
+// points.
+template<typename T>
+extent get_finite_extent (const T &points)
+{
+    extent e = get_extent (std::vector<spoc::point::point<double>> ());
+    for (const auto &p : points)
+    {
+        if (std::isfinite (p.x))
+        {
+            e.minp.x = std::min (p.x, e.minp.x);
+            e.maxp.x = std::max (p.x, e.maxp.x);
+        }
+        if (std::isfinite (p.y))
+        {
+            e.minp.y = std::min (p.y, e.minp.y);
+            e.maxp.y = std::max (p.y, e.maxp.y);
+        }
+        if (std::isfinite (p.z))
+        {
+            e.minp.z = std::min (p.z, e.minp.z);
+            e.maxp.z = std::max (p.z, e.maxp.z);
+        }
+    }
+    return e;
+}
+
 // All dimensions <=
 inline bool all_less_equal (const spoc::point::point<double> &a, const spoc::point::point<double> &b)
 {
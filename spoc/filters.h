@@ -0,0 +1,270 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+namespace spoc
+{
+
+namespace filters
+{
+
+// Reversible transforms that are applied to a field's values before
+// they are compressed. They don't change the number of bytes, but they
+// make the bytes more compressible.
+//
+// A filter is stored as one byte. The low three bits select a
+// predictor, and the SHUFFLE bit selects byte transposition, which is
+// applied after the predictor.
+//
+// The PACK bit selects frame-of-reference bit packing, see 'bitpack.h',
+// which is applied after the predictor instead of SHUFFLE. Packing
+// changes the number of bytes, so the compressed field stores the
+// frame in front of the codec's bytes, and 'apply()' and 'unapply()'
+// only handle the predictor.
+//
+// The values are stored in compressed files, so they must never change.
+
+/// No filtering
+constexpr uint8_t NONE = 0x00;
+/// Subtract the previous value
+constexpr uint8_t DELTA = 0x01;
+/// XOR with the previous value
+constexpr uint8_t XOR = 0x02;
+/// Subtract the previous value, then zig-zag encode the signed difference
+constexpr uint8_t ZIGZAG = 0x03;
+/// Group the n'th bytes of all values together
+constexpr uint8_t SHUFFLE = 0x10;
+/// Store the difference from the minimum value using as few bits as possible
+constexpr uint8_t PACK = 0x20;
+
+/// Selects the predictor bits
+constexpr uint8_t PREDICTOR_MASK = 0x07;
+
+/// Check if a filter byte is one that this library knows about
+inline bool is_valid (const uint8_t filter)
+{
+    if ((filter & ~(PREDICTOR_MASK | SHUFFLE | PACK)) != 0)
+        return false;
+    if ((filter & PREDICTOR_MASK) > ZIGZAG)
+        return false;
+    if ((filter & SHUFFLE) && (filter & PACK))
+        return false;
+    return true;
+}
+
+/// Get a filter from its name
+/// @param name A predictor, 'none', 'delta', 'xor', or 'zigzag',
+/// optionally followed by '+shuffle' or '+pack', or just 'shuffle' or
+/// 'pack'
+inline uint8_t get_filter (const std::string &name)
+{
+    if (name == "none") return NONE;
+    if (name == "shuffle") return SHUFFLE;
+    if (name == "pack") return PACK;
+
+    const auto n = name.find ('+');
+    const auto predictor = name.substr (0, n);
+    uint8_t f = NONE;
+    if (predictor == "delta") f = DELTA;
+    else if (predictor == "xor") f = XOR;
+    else if (predictor == "zigzag") f = ZIGZAG;
+    else throw std::runtime_error ("Unknown filter name: " + name);
+
+    if (n == std::string::npos)
+        return f;
+    const auto layout = name.substr (n + 1);
+    if (layout == "shuffle") return f | SHUFFLE;
+    if (layout == "pack") return f | PACK;
+    throw std::runtime_error ("Unknown filter name: " + name);
+}
+
+/// Get the name of a filter
+inline std::string get_filter_name (const uint8_t filter)
+{
+    if (!is_valid (filter))
+        return "unknown";
+    std::string s;
+    switch (filter & PREDICTOR_MASK)
+    {
+        case DELTA: s = "delta"; break;
+        case XOR: s = "xor"; break;
+        case ZIGZAG: s = "zigzag"; break;
+    }
+    if (filter & SHUFFLE)
+        s += s.empty () ? "shuffle" : "+shuffle";
+    if (filter & PACK)
+        s += s.empty () ? "pack" : "+pack";
+    return s.empty () ? "none" : s;
+}
+
+/// Unsigned integer with the same size as T
+template<typename T>
+using bits_type = std::conditional_t<sizeof(T) == 8, uint64_t,
+    std::conditional_t<sizeof(T) == 4, uint32_t,
+    std::conditional_t<sizeof(T) == 2, uint16_t, uint8_t>>>;
+
+namespace detail
+{
+
+template<typename U>
+inline void predict (const uint8_t predictor, const U *u, U *y, const size_t n)
+{
+    using S = std::make_signed_t<U>;
+    constexpr unsigned SHIFT = sizeof(U) * 8 - 1;
+
+    if (n == 0)
+        return;
+
+    // The first value is predicted from zero
+    y[0] = u[0];
+    switch (predictor)
+    {
+        default:
+        case NONE:
+            std::copy (u, u + n, y);
+            break;
+        case DELTA:
+            #pragma omp simd
+            for (size_t i = 1; i < n; ++i)
+                y[i] = u[i] - u[i - 1];
+            break;
+        case XOR:
+            #pragma omp simd
+            for (size_t i = 1; i < n; ++i)
+                y[i] = u[i] ^ u[i - 1];
+            break;
+        case ZIGZAG:
+        {
+            // Map small signed differences to small unsigned values
+            const auto zigzag = [](const S d)
+                { return static_cast<U> ((static_cast<U> (d) << 1) ^ static_cast<U> (d >> SHIFT)); };
+            y[0] = zigzag (static_cast<S> (u[0]));
+            #pragma omp simd
+            for (size_t i = 1; i < n; ++i)
+                y[i] = zigzag (static_cast<S> (u[i] - u[i - 1]));
+            break;
+        }
+    }
+}
+
+template<typename U>
+inline void unpredict (const uint8_t predictor, U *y, const size_t n)
+{
+    // The running sums can't be vectorized, but they are cheap
+    // compared to the codec
+    switch (predictor)
+    {
+        default:
+        case NONE:
+            break;
+        case DELTA:
+            for (size_t i = 1; i < n; ++i)
+                y[i] += y[i - 1];
+            break;
+        case XOR:
+            for (size_t i = 1; i < n; ++i)
+                y[i] ^= y[i - 1];
+            break;
+        case ZIGZAG:
+        {
+            U prev = 0;
+            for (size_t i = 0; i < n; ++i)
+            {
+                const U d = static_cast<U> ((y[i] >> 1) ^ (U (0) - (y[i] & 1)));
+                prev += d;
+                y[i] = prev;
+            }
+            break;
+        }
+    }
+}
+
+template<typename U>
+inline void shuffle (const U *y, uint8_t *out, const size_t n)
+{
+    for (size_t b = 0; b < sizeof(U); ++b)
+    {
+        uint8_t *q = out + b * n;
+        #pragma omp simd
+        for (size_t i = 0; i < n; ++i)
+            q[i] = static_cast<uint8_t> (y[i] >> (8 * b));
+    }
+}
+
+template<typename U>
+inline void unshuffle (const uint8_t *in, U *y, const size_t n)
+{
+    std::fill (y, y + n, U (0));
+    for (size_t b = 0; b < sizeof(U); ++b)
+    {
+        const uint8_t *q = in + b * n;
+        #pragma omp simd
+        for (size_t i = 0; i < n; ++i)
+            y[i] |= static_cast<U> (q[i]) << (8 * b);
+    }
+}
+
+} // namespace detail
+
+/// Apply a filter
+/// @tparam T Value type
+/// @param filter Filter byte, without PACK
+/// @param x Values to filter
+/// @param n Number of values
+/// @param out Filtered bytes, 'n * sizeof(T)' bytes long
+template<typename T>
+inline void apply (const uint8_t filter, const T *x, const size_t n, uint8_t *out)
+{
+    static_assert (std::is_trivially_copyable_v<T>);
+    using U = bits_type<T>;
+    static_assert (sizeof(U) == sizeof(T));
+
+    if (!is_valid (filter) || (filter & PACK))
+        throw std::runtime_error ("Unknown filter");
+
+    // Work on the bit patterns, so that filtering is exactly reversible
+    std::vector<U> u (n);
+    std::memcpy (u.data (), x, n * sizeof(T));
+    std::vector<U> y (n);
+    detail::predict (filter & PREDICTOR_MASK, u.data (), y.data (), n);
+
+    if (filter & SHUFFLE)
+        detail::shuffle (y.data (), out, n);
+    else
+        std::memcpy (out, y.data (), n * sizeof(T));
+}
+
+/// Reverse a filter
+/// @tparam T Value type
+/// @param filter Filter byte, without PACK
+/// @param in Filtered bytes, 'n * sizeof(T)' bytes long
+/// @param n Number of values
+/// @param x Unfiltered values
+template<typename T>
+inline void unapply (const uint8_t filter, const uint8_t *in, const size_t n, T *x)
+{
+    static_assert (std::is_trivially_copyable_v<T>);
+    using U = bits_type<T>;
+    static_assert (sizeof(U) == sizeof(T));
+
+    if (!is_valid (filter) || (filter & PACK))
+        throw std::runtime_error ("Unknown filter");
+
+    std::vector<U> y (n);
+    if (filter & SHUFFLE)
+        detail::unshuffle (in, y.data (), n);
+    else
+        std::memcpy (y.data (), in, n * sizeof(T));
+    detail::unpredict (filter & PREDICTOR_MASK, y.data (), n);
+    std::memcpy (x, y.data (), n * sizeof(T));
+}
+
+} // namespace filters
+
+} // namespace spoc
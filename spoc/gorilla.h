@@ -0,0 +1,256 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace spoc
+{
+
+namespace gorilla
+{
+
+// Lossless XOR encoding of 64-bit floating point values
+//
+// Each value is XOR'd with the previous value. Neighboring coordinates
+// share their sign, exponent, and high mantissa bits, so the XOR has
+// many leading zeros, and often trailing zeros. Only the bits between
+// them are stored.
+//
+// Each value is written as:
+//
+//     '0'                       The value is the same as the previous value
+//     '10' bits                 The XOR fits in the previous window
+//     '11' lz:6 len:6 bits      A new window with 'lz' leading zeros and
+//                               'len + 1' meaningful bits
+//
+// The encoder works on bit patterns, so it reproduces NaNs, infinities
+// and signed zeros exactly. Bits are packed least significant first.
+
+/// Maximum number of bits used for one value
+constexpr size_t MAX_BITS_PER_VALUE = 2 + 6 + 6 + 64;
+
+/// Get the maximum number of bytes that encoding 'nbytes' bytes can produce
+inline size_t encode_bound (const size_t nbytes)
+{
+    return (nbytes / 8 * MAX_BITS_PER_VALUE + 7) / 8;
+}
+
+namespace detail
+{
+
+class bit_writer
+{
+    private:
+    uint8_t *p;
+    uint8_t *end;
+    uint64_t acc = 0;
+    unsigned used = 0;
+
+    void store (const uint64_t w, const size_t nbytes)
+    {
+        if (static_cast<size_t> (end - p) < nbytes)
+            throw std::runtime_error ("Can't compress: the output buffer is too small");
+        std::memcpy (p, &w, nbytes);
+        p += nbytes;
+    }
+
+    public:
+    bit_writer (uint8_t *p, const size_t nbytes)
+        : p (p)
+        , end (p + nbytes)
+    {
+    }
+    /// Write the low 'nbits' bits of 'v', 1 <= nbits <= 64
+    void put (const uint64_t v, const unsigned nbits)
+    {
+        acc |= v << used;
+        if (used + nbits >= 64)
+        {
+            store (acc, 8);
+            acc = used == 0 ? 0 : v >> (64 - used);
+            used = used + nbits - 64;
+        }
+        else
+            used += nbits;
+    }
+    /// Write any partial word and return the end of the output
+    uint8_t *flush ()
+    {
+        store (acc, (used + 7) / 8);
+        acc = 0;
+        used = 0;
+        return p;
+    }
+};
+
+class bit_reader
+{
+    private:
+    const uint8_t *p;
+    const uint8_t *end;
+    uint64_t acc = 0;
+    unsigned avail = 0;
+    size_t remaining_bits;
+
+    uint64_t load ()
+    {
+        uint64_t w = 0;
+        const size_t nbytes = std::min (size_t (8), static_cast<size_t> (end - p));
+        std::memcpy (&w, p, nbytes);
+        p += nbytes;
+        return w;
+    }
+
+    public:
+    bit_reader (const uint8_t *p, const size_t nbytes)
+        : p (p)
+        , end (p + nbytes)
+        , remaining_bits (nbytes * 8)
+    {
+    }
+    /// Read 'nbits' bits, 1 <= nbits <= 64
+    uint64_t get (const unsigned nbits)
+    {
+        if (nbits > remaining_bits)
+            throw std::runtime_error ("Can't decompress: the compressed data are truncated");
+        remaining_bits -= nbits;
+
+        const uint64_t mask = nbits == 64 ? ~uint64_t (0) : (uint64_t (1) << nbits) - 1;
+        if (avail >= nbits)
+        {
+            const uint64_t r = acc & mask;
+            acc = nbits == 64 ? 0 : acc >> nbits;
+            avail -= nbits;
+            return r;
+        }
+
+        // Take what's left, and the rest from the next word
+        const uint64_t w = load ();
+        const uint64_t r = (acc | (w << avail)) & mask;
+        const unsigned consumed = nbits - avail;
+        acc = consumed == 64 ? 0 : w >> consumed;
+        avail = 64 - consumed;
+        return r;
+    }
+    /// Number of unread bytes, not counting padding bits
+    size_t get_remaining_bytes () const
+    {
+        return remaining_bits / 8;
+    }
+};
+
+inline size_t get_total_values (const size_t nbytes)
+{
+    if (nbytes % 8 != 0)
+        throw std::runtime_error ("The 'gorilla' codec only works with 8 byte values");
+    return nbytes / 8;
+}
+
+} // namespace detail
+
+/// Encode 64-bit values into caller-provided memory
+/// @param p Bytes to encode, a multiple of 8 bytes long
+/// @param nbytes Number of bytes to encode
+/// @param output Encoded bytes, at least 'encode_bound()' bytes
+/// @param output_bytes Size of the output
+/// @return The number of encoded bytes
+inline size_t encode (const uint8_t *p,
+    const size_t nbytes,
+    uint8_t *output,
+    const size_t output_bytes)
+{
+    const size_t n = detail::get_total_values (nbytes);
+    detail::bit_writer w (output, output_bytes);
+
+    uint64_t prev = 0;
+    // No window yet, so the first non-zero XOR opens one
+    unsigned prev_lz = 64;
+    unsigned prev_tz = 0;
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        uint64_t x;
+        std::memcpy (&x, p + i * 8, 8);
+        const uint64_t d = x ^ prev;
+        prev = x;
+
+        if (d == 0)
+        {
+            w.put (0b0, 1);
+            continue;
+        }
+
+        const unsigned lz = std::countl_zero (d);
+        const unsigned tz = std::countr_zero (d);
+        if (lz >= prev_lz && tz >= prev_tz)
+        {
+            w.put (0b01, 2);
+            w.put (d >> prev_tz, 64 - prev_lz - prev_tz);
+        }
+        else
+        {
+            const unsigned len = 64 - lz - tz;
+            w.put (0b11 | (lz << 2) | ((len - 1) << 8), 14);
+            w.put (d >> tz, len);
+            prev_lz = lz;
+            prev_tz = tz;
+        }
+    }
+
+    return w.flush () - output;
+}
+
+/// Decode 64-bit values
+/// @param input Encoded bytes
+/// @param input_bytes Number of encoded bytes
+/// @param output Decoded bytes
+/// @param output_bytes Exact number of decoded bytes
+inline void decode (const uint8_t *input,
+    const size_t input_bytes,
+    uint8_t *output,
+    const size_t output_bytes)
+{
+    const size_t n = detail::get_total_values (output_bytes);
+    detail::bit_reader r (input, input_bytes);
+
+    uint64_t prev = 0;
+    unsigned prev_lz = 64;
+    unsigned prev_tz = 0;
+
+    for (size_t i = 0; i < n; ++i)
+    {
+        uint64_t d = 0;
+        if (r.get (1) != 0)
+        {
+            if (r.get (1) == 0)
+            {
+                if (prev_lz == 64)
+                    throw std::runtime_error ("Can't decompress: the compressed data are corrupt");
+                d = r.get (64 - prev_lz - prev_tz) << prev_tz;
+            }
+            else
+            {
+                const auto h = r.get (12);
+                const unsigned lz = h & 0x3F;
+                const unsigned len = (h >> 6) + 1;
+                if (lz + len > 64)
+                    throw std::runtime_error ("Can't decompress: the compressed data are corrupt");
+                prev_lz = lz;
+                prev_tz = 64 - lz - len;
+                d = r.get (len) << prev_tz;
+            }
+        }
+        prev ^= d;
+        std::memcpy (output + i * 8, &prev, 8);
+    }
+
+    if (r.get_remaining_bytes () != 0)
+        throw std::runtime_error ("Can't decompress: unexpected number of decompressed bytes");
+}
+
+} // namespace gorilla
+
+} // namespace spoc
@@ -1,9 +1,11 @@
 #pragma once
+#include "spoc/extent.h"
 #include "spoc/version.h"
 #include <cstdint>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <optional>
 #include <string>
 
 namespace spoc
@@ -93,8 +95,23 @@ struct header
     size_t total_points;
     /// A flag that indicates if the records are compressed or not
     uint8_t compressed;
+    /// The extent of the points, if it is known. Files with a minor
+    /// version before 4 don't store it.
+    std::optional<extent::extent> e;
+    /// A flag that indicates that the number of points was not known
+    /// when the header was written, so 'total_points' is zero and
+    /// readers count the points as they read them
+    bool streaming = false;
 };
 
+/// The first minor version that can store the extent in the header
+constexpr uint8_t EXTENT_MINOR_VERSION = 4;
+
+/// Header flag bit that indicates that the extent follows the flags
+constexpr uint8_t EXTENT_FLAG = 0x01;
+/// Header flag bit that indicates that the number of points is unknown
+constexpr uint8_t STREAMING_FLAG = 0x02;
+
 /// Helper relational operator
 /// @param a First header
 /// @param b Second header
@@ -109,6 +126,9 @@ inline bool operator== (const header &a, const header &b)
     if (a.extra_fields != b.extra_fields) return false;
     if (a.total_points != b.total_points) return false;
     if (a.compressed != b.compressed) return false;
+    if (a.e.has_value () != b.e.has_value ()) return false;
+    if (a.e && !(*a.e == *b.e)) return false;
+    if (a.streaming != b.streaming) return false;
     return true;
 }
 
@@ -126,6 +146,9 @@ inline bool operator!= (const header &a, const header &b)
     if (a.extra_fields != b.extra_fields) return true;
     if (a.total_points != b.total_points) return true;
     if (a.compressed != b.compressed) return true;
+    if (a.e.has_value () != b.e.has_value ()) return true;
+    if (a.e && !(*a.e == *b.e)) return true;
+    if (a.streaming != b.streaming) return true;
     return false;
 }
 
@@ -145,6 +168,19 @@ inline void write_header (std::ostream &s, const header &h)
     s.write (reinterpret_cast<const char*>(&h.extra_fields), sizeof(uint8_t));
     s.write (reinterpret_cast<const char*>(&h.total_points), sizeof(uint64_t));
     s.write (reinterpret_cast<const char*>(&h.compressed), sizeof(uint8_t));
+    if (h.streaming && h.minor_version < EXTENT_MINOR_VERSION)
+        throw std::runtime_error ("Files with this minor version can't be streamed");
+    if (h.minor_version >= EXTENT_MINOR_VERSION)
+    {
+        const uint8_t flags = (h.e ? EXTENT_FLAG : 0) | (h.streaming ? STREAMING_FLAG : 0);
+        s.write (reinterpret_cast<const char*>(&flags), sizeof(uint8_t));
+        if (h.e)
+        {
+            const double e[6] { h.e->minp.x, h.e->minp.y, h.e->minp.z,
+                h.e->maxp.x, h.e->maxp.y, h.e->maxp.z };
+            s.write (reinterpret_cast<const char*>(e), sizeof(e));
+        }
+    }
     s.flush ();
 }
 
@@ -160,10 +196,9 @@ inline header read_header (std::istream &s)
     if (h.major_version != MAJOR_VERSION)
         throw std::runtime_error ("Incompatible major version number");
     s.read (reinterpret_cast<char*>(&h.minor_version), sizeof(uint8_t));
-    // See the note in the `test_header.cpp` unit test. When the major
-    // version gets bumped above 0, this behavior should change to
-    // allow for reading headers with unequal minor versions.
-    if (h.minor_version != MINOR_VERSION)
+    // See the note in the `test_header.cpp` unit test. Files with an
+    // older minor version can be read, but newer ones can't.
+    if (h.minor_version > MINOR_VERSION)
         throw std::runtime_error ("Incompatible minor version number");
     uint16_t len = 0;
     s.read (reinterpret_cast<char*>(&len), sizeof(uint16_t));
@@ -172,6 +207,20 @@ inline header read_header (std::istream &s)
     s.read (reinterpret_cast<char*>(&h.extra_fields), sizeof(uint8_t));
     s.read (reinterpret_cast<char*>(&h.total_points), sizeof(uint64_t));
     s.read (reinterpret_cast<char*>(&h.compressed), sizeof(uint8_t));
+    if (h.minor_version >= EXTENT_MINOR_VERSION)
+    {
+        uint8_t flags = 0;
+        s.read (reinterpret_cast<char*>(&flags), sizeof(uint8_t));
+        if (flags & ~(EXTENT_FLAG | STREAMING_FLAG))
+            throw std::runtime_error ("Unknown header flags");
+        h.streaming = flags & STREAMING_FLAG;
+        if (flags & EXTENT_FLAG)
+        {
+            double e[6];
+            s.read (reinterpret_cast<char*>(e), sizeof(e));
+            h.e = extent::extent { { e[0], e[1], e[2] }, { e[3], e[4], e[5] } };
+        }
+    }
     return h;
 }
 
@@ -191,6 +240,12 @@ inline std::ostream &operator<< (std::ostream &s, const header &h)
     s << "extra_fields " << static_cast<unsigned> (h.extra_fields) << std::endl;
     s << "total_points " << h.total_points << std::endl;
     s << "compressed " << (h.compressed ? "true" : "false")  << std::endl;
+    if (h.streaming)
+        s << "streaming true" << std::endl;
+    if (h.e)
+        s << "extent "
+            << h.e->minp.x << " " << h.e->minp.y << " " << h.e->minp.z << " "
+            << h.e->maxp.x << " " << h.e->maxp.y << " " << h.e->maxp.z << std::endl;
     return s;
 }
 
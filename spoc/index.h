@@ -0,0 +1,379 @@
+#pragma once
+
+#include "spoc/contracts.h"
+#include "spoc/extent.h"
+#include "spoc/file.h"
+#include "spoc/header.h"
+#include "spoc/io.h"
+#include "spoc/point_record.h"
+#include "spoc/utils.h"
+#include "spoc/voxel.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace spoc
+{
+
+namespace index
+{
+
+// Spatial index for window queries
+//
+// The points of a file are sorted by the cell of a regular x/y grid
+// that they fall in, and the index stores where each cell's points
+// start. A window query only reads the records in the cells that
+// overlap the window.
+//
+// Cells are numbered in row-major order, so the cells of one grid row
+// that overlap a window form a single range of records.
+
+/// Default target number of points in each grid cell
+constexpr size_t DEFAULT_POINTS_PER_CELL = 4096;
+
+/// Maximum number of grid cells
+constexpr size_t MAX_CELLS = size_t (1) << 28;
+
+/// Version of the index file format
+constexpr uint8_t INDEX_VERSION = 1;
+
+/// @brief Grid of point index ranges over a spatially sorted file
+struct spatial_index
+{
+    /// Origin of the grid
+    spoc::point::point<double> minp;
+    /// Length of the sides of each cell
+    double cell_size = 1.0;
+    /// Number of cells along x
+    size_t nx = 1;
+    /// Number of cells along y
+    size_t ny = 1;
+    /// The points in cell 'k' are [offsets[k], offsets[k + 1])
+    std::vector<uint64_t> offsets { 0, 0 };
+
+    /// @brief Get the number of indexed points
+    size_t get_total_points () const { return offsets.back (); }
+
+    /// @brief Contract support
+    bool is_valid () const
+    {
+        if (!(cell_size > 0.0) || nx == 0 || ny == 0)
+            return false;
+        if (offsets.size () != nx * ny + 1 || offsets.front () != 0)
+            return false;
+        return std::is_sorted (offsets.begin (), offsets.end ());
+    }
+};
+
+/// Helper relational operator
+inline bool operator== (const spatial_index &a, const spatial_index &b)
+{
+    return a.minp == b.minp
+        && a.cell_size == b.cell_size
+        && a.nx == b.nx
+        && a.ny == b.ny
+        && a.offsets == b.offsets;
+}
+
+/// Get the name of the index file that goes with a spoc file
+/// @param fn Spoc filename
+inline std::string get_index_filename (const std::string &fn)
+{
+    return fn + ".sidx";
+}
+
+/// Get the cell size that puts about 'points_per_cell' points in each cell
+/// @param e Extent of the points
+/// @param total_points Number of points
+/// @param points_per_cell Target number of points in each cell
+inline double get_cell_size (const extent::extent &e,
+    const size_t total_points,
+    const size_t points_per_cell = DEFAULT_POINTS_PER_CELL)
+{
+    REQUIRE (points_per_cell != 0);
+    const double dx = e.maxp.x - e.minp.x;
+    const double dy = e.maxp.y - e.minp.y;
+    const double cells = std::max (size_t (1), total_points / points_per_cell);
+    const double s = std::sqrt (dx * dy / cells);
+    if (std::isfinite (s) && s > 0.0)
+        return s;
+    // The points lie on a line or a point
+    const double d = std::max (dx, dy);
+    return std::isfinite (d) && d > 0.0 ? d / cells : 1.0;
+}
+
+/// Get the grid cell of a point
+/// @param idx Spatial index
+/// @param p Point
+///
+/// Points outside of the grid go in the nearest cell. NaN coordinates
+/// go in the first row or column.
+template<typename T>
+inline size_t get_cell (const spatial_index &idx, const T &p)
+{
+    // Clamp to the grid, so that the conversion to an index can't overflow
+    const auto clamp = [](const double v, const double lo, const double hi)
+        { return std::isnan (v) ? lo : std::clamp (v, lo, hi); };
+    const spoc::point::point<double> q {
+        clamp (p.x, idx.minp.x, idx.minp.x + idx.nx * idx.cell_size),
+        clamp (p.y, idx.minp.y, idx.minp.y + idx.ny * idx.cell_size),
+        idx.minp.z };
+    // The grid is a single layer of voxels
+    const auto v = voxel::get_voxel_index (q, idx.minp, idx.cell_size);
+    return std::min (v.j, idx.ny - 1) * idx.nx + std::min (v.i, idx.nx - 1);
+}
+
+/// Sort points by grid cell and index them
+/// @param prs Point records, which get sorted
+/// @param cell_size Length of the sides of each cell, or 0 to choose one
+///
+/// The sort is stable, so points in the same cell keep their order.
+inline spatial_index build_index (point_record::point_records &prs, double cell_size = 0.0)
+{
+    spatial_index idx;
+    if (prs.empty ())
+        return idx;
+
+    // Get the extent of the x/y coordinates, ignoring NaNs
+    extent::extent e {
+        { std::numeric_limits<double>::max (), std::numeric_limits<double>::max (), 0.0 },
+        { std::numeric_limits<double>::lowest (), std::numeric_limits<double>::lowest (), 0.0 } };
+    for (const auto &p : prs)
+    {
+        if (!std::isnan (p.x))
+        {
+            e.minp.x = std::min (e.minp.x, p.x);
+            e.maxp.x = std::max (e.maxp.x, p.x);
+        }
+        if (!std::isnan (p.y))
+        {
+            e.minp.y = std::min (e.minp.y, p.y);
+            e.maxp.y = std::max (e.maxp.y, p.y);
+        }
+    }
+    if (e.minp.x > e.maxp.x)
+        e.minp.x = e.maxp.x = 0.0;
+    if (e.minp.y > e.maxp.y)
+        e.minp.y = e.maxp.y = 0.0;
+
+    // Size the grid
+    if (cell_size <= 0.0)
+        cell_size = get_cell_size (e, prs.size ());
+    const double nx = std::floor ((e.maxp.x - e.minp.x) / cell_size) + 1;
+    const double ny = std::floor ((e.maxp.y - e.minp.y) / cell_size) + 1;
+    if (!(nx * ny <= MAX_CELLS))
+        throw std::runtime_error ("The spatial index cell size is too small");
+    idx.minp = e.minp;
+    idx.cell_size = cell_size;
+    idx.nx = nx;
+    idx.ny = ny;
+
+    // Counting sort by cell
+    std::vector<size_t> cells (prs.size ());
+    #pragma omp parallel for
+    for (size_t i = 0; i < prs.size (); ++i)
+        cells[i] = get_cell (idx, prs[i]);
+    idx.offsets.assign (idx.nx * idx.ny + 1, 0);
+    for (const auto k : cells)
+        ++idx.offsets[k + 1];
+    for (size_t k = 1; k < idx.offsets.size (); ++k)
+        idx.offsets[k] += idx.offsets[k - 1];
+
+    std::vector<uint64_t> next (idx.offsets.begin (), idx.offsets.end () - 1);
+    point_record::point_records sorted (prs.size ());
+    for (size_t i = 0; i < prs.size (); ++i)
+        sorted[next[cells[i]]++] = std::move (prs[i]);
+    prs.swap (sorted);
+
+    ENSURE (idx.is_valid ());
+    return idx;
+}
+
+/// Get the ranges of points in the cells that overlap an extent
+/// @param idx Spatial index
+/// @param e Extent, only x and y are used
+/// @return Sorted, non-overlapping [first, last) point index ranges
+inline std::vector<std::pair<size_t, size_t>> get_ranges (const spatial_index &idx, const extent::extent &e)
+{
+    REQUIRE (idx.is_valid ());
+    std::vector<std::pair<size_t, size_t>> ranges;
+
+    // Get the cells that the extent covers
+    const double x0 = std::floor ((e.minp.x - idx.minp.x) / idx.cell_size);
+    const double y0 = std::floor ((e.minp.y - idx.minp.y) / idx.cell_size);
+    const double x1 = std::floor ((e.maxp.x - idx.minp.x) / idx.cell_size);
+    const double y1 = std::floor ((e.maxp.y - idx.minp.y) / idx.cell_size);
+    if (!(x1 >= 0 && y1 >= 0 && x0 < idx.nx && y0 < idx.ny && x0 <= x1 && y0 <= y1))
+        return ranges;
+
+    const size_t i0 = std::max (x0, 0.0);
+    const size_t j0 = std::max (y0, 0.0);
+    const size_t i1 = std::min (x1, idx.nx - 1.0);
+    const size_t j1 = std::min (y1, idx.ny - 1.0);
+    for (size_t j = j0; j <= j1; ++j)
+    {
+        const size_t first = idx.offsets[j * idx.nx + i0];
+        const size_t last = idx.offsets[j * idx.nx + i1 + 1];
+        if (first == last)
+            continue;
+        // Merge with the previous row's range if they touch
+        if (!ranges.empty () && ranges.back ().second == first)
+            ranges.back ().second = last;
+        else
+            ranges.emplace_back (first, last);
+    }
+    return ranges;
+}
+
+/// Helper I/O function
+/// @param s Output stream
+/// @param idx Spatial index
+inline void write_index (std::ostream &s, const spatial_index &idx)
+{
+    REQUIRE (idx.is_valid ());
+    s.write ("SIDX", 4);
+    s.write (reinterpret_cast<const char*>(&INDEX_VERSION), sizeof(uint8_t));
+    s.write (reinterpret_cast<const char*>(&idx.minp.x), sizeof(double));
+    s.write (reinterpret_cast<const char*>(&idx.minp.y), sizeof(double));
+    s.write (reinterpret_cast<const char*>(&idx.cell_size), sizeof(double));
+    const uint64_t nx = idx.nx;
+    const uint64_t ny = idx.ny;
+    s.write (reinterpret_cast<const char*>(&nx), sizeof(uint64_t));
+    s.write (reinterpret_cast<const char*>(&ny), sizeof(uint64_t));
+    s.write (reinterpret_cast<const char*>(idx.offsets.data ()), idx.offsets.size () * sizeof(uint64_t));
+    s.flush ();
+    if (!s)
+        throw std::runtime_error ("Error writing spatial index");
+}
+
+/// Helper I/O function
+/// @param s Input stream
+inline spatial_index read_index (std::istream &s)
+{
+    char signature[4] {};
+    uint8_t version = 0;
+    s.read (signature, 4);
+    s.read (reinterpret_cast<char*>(&version), sizeof(uint8_t));
+    if (!s || std::string (signature, 4) != "SIDX")
+        throw std::runtime_error ("Invalid spatial index format");
+    if (version != INDEX_VERSION)
+        throw std::runtime_error ("Incompatible spatial index version number");
+
+    spatial_index idx;
+    uint64_t nx = 0;
+    uint64_t ny = 0;
+    s.read (reinterpret_cast<char*>(&idx.minp.x), sizeof(double));
+    s.read (reinterpret_cast<char*>(&idx.minp.y), sizeof(double));
+    s.read (reinterpret_cast<char*>(&idx.cell_size), sizeof(double));
+    s.read (reinterpret_cast<char*>(&nx), sizeof(uint64_t));
+    s.read (reinterpret_cast<char*>(&ny), sizeof(uint64_t));
+    if (!s || nx == 0 || ny == 0 || nx > MAX_CELLS || ny > MAX_CELLS / nx)
+        throw std::runtime_error ("Error reading spatial index");
+    idx.nx = nx;
+    idx.ny = ny;
+    idx.offsets.resize (nx * ny + 1);
+    s.read (reinterpret_cast<char*>(idx.offsets.data ()), idx.offsets.size () * sizeof(uint64_t));
+    if (!s || !idx.is_valid ())
+        throw std::runtime_error ("Error reading spatial index");
+    return idx;
+}
+
+namespace detail
+{
+
+// Read the records of an uncompressed file that are in the ranges
+inline point_record::point_records read_ranges_uncompressed (const std::string &fn,
+    const std::vector<std::pair<size_t, size_t>> &ranges)
+{
+    // Only the pages that hold the records get read
+    const io::mapped_spoc_file m (fn);
+    point_record::point_records prs;
+    for (const auto &r : ranges)
+        for (size_t i = r.first; i < r.second; ++i)
+            prs.push_back (m.get_point_record (i));
+    return prs;
+}
+
+// Read the blocks of a compressed file that overlap the ranges
+inline point_record::point_records read_ranges_compressed (std::istream &s,
+    const header::header &h,
+    const std::vector<std::pair<size_t, size_t>> &ranges,
+    const extent::extent &e)
+{
+    // Version 0.1 files don't have blocks
+    if (h.minor_version < 2)
+        return columns::to_point_records (io::read_compressed_columns (s, h));
+
+    const auto start = s.tellg ();
+    std::vector<io::compressed_block> bs;
+    size_t first = 0;
+    auto r = ranges.begin ();
+    for (const auto &b : io::read_block_directory (s, h))
+    {
+        const size_t last = first + b.total_points;
+        // Skip the ranges that end before this block
+        while (r != ranges.end () && r->second <= first)
+            ++r;
+        const bool overlaps = r != ranges.end () && r->first < last;
+        first = last;
+        if (!overlaps || (b.stats && !stats::may_intersect (*b.stats, e)))
+            continue;
+        s.seekg (start + static_cast<std::streamoff> (b.offset));
+        auto c = io::read_compressed_block (s, h.extra_fields);
+        if (c.total_points != b.total_points)
+            throw std::runtime_error ("The block directory does not match the compressed blocks");
+        bs.push_back (std::move (c));
+    }
+
+    size_t total_points = 0;
+    for (const auto &b : bs)
+        total_points += b.total_points;
+    columns::point_columns pc (total_points, h.extra_fields);
+    io::decompress_blocks (bs, pc);
+    return columns::to_point_records (pc);
+}
+
+} // namespace detail
+
+/// Read the points of a spoc file that lie inside an extent
+/// @param fn Spoc filename, which must have an index, see get_index_filename()
+/// @param e Extent
+///
+/// Only the records in the index cells that overlap the extent are
+/// read. For compressed files, only the blocks that hold those records
+/// are read.
+inline spoc::file::spoc_file query_box (const std::string &fn, const extent::extent &e)
+{
+    // Get the index
+    std::ifstream is (get_index_filename (fn), std::ios::binary);
+    if (!is)
+        throw std::runtime_error ("Could not open the spatial index for reading");
+    const auto idx = read_index (is);
+
+    // Get the header
+    std::ifstream s (fn, std::ios::binary);
+    if (!s)
+        throw std::runtime_error ("Could not open file for reading");
+    const auto h = header::read_header (s);
+    // A streamed file doesn't know its size, so the blocks have to match
+    if (!h.streaming && h.total_points != idx.get_total_points ())
+        throw std::runtime_error ("The spatial index does not match the file");
+
+    // Read the cells, then crop them
+    const auto ranges = get_ranges (idx, e);
+    const auto prs = h.compressed
+        ? detail::read_ranges_compressed (s, h, ranges, e)
+        : detail::read_ranges_uncompressed (fn, ranges);
+    return spoc::file::spoc_file (h.wkt, h.compressed, utils::crop (prs, e));
+}
+
+} // namespace index
+
+} // namespace spoc
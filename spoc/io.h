@@ -1,20 +1,38 @@
 #pragma once
+#include "spoc/bitpack.h"
+#include "spoc/columns.h"
 #include "spoc/compression.h"
 #include "spoc/contracts.h"
 #include "spoc/file.h"
+#include "spoc/filters.h"
 #include "spoc/header.h"
 #include "spoc/point_record.h"
+#include "spoc/stats.h"
+#include "spoc/utils.h"
 #include "spoc/version.h"
 #include <algorithm>
 #include <cmath>
+#include <condition_variable>
 #include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <iterator>
 #include <limits>
+#include <mutex>
+#include <optional>
 #include <string>
+#include <thread>
+#include <type_traits>
 #include <unordered_set>
 #include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 namespace spoc
 {
@@ -22,73 +40,455 @@ namespace spoc
 namespace io
 {
 
-template<typename T>
-inline bool all_zero (const std::vector<T> &x)
+/// Default number of points in each block of a compressed file
+constexpr size_t DEFAULT_BLOCK_SIZE = 1 << 16;
+
+/// How the bytes of a field in a compressed block are encoded
+using field_codec = compression::codec;
+
+/// Options that control how point records are compressed
+struct compression_options
+{
+    /// Codec used for fields that are not all zero
+    compression::codec codec = compression::codec::zlib;
+    /// Codec used for x, y, and z, if it differs from 'codec'
+    std::optional<compression::codec> float_codec;
+    /// Codec specific compression level, where -1 means the codec's default
+    int level = -1;
+    /// Number of points in each block
+    size_t block_size = DEFAULT_BLOCK_SIZE;
+    /// Pre-compression filter for x, y, and z
+    uint8_t float_filter = filters::NONE;
+    /// Pre-compression filter for the integer fields
+    uint8_t integer_filter = filters::NONE;
+};
+
+/// One field of one block in a compressed file
+struct compressed_field
+{
+    field_codec codec = field_codec::zero;
+    uint8_t filter = filters::NONE;
+    std::vector<uint8_t> bytes;
+};
+
+/// All of the fields of one block in a compressed file
+struct compressed_block
 {
-    if (std::any_of (x.begin (), x.end (),
-        [](const T &i) { return i != 0; }))
-        return false;
-    return true;
+    uint64_t total_points = 0;
+    std::vector<compressed_field> fields;
+};
+
+/// Location of a block in a compressed file
+struct block_entry
+{
+    /// Offset from the start of the compressed data, just after the header
+    uint64_t offset = 0;
+    /// Number of points in the block
+    uint64_t total_points = 0;
+    /// Summary of the block's values, which version 0.2 files don't have
+    std::optional<stats::block_stats> stats;
+};
+
+/// Helper relational operator
+inline bool operator== (const block_entry &a, const block_entry &b)
+{
+    return a.offset == b.offset && a.total_points == b.total_points;
 }
 
+/// The locations of all blocks in a compressed file
+using block_directory = std::vector<block_entry>;
+
+/// Compress one field
+/// @param x Pointer to the values
+/// @param n Number of values
+/// @param opts Codec and level
 template<typename T>
-inline std::vector<uint8_t> compress_field (const std::vector<T> &x)
+inline compressed_field encode_field (const T *x,
+    const size_t n,
+    const compression_options &opts = compression_options ())
 {
+    compressed_field f;
+
     // Check to see if they are all zero
-    if (all_zero (x))
-        return std::vector<uint8_t> (); // Return empty vector
+    if (std::all_of (x, x + n, [](const T &i) { return i == 0; }))
+        return f;
+
+    if constexpr (std::is_floating_point_v<T>)
+    {
+        f.codec = opts.float_codec.value_or (opts.codec);
+        f.filter = opts.float_filter;
+    }
+    else
+    {
+        f.codec = opts.codec;
+        f.filter = opts.integer_filter;
+    }
 
     // Compress
-    //  -1 = default compression
-    //   0 = no compression
-    //   1 = fastest compression
-    //   9 = smallest compression
-    const int compression_level = -1;
-    const auto c = spoc::compression::compress (reinterpret_cast<const uint8_t *> (&x[0]), x.size () * sizeof(T), compression_level);
+    if (f.filter == filters::NONE)
+    {
+        f.bytes = compression::compress (f.codec, reinterpret_cast<const uint8_t *> (x), n * sizeof(T), opts.level);
+    }
+    else if (f.filter & filters::PACK)
+    {
+        // Predict, then pack, then compress the packed bits. The frame
+        // goes in front of the compressed bits.
+        using U = filters::bits_type<T>;
+        std::vector<U> tmp (n);
+        filters::apply (f.filter & ~filters::PACK, x, n, reinterpret_cast<uint8_t *> (tmp.data ()));
+        const auto fr = bitpack::get_frame (tmp.data (), n);
+        std::vector<uint8_t> packed (bitpack::get_packed_bytes (n, fr.width));
+        bitpack::pack (tmp.data (), n, fr, packed.data ());
+        const auto c = compression::compress (f.codec, packed.data (), packed.size (), opts.level);
+        f.bytes.resize (bitpack::FRAME_BYTES + c.size ());
+        bitpack::write_frame (fr, f.bytes.data ());
+        std::copy (c.begin (), c.end (), f.bytes.begin () + bitpack::FRAME_BYTES);
+    }
+    else
+    {
+        std::vector<uint8_t> tmp (n * sizeof(T));
+        filters::apply (f.filter, x, n, tmp.data ());
+        f.bytes = compression::compress (f.codec, tmp.data (), tmp.size (), opts.level);
+    }
 
-    return c;
+    return f;
 }
 
+/// Decompress one field
+/// @param f Compressed field
+/// @param x Pointer to storage for the values
+/// @param n Number of values
 template<typename T>
-inline void write_compressed (std::ostream &s, const std::vector<T> &x)
+inline void decode_field (const compressed_field &f, T *x, const size_t n)
+{
+    if (!filters::is_valid (f.filter))
+        throw std::runtime_error ("Unsupported compressed field filter");
+
+    // Decompress straight into the destination when there is no filter
+    if (f.filter == filters::NONE || f.codec == field_codec::zero)
+    {
+        compression::decompress (f.codec,
+            f.bytes.data (), f.bytes.size (),
+            reinterpret_cast<uint8_t *> (x), n * sizeof(T));
+        return;
+    }
+
+    if (f.filter & filters::PACK)
+    {
+        using U = filters::bits_type<T>;
+        const auto fr = bitpack::read_frame<U> (f.bytes.data (), f.bytes.size ());
+        std::vector<uint8_t> packed (bitpack::get_packed_bytes (n, fr.width));
+        compression::decompress (f.codec,
+            f.bytes.data () + bitpack::FRAME_BYTES, f.bytes.size () - bitpack::FRAME_BYTES,
+            packed.data (), packed.size ());
+        std::vector<U> tmp (n);
+        bitpack::unpack (packed.data (), n, fr, tmp.data ());
+        filters::unapply (f.filter & ~filters::PACK, reinterpret_cast<const uint8_t *> (tmp.data ()), n, x);
+        return;
+    }
+
+    std::vector<uint8_t> tmp (n * sizeof(T));
+    compression::decompress (f.codec, f.bytes.data (), f.bytes.size (), tmp.data (), tmp.size ());
+    filters::unapply (f.filter, tmp.data (), n, x);
+}
+
+/// Compress a range of points
+/// @param pc Point columns
+/// @param first Index of the first point in the block
+/// @param n Number of points in the block
+/// @param opts Codec and level
+inline compressed_block compress_block (const columns::point_columns &pc,
+    const size_t first,
+    const size_t n,
+    const compression_options &opts = compression_options ())
+{
+    REQUIRE (pc.is_valid ());
+    REQUIRE (first + n <= pc.size ());
+
+    compressed_block b;
+    b.total_points = n;
+    b.fields.resize (columns::FIXED_FIELDS + pc.get_extra_fields ());
+
+    // Compress fields in parallel
+    utils::parallel_for (b.fields.size (), [&](const size_t j)
+    {
+        columns::visit_column (pc, j, [&](const auto &v)
+            { b.fields[j] = encode_field (v.data () + first, n, opts); });
+    });
+
+    return b;
+}
+
+/// Decompress a block into a range of points
+/// @param b Compressed block
+/// @param pc Point columns
+/// @param first Index of the first point in the block
+inline void decompress_block (const compressed_block &b,
+    columns::point_columns &pc,
+    const size_t first)
+{
+    REQUIRE (pc.is_valid ());
+    if (first + b.total_points > pc.size ())
+        throw std::runtime_error ("The compressed block does not fit in the point columns");
+    if (b.fields.size () != columns::FIXED_FIELDS + pc.get_extra_fields ())
+        throw std::runtime_error ("The compressed block has the wrong number of fields");
+
+    // Decompress fields in parallel
+    utils::parallel_for (b.fields.size (), [&](const size_t j)
+    {
+        columns::visit_column (pc, j, [&](auto &v)
+            { decode_field (b.fields[j], v.data () + first, b.total_points); });
+    });
+}
+
+/// Decompress consecutive blocks into the point columns
+/// @param bs Compressed blocks
+/// @param pc Point columns
+/// @param first Index of the first point in the first block
+///
+/// Every field of every block is an independent task, so all of the
+/// threads stay busy even when there are fewer fields than threads.
+inline void decompress_blocks (const std::vector<compressed_block> &bs,
+    columns::point_columns &pc,
+    const size_t first = 0)
+{
+    REQUIRE (pc.is_valid ());
+    const size_t fields = columns::FIXED_FIELDS + pc.get_extra_fields ();
+
+    // Get the location of each block
+    std::vector<size_t> firsts (bs.size ());
+    size_t n = first;
+    for (size_t k = 0; k < bs.size (); ++k)
+    {
+        if (bs[k].fields.size () != fields)
+            throw std::runtime_error ("The compressed block has the wrong number of fields");
+        firsts[k] = n;
+        n += bs[k].total_points;
+    }
+    if (n > pc.size ())
+        throw std::runtime_error ("The compressed blocks do not fit in the point columns");
+
+    // Decompress straight into the columns
+    utils::parallel_for (bs.size () * fields, [&](const size_t t)
+    {
+        const size_t k = t / fields;
+        const size_t j = t % fields;
+        columns::visit_column (pc, j, [&](auto &v)
+            { decode_field (bs[k].fields[j], v.data () + firsts[k], bs[k].total_points); });
+    });
+}
+
+/// Compress blocks of points
+/// @param pcs Point columns, each of which becomes one block
+/// @param opts Codec and level
+///
+/// Like decompress_blocks(), every field of every block is an
+/// independent task.
+inline std::vector<compressed_block> compress_blocks (const std::vector<columns::point_columns> &pcs,
+    const compression_options &opts = compression_options ())
 {
-    // Check for all-zero vector
-    if (x.empty ())
+    std::vector<compressed_block> bs (pcs.size ());
+    if (pcs.empty ())
+        return bs;
+    const size_t fields = columns::FIXED_FIELDS + pcs[0].get_extra_fields ();
+    for (size_t k = 0; k < pcs.size (); ++k)
+    {
+        REQUIRE (pcs[k].is_valid ());
+        if (pcs[k].get_extra_fields () + columns::FIXED_FIELDS != fields)
+            throw std::runtime_error ("The blocks have different numbers of extra fields");
+        bs[k].total_points = pcs[k].size ();
+        bs[k].fields.resize (fields);
+    }
+
+    utils::parallel_for (pcs.size () * fields, [&](const size_t t)
     {
-        // Write the length as '0'
-        const uint64_t n = 0;
+        const size_t k = t / fields;
+        const size_t j = t % fields;
+        columns::visit_column (pcs[k], j, [&](const auto &v)
+            { bs[k].fields[j] = encode_field (v.data (), v.size (), opts); });
+    });
+
+    return bs;
+}
+
+/// Helper I/O function
+/// @param s Output stream
+/// @param b Compressed block
+/// @return The number of bytes written
+inline size_t write_compressed_block (std::ostream &s, const compressed_block &b)
+{
+    size_t nbytes = 0;
+    s.write (reinterpret_cast<const char*>(&b.total_points), sizeof(uint64_t));
+    nbytes += sizeof(uint64_t);
+    for (const auto &f : b.fields)
+    {
+        const uint64_t n = f.bytes.size ();
+        s.write (reinterpret_cast<const char*>(&f.codec), sizeof(uint8_t));
+        s.write (reinterpret_cast<const char*>(&f.filter), sizeof(uint8_t));
         s.write (reinterpret_cast<const char*>(&n), sizeof(uint64_t));
+        s.write (reinterpret_cast<const char*>(f.bytes.data ()), n);
+        nbytes += 2 * sizeof(uint8_t) + sizeof(uint64_t) + n;
+    }
+    return nbytes;
+}
+
+/// Helper I/O function
+/// @param s Input stream
+/// @param n Number of bytes to skip
+///
+/// Seek when the stream supports it, otherwise read past the bytes.
+inline void skip_bytes (std::istream &s, const uint64_t n)
+{
+    if (n == 0)
         return;
+    if (s.tellg () != std::streampos (-1))
+        s.seekg (n, std::ios::cur);
+    else
+        s.ignore (n);
+}
+
+/// Helper I/O function
+/// @param s Input stream
+/// @param extra_fields Number of extra fields in each record
+///
+/// A block with zero points marks the end of the blocks
+inline compressed_block read_compressed_block (std::istream &s,
+    const size_t extra_fields,
+    const columns::field_mask &m = columns::field_mask::all ())
+{
+    compressed_block b;
+    s.read (reinterpret_cast<char*>(&b.total_points), sizeof(uint64_t));
+    if (!s)
+        throw std::runtime_error ("Error reading compressed block");
+
+    // Check for the end marker
+    if (b.total_points == 0)
+        return b;
+
+    b.fields.resize (columns::FIXED_FIELDS + extra_fields);
+    for (auto &f : b.fields)
+    {
+        uint64_t n = 0;
+        s.read (reinterpret_cast<char*>(&f.codec), sizeof(uint8_t));
+        s.read (reinterpret_cast<char*>(&f.filter), sizeof(uint8_t));
+        s.read (reinterpret_cast<char*>(&n), sizeof(uint64_t));
+        if (!s)
+            throw std::runtime_error ("Error reading compressed block");
+        const size_t j = &f - b.fields.data ();
+        if (!m.test (j))
+        {
+            // Unselected fields read as zeros
+            skip_bytes (s, n);
+            f = compressed_field ();
+        }
+        else
+        {
+            f.bytes.resize (n);
+            s.read (reinterpret_cast<char*>(f.bytes.data ()), n);
+        }
+        if (!s)
+            throw std::runtime_error ("Error reading compressed block");
     }
+    return b;
+}
 
-    // Write compressed length
-    const uint64_t n = x.size ();
+/// Helper I/O function
+/// @param s Output stream
+/// @return The number of bytes written
+inline size_t write_block_end_marker (std::ostream &s)
+{
+    const uint64_t n = 0;
     s.write (reinterpret_cast<const char*>(&n), sizeof(uint64_t));
+    return sizeof(uint64_t);
+}
 
-    // Write compressed bytes
-    s.write (reinterpret_cast<const char*>(&x[0]), x.size ());
+/// Helper I/O function
+/// @param s Output stream
+/// @param d Block directory
+/// @param offset Offset of the directory from the start of the compressed data
+inline void write_block_directory (std::ostream &s, const block_directory &d, const uint64_t offset)
+{
+    const uint64_t n = d.size ();
+    s.write (reinterpret_cast<const char*>(&n), sizeof(uint64_t));
+    for (const auto &e : d)
+    {
+        REQUIRE (e.stats.has_value ());
+        s.write (reinterpret_cast<const char*>(&e.offset), sizeof(uint64_t));
+        s.write (reinterpret_cast<const char*>(&e.total_points), sizeof(uint64_t));
+        stats::write_block_stats (s, *e.stats);
+    }
+    // The trailer points back to the directory
+    s.write (reinterpret_cast<const char*>(&offset), sizeof(uint64_t));
 }
 
-template<typename T>
-inline std::vector<T> read_compressed (std::istream &s, const size_t size)
+/// Helper I/O function
+/// @param s Input stream positioned at the block directory
+/// @param h Header that has already been read from the stream
+///
+/// This also consumes the trailer that follows the directory.
+inline block_directory read_block_directory_entries (std::istream &s, const header::header &h)
 {
-    // Get number of compressed bytes
     uint64_t n = 0;
     s.read (reinterpret_cast<char*>(&n), sizeof(uint64_t));
+    if (!s)
+        throw std::runtime_error ("Error reading block directory");
+    block_directory d;
+    for (size_t j = 0; j < n; ++j)
+    {
+        block_entry e;
+        s.read (reinterpret_cast<char*>(&e.offset), sizeof(uint64_t));
+        s.read (reinterpret_cast<char*>(&e.total_points), sizeof(uint64_t));
+        if (!s)
+            throw std::runtime_error ("Error reading block directory");
+        if (h.minor_version >= 3)
+            e.stats = stats::read_block_stats (s, h.extra_fields);
+        d.push_back (e);
+    }
+    uint64_t offset = 0;
+    s.read (reinterpret_cast<char*>(&offset), sizeof(uint64_t));
+    if (!s)
+        throw std::runtime_error ("Error reading block directory");
+    return d;
+}
 
-    // If a '0' was written, the vector is empty
-    if (n == 0)
-        return std::vector<T> ();
+/// Helper I/O function
+/// @param s Seekable input stream positioned at the start of the
+/// compressed data, just after the header
+/// @param h Header that has already been read from the stream
+///
+/// The stream position is restored before returning.
+inline block_directory read_block_directory (std::istream &s, const header::header &h)
+{
+    const auto start = s.tellg ();
 
-    // Read compressed bytes
-    std::vector<uint8_t> c (n);
-    s.read (reinterpret_cast<char *> (&c[0]), n);
+    // Read the trailer
+    uint64_t offset = 0;
+    s.seekg (-static_cast<std::streamoff> (sizeof(uint64_t)), std::ios::end);
+    s.read (reinterpret_cast<char*>(&offset), sizeof(uint64_t));
+    if (!s)
+        throw std::runtime_error ("Error reading block directory");
 
-    // Decompress
-    std::vector<T> x (size);
-    spoc::compression::decompress (c, reinterpret_cast<uint8_t *> (&x[0]), x.size () * sizeof(T));
+    // Read the directory
+    s.seekg (start + static_cast<std::streamoff> (offset));
+    const auto d = read_block_directory_entries (s, h);
+    s.seekg (start);
+    return d;
+}
 
-    return x;
+/// Get the number of bytes in an uncompressed point record
+/// @param extra_fields Number of extra fields in each record
+inline constexpr size_t get_record_size (const size_t extra_fields)
+{
+    return sizeof(double) // x
+        + sizeof(double) // y
+        + sizeof(double) // z
+        + sizeof(uint32_t) // c
+        + sizeof(uint32_t) // p
+        + sizeof(uint16_t) // i
+        + sizeof(uint16_t) // r
+        + sizeof(uint16_t) // g
+        + sizeof(uint16_t) // b
+        + extra_fields * sizeof(uint64_t);
 }
 
 /// Helper I/O function
@@ -159,6 +559,152 @@ inline point_record::point_records read_uncompressed_points (std::istream &s,
     return p;
 }
 
+/// Helper I/O function
+/// @param s Input stream
+/// @param total_points Number of records to read
+/// @param extra_fields Number of extra fields in each record
+inline columns::point_columns read_uncompressed_columns (std::istream &s,
+    const size_t total_points,
+    const size_t extra_fields)
+{
+    // Determine sizes
+    const size_t record_size = get_record_size (extra_fields);
+
+    // Allocate the buffer
+    const size_t buffer_size = std::max (size_t (64 * 1024), record_size);
+    const size_t records_per_buffer = buffer_size / record_size;
+    std::vector<char> buffer (records_per_buffer * record_size);
+
+    // Allocate the columns
+    columns::point_columns pc (total_points, extra_fields);
+
+    // Read records in chunks
+    for (size_t i = 0; i < total_points; i += records_per_buffer)
+    {
+        // Fill the buffer
+        const size_t total_records = std::min (records_per_buffer, total_points - i);
+        s.read (&buffer[0], total_records * record_size);
+
+        // Scatter the records into the columns
+        for (size_t j = 0; j < total_records; ++j)
+        {
+            const char *q = &buffer[j * record_size];
+            const size_t n = i + j;
+            std::memcpy (&pc.x[n], q, sizeof(double)); q += sizeof(double);
+            std::memcpy (&pc.y[n], q, sizeof(double)); q += sizeof(double);
+            std::memcpy (&pc.z[n], q, sizeof(double)); q += sizeof(double);
+            std::memcpy (&pc.c[n], q, sizeof(uint32_t)); q += sizeof(uint32_t);
+            std::memcpy (&pc.p[n], q, sizeof(uint32_t)); q += sizeof(uint32_t);
+            std::memcpy (&pc.i[n], q, sizeof(uint16_t)); q += sizeof(uint16_t);
+            std::memcpy (&pc.r[n], q, sizeof(uint16_t)); q += sizeof(uint16_t);
+            std::memcpy (&pc.g[n], q, sizeof(uint16_t)); q += sizeof(uint16_t);
+            std::memcpy (&pc.b[n], q, sizeof(uint16_t)); q += sizeof(uint16_t);
+            for (size_t k = 0; k < extra_fields; ++k, q += sizeof(uint64_t))
+                std::memcpy (&pc.extra[k][n], q, sizeof(uint64_t));
+        }
+    }
+
+    return pc;
+}
+
+/// @brief Reads uncompressed point records as they stream in
+///
+/// Files that know their number of points store the records back to
+/// back. Streaming files store them in frames that each start with
+/// their number of records, and a frame with no records marks the end.
+class point_record_reader
+{
+    private:
+    std::istream &s;
+    size_t extra_fields;
+    bool framed;
+    size_t left;
+    bool done = false;
+
+    // Make sure that there is a record to read
+    bool next_frame ()
+    {
+        if (left != 0)
+            return true;
+        if (!framed || done)
+            return false;
+        uint64_t n = 0;
+        s.read (reinterpret_cast<char*>(&n), sizeof(uint64_t));
+        if (!s)
+            throw std::runtime_error ("Error reading point records");
+        left = n;
+        done = (n == 0);
+        return !done;
+    }
+
+    public:
+    /// @brief CTOR
+    /// @param s Input stream positioned just after the header
+    /// @param h Header that has already been read from the stream
+    point_record_reader (std::istream &s, const header::header &h)
+        : s (s)
+        , extra_fields (h.extra_fields)
+        , framed (h.streaming)
+        , left (h.streaming ? 0 : h.total_points)
+    {
+        if (h.compressed)
+            throw std::runtime_error ("Uncompressed reader can't read a compressed file");
+    }
+
+    /// @brief Read the next record
+    /// @param p The record
+    /// @return False if there are no more records
+    bool read (point_record::point_record &p)
+    {
+        if (!next_frame ())
+            return false;
+        p = point_record::read_point_record (s, extra_fields);
+        if (!s)
+            throw std::runtime_error ("Error reading point records");
+        --left;
+        return true;
+    }
+
+    /// @brief Read the next records in bulk
+    /// @param max_points Maximum number of records to read
+    /// @return The records, which are only empty after the last one
+    columns::point_columns read_columns (const size_t max_points = std::numeric_limits<size_t>::max ())
+    {
+        columns::point_columns pc (0, extra_fields);
+        while (pc.size () < max_points && next_frame ())
+        {
+            const size_t n = std::min (left, max_points - pc.size ());
+            auto q = read_uncompressed_columns (s, n, extra_fields);
+            if (!s)
+                throw std::runtime_error ("Error reading point records");
+            if (pc.empty ())
+                pc = std::move (q);
+            else
+                columns::append (pc, q);
+            left -= n;
+        }
+        return pc;
+    }
+};
+
+/// Helper I/O function
+/// @param s Input stream positioned just after the header
+/// @param h Header that has already been read from the stream
+inline columns::point_columns read_uncompressed_columns (std::istream &s, const header::header &h)
+{
+    return point_record_reader (s, h).read_columns ();
+}
+
+/// Helper I/O function
+/// @param s Input stream positioned just after the header
+/// @param h Header that has already been read from the stream
+inline point_record::point_records read_uncompressed_points (std::istream &s, const header::header &h)
+{
+    if (h.streaming)
+        return columns::to_point_records (read_uncompressed_columns (s, h));
+    return read_uncompressed_points (s, h.total_points, h.extra_fields);
+}
+
 /// Helper I/O function
 /// @param s Input stream
 inline spoc::file::spoc_file read_spoc_file_uncompressed (std::istream &s)
@@ -171,7 +717,7 @@ inline spoc::file::spoc_file read_spoc_file_uncompressed (std::istream &s)
         throw std::runtime_error ("Uncompressed reader can't read a compressed file");
 
     // Read the data
-    point_record::point_records prs = read_uncompressed_points (s, h.total_points, h.extra_fields);
+    point_record::point_records prs = read_uncompressed_points (s, h);
 
     // Create the file
     spoc::file::spoc_file f (h.wkt, false, prs);
@@ -183,46 +729,322 @@ inline spoc::file::spoc_file read_spoc_file_uncompressed (std::istream &s)
 /// @param s Input stream
 /// @param total_points Number of records to read
 /// @param extra_fields Number of extra fields in each record
-inline point_record::point_records read_compressed_points (std::istream &s,
+///
+/// Version 0.1 files compress each field as a single stream.
+inline columns::point_columns read_compressed_columns_v1 (std::istream &s,
     const size_t total_points,
-    const size_t extra_fields)
+    const size_t extra_fields,
+    const columns::field_mask &m = columns::field_mask::all ())
 {
-    // Read data
-    std::vector<double> x = read_compressed<double> (s, total_points);
-    std::vector<double> y = read_compressed<double> (s, total_points);
-    std::vector<double> z = read_compressed<double> (s, total_points);
-    std::vector<uint32_t> c = read_compressed<uint32_t> (s, total_points);
-    std::vector<uint32_t> p = read_compressed<uint32_t> (s, total_points);
-    std::vector<uint16_t> i = read_compressed<uint16_t> (s, total_points);
-    std::vector<uint16_t> r = read_compressed<uint16_t> (s, total_points);
-    std::vector<uint16_t> g = read_compressed<uint16_t> (s, total_points);
-    std::vector<uint16_t> b = read_compressed<uint16_t> (s, total_points);
+    // Read all of the compressed fields first
+    std::vector<std::vector<uint8_t>> fields (columns::FIXED_FIELDS + extra_fields);
+    for (size_t j = 0; j < fields.size (); ++j)
+    {
+        uint64_t n = 0;
+        s.read (reinterpret_cast<char*>(&n), sizeof(uint64_t));
+        if (m.test (j))
+        {
+            fields[j].resize (n);
+            s.read (reinterpret_cast<char *> (fields[j].data ()), n);
+        }
+        else
+            skip_bytes (s, n);
+        if (!s)
+            throw std::runtime_error ("Error reading compressed fields");
+    }
 
-    std::vector<std::vector<uint64_t>> extra (extra_fields);
-    for (size_t j = 0; j < extra.size (); ++j)
-        extra[j] = read_compressed<uint64_t> (s, total_points);
+    // Then decompress them in parallel, straight into the columns. An
+    // empty field means that the field was all zeros.
+    columns::point_columns pc (total_points, extra_fields);
+    utils::parallel_for (fields.size (), [&](const size_t j)
+    {
+        if (fields[j].empty ())
+            return;
+        columns::visit_column (pc, j, [&](auto &v)
+        {
+            spoc::compression::decompress (fields[j],
+                reinterpret_cast<uint8_t *> (v.data ()),
+                v.size () * sizeof(v[0]));
+        });
+    });
+
+    return pc;
+}
+
+/// Helper I/O function
+/// @param s Input stream positioned just after the header
+/// @param h Header that has already been read from the stream
+/// @param m Fields to read, the others are skipped
+/// @param f Function that takes each 'compressed_block' by rvalue
+/// reference, and returns false to stop reading
+///
+/// This reads the blocks of a version 0.2 or later file, up to and
+/// including the end marker.
+template<typename F>
+inline void read_compressed_blocks (std::istream &s,
+    const header::header &h,
+    const columns::field_mask &m,
+    F &&f)
+{
+    // Points per block, which the reader does not need
+    uint64_t block_size = 0;
+    s.read (reinterpret_cast<char*>(&block_size), sizeof(uint64_t));
+
+    // Read blocks until the end marker
+    size_t total_points = 0;
+    for (;;)
+    {
+        auto b = read_compressed_block (s, h.extra_fields, m);
+        if (b.total_points == 0)
+            break;
+        total_points += b.total_points;
+        if (!h.streaming && total_points > h.total_points)
+            break;
+        if (!f (std::move (b)))
+            return;
+    }
+    if (!h.streaming && total_points != h.total_points)
+        throw std::runtime_error ("The number of compressed points does not match the header");
+}
+
+/// Helper I/O function
+/// @param s Input stream positioned just after the header
+/// @param h Header that has already been read from the stream
+/// @param m Fields to read, the others are skipped
+inline std::vector<compressed_block> read_compressed_blocks (std::istream &s,
+    const header::header &h,
+    const columns::field_mask &m = columns::field_mask::all ())
+{
+    std::vector<compressed_block> bs;
+    read_compressed_blocks (s, h, m, [&](compressed_block &&b)
+    {
+        bs.push_back (std::move (b));
+        return true;
+    });
+    return bs;
+}
+
+/// Default number of blocks that a block_reader reads ahead
+constexpr size_t DEFAULT_READ_AHEAD = 4;
+
+/// @brief Reads the compressed blocks of a file on a background thread
+///
+/// The thread stays up to 'read_ahead' blocks ahead of the caller, so
+/// reading the next blocks overlaps decompressing the current ones,
+/// and at most that many compressed blocks wait in memory.
+class block_reader
+{
+    private:
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<compressed_block> q;
+    size_t read_ahead;
+    bool done = false;
+    bool stop = false;
+    std::exception_ptr error;
+    std::thread t;
+
+    void read_blocks (std::istream &s, const header::header &h, const columns::field_mask &m)
+    {
+        bool stopped = false;
+        read_compressed_blocks (s, h, m, [&](compressed_block &&b)
+        {
+            // Wait for room in the queue
+            std::unique_lock<std::mutex> lock (mtx);
+            cv.wait (lock, [&] { return stop || q.size () < read_ahead; });
+            stopped = stop;
+            if (!stopped)
+                q.push_back (std::move (b));
+            cv.notify_all ();
+            return !stopped;
+        });
+
+        // Skip over the directory
+        if (!stopped)
+            read_block_directory_entries (s, h);
+    }
+
+    public:
+    /// @brief CTOR
+    /// @param s Input stream positioned just after the header. The
+    /// caller must not use it until the reader is done.
+    /// @param h Header that has already been read from the stream
+    /// @param read_ahead Maximum number of blocks to read ahead
+    /// @param m Fields to read, the others are skipped
+    block_reader (std::istream &s,
+        const header::header &h,
+        const size_t read_ahead = DEFAULT_READ_AHEAD,
+        const columns::field_mask &m = columns::field_mask::all ())
+        : read_ahead (std::max (read_ahead, size_t (1)))
+        , t ([this, &s, h, m]
+        {
+            try
+            {
+                read_blocks (s, h, m);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock (mtx);
+                error = std::current_exception ();
+            }
+            std::lock_guard<std::mutex> lock (mtx);
+            done = true;
+            cv.notify_all ();
+        })
+    {
+    }
+    block_reader (const block_reader &) = delete;
+    block_reader &operator= (const block_reader &) = delete;
+    /// @brief DTOR
+    ~block_reader ()
+    {
+        {
+            std::lock_guard<std::mutex> lock (mtx);
+            stop = true;
+        }
+        cv.notify_all ();
+        t.join ();
+    }
 
-    // Copy them into the point records
-    point_record::point_records prs (total_points);
+    /// @brief Get the blocks that have been read, waiting for at least one
+    /// @return The blocks in file order, or no blocks after the last one
+    ///
+    /// Errors on the reading thread are rethrown here.
+    std::vector<compressed_block> pop ()
+    {
+        std::unique_lock<std::mutex> lock (mtx);
+        cv.wait (lock, [&] { return !q.empty () || done; });
+        if (error)
+            std::rethrow_exception (error);
+        std::vector<compressed_block> bs (std::make_move_iterator (q.begin ()),
+            std::make_move_iterator (q.end ()));
+        q.clear ();
+        cv.notify_all ();
+        return bs;
+    }
+};
 
-    #pragma omp parallel for
-    for (size_t n = 0; n < prs.size (); ++n)
+/// Helper I/O function
+/// @param s Input stream
+/// @param h Header that has already been read from the stream
+/// @param m Fields to read, the others are skipped and set to zero
+/// @param read_ahead Maximum number of blocks to read ahead
+///
+/// Blocks are read on a background thread while the blocks that have
+/// already been read are decompressed.
+inline columns::point_columns read_compressed_columns (std::istream &s,
+    const header::header &h,
+    const columns::field_mask &m = columns::field_mask::all (),
+    const size_t read_ahead = DEFAULT_READ_AHEAD)
+{
+    if (h.minor_version < 2)
+        return read_compressed_columns_v1 (s, h.total_points, h.extra_fields, m);
+
+    columns::point_columns pc (h.total_points, h.extra_fields);
+    block_reader r (s, h, read_ahead, m);
+    size_t first = 0;
+    for (auto bs = r.pop (); !bs.empty (); bs = r.pop ())
     {
-        if (!x.empty ()) prs[n].x = x[n];
-        if (!y.empty ()) prs[n].y = y[n];
-        if (!z.empty ()) prs[n].z = z[n];
-        if (!c.empty ()) prs[n].c = c[n];
-        if (!p.empty ()) prs[n].p = p[n];
-        if (!i.empty ()) prs[n].i = i[n];
-        if (!r.empty ()) prs[n].r = r[n];
-        if (!g.empty ()) prs[n].g = g[n];
-        if (!b.empty ()) prs[n].b = b[n];
-        prs[n].extra.resize (extra_fields);
-        for (size_t j = 0; j < prs[n].extra.size (); ++j)
-            if (!extra[j].empty ()) prs[n].extra[j] = extra[j][n];
+        size_t n = first;
+        for (const auto &b : bs)
+            n += b.total_points;
+
+        // A streamed file doesn't know its size until it has been read
+        if (h.streaming)
+            pc.resize (n);
+
+        // Decompress whatever has been read so far
+        decompress_blocks (bs, pc, first);
+        first = n;
     }
 
-    return prs;
+    return pc;
+}
+
+/// Read the points in the blocks whose statistics satisfy a predicate
+/// @param s Input stream
+/// @param h Header that has already been read from the stream
+/// @param pred Function that takes a 'stats::block_stats' and returns
+/// false when none of the block's points are needed
+/// @param m Fields to read, the others are skipped and set to zero
+///
+/// The result is a superset of the points that satisfy the caller's
+/// filter, so the caller still has to apply it. Files without
+/// statistics return every point. Blocks that are not needed are never
+/// decompressed, and on seekable streams they are never read.
+template<typename F>
+inline columns::point_columns read_compressed_columns_if (std::istream &s,
+    const header::header &h,
+    F &&pred,
+    const columns::field_mask &m = columns::field_mask::all ())
+{
+    if (h.minor_version < 3)
+        return read_compressed_columns (s, h, m);
+
+    std::vector<compressed_block> bs;
+    const auto start = s.tellg ();
+    if (start != std::streampos (-1))
+    {
+        // Use the directory to seek to the blocks that are needed
+        for (const auto &e : read_block_directory (s, h))
+        {
+            if (!pred (*e.stats))
+                continue;
+            s.seekg (start + static_cast<std::streamoff> (e.offset));
+            auto b = read_compressed_block (s, h.extra_fields, m);
+            if (b.total_points != e.total_points)
+                throw std::runtime_error ("The block directory does not match the compressed blocks");
+            bs.push_back (std::move (b));
+        }
+
+        // Leave the stream where a full read would
+        s.seekg (0, std::ios::end);
+    }
+    else
+    {
+        // Read everything, since the directory comes last
+        auto all = read_compressed_blocks (s, h, m);
+        const auto d = read_block_directory_entries (s, h);
+        if (d.size () != all.size ())
+            throw std::runtime_error ("The block directory does not match the compressed blocks");
+        for (size_t k = 0; k < d.size (); ++k)
+            if (pred (*d[k].stats))
+                bs.push_back (std::move (all[k]));
+    }
+
+    size_t total_points = 0;
+    for (const auto &b : bs)
+        total_points += b.total_points;
+    columns::point_columns pc (total_points, h.extra_fields);
+    decompress_blocks (bs, pc);
+
+    return pc;
+}
+
+/// Helper I/O function
+/// @param s Input stream
+/// @param h Header that has already been read from the stream
+/// @param m Fields to read, the others are skipped and set to zero
+inline point_record::point_records read_compressed_points (std::istream &s,
+    const header::header &h,
+    const columns::field_mask &m = columns::field_mask::all ())
+{
+    return columns::to_point_records (read_compressed_columns (s, h, m));
+}
+
+/// Helper I/O function
+/// @param s Input stream
+/// @param total_points Number of records to read
+/// @param extra_fields Number of extra fields in each record
+///
+/// The points must be in the current format. Use the overload that takes
+/// the header to read files from older versions.
+inline point_record::point_records read_compressed_points (std::istream &s,
+    const size_t total_points,
+    const size_t extra_fields)
+{
+    const header::header h (std::string (), extra_fields, total_points, true);
+    return read_compressed_points (s, h);
 }
 
 /// Helper I/O function
@@ -237,7 +1059,7 @@ inline spoc::file::spoc_file read_spoc_file_compressed (std::istream &s)
         throw std::runtime_error ("Compressed reader can't read an uncompressed file");
 
     // Read the data
-    point_record::point_records prs = read_compressed_points (s, h.total_points, h.extra_fields);
+    point_record::point_records prs = read_compressed_points (s, h);
 
     // Create the file
     spoc::file::spoc_file f (h.wkt, true, prs);
@@ -257,9 +1079,9 @@ inline spoc::file::spoc_file read_spoc_file (std::istream &s)
 
     // Check compression flag
     if (h.compressed)
-        prs = read_compressed_points (s, h.total_points, h.extra_fields);
+        prs = read_compressed_points (s, h);
     else
-        prs = read_uncompressed_points (s, h.total_points, h.extra_fields);
+        prs = read_uncompressed_points (s, h);
 
     // Create the file
     spoc::file::spoc_file f (h.wkt, h.compressed, prs);
@@ -267,6 +1089,356 @@ inline spoc::file::spoc_file read_spoc_file (std::istream &s)
     return f;
 }
 
+/// Helper I/O function
+/// @param s Input stream
+/// @param h Header that has already been read from the stream
+/// @param m Fields to read, the others are set to zero
+///
+/// Compressed files skip the unselected fields without decompressing
+/// them. Uncompressed files interleave the fields, so they are read in
+/// full.
+inline columns::point_columns read_point_columns (std::istream &s,
+    const header::header &h,
+    const columns::field_mask &m = columns::field_mask::all ())
+{
+    if (h.compressed)
+        return read_compressed_columns (s, h, m);
+    auto pc = read_uncompressed_columns (s, h);
+    if (!m.test_all (columns::FIXED_FIELDS + h.extra_fields))
+        columns::clear_unselected (pc, m);
+    return pc;
+}
+
+/// @brief Reads the points of a file a chunk at a time, compressed or not
+///
+/// Uncompressed files are read 'chunk_size' points at a time.
+/// Compressed files are read as a block_reader delivers their blocks,
+/// and version 0.1 compressed files, which have no blocks, are read in
+/// one chunk.
+class point_columns_reader
+{
+    private:
+    std::istream &s;
+    header::header h;
+    size_t chunk_size;
+    columns::field_mask m;
+    std::optional<point_record_reader> pr;
+    std::optional<block_reader> br;
+    bool done = false;
+
+    public:
+    /// @brief CTOR
+    /// @param s Input stream positioned just after the header
+    /// @param h Header that has already been read from the stream
+    /// @param chunk_size Number of uncompressed points in each chunk
+    /// @param m Fields to read, the others are set to zero
+    point_columns_reader (std::istream &s,
+        const header::header &h,
+        const size_t chunk_size = DEFAULT_BLOCK_SIZE,
+        const columns::field_mask &m = columns::field_mask::all ())
+        : s (s)
+        , h (h)
+        , chunk_size (chunk_size)
+        , m (m)
+    {
+        REQUIRE (chunk_size != 0);
+        if (!h.compressed)
+            pr.emplace (s, h);
+        else if (h.minor_version >= 2)
+            br.emplace (s, h, DEFAULT_READ_AHEAD, m);
+    }
+
+    /// @brief Get the header
+    const header::header &get_header () const { return h; }
+
+    /// @brief Read the next chunk
+    /// @return The points, which are only empty after the last chunk
+    columns::point_columns read ()
+    {
+        if (pr)
+        {
+            auto pc = pr->read_columns (chunk_size);
+            if (!m.test_all (columns::FIXED_FIELDS + h.extra_fields))
+                columns::clear_unselected (pc, m);
+            return pc;
+        }
+        if (br)
+        {
+            const auto bs = br->pop ();
+            size_t n = 0;
+            for (const auto &b : bs)
+                n += b.total_points;
+            columns::point_columns pc (n, h.extra_fields);
+            decompress_blocks (bs, pc);
+            return pc;
+        }
+        if (done)
+            return columns::point_columns (0, h.extra_fields);
+        done = true;
+        return read_compressed_columns_v1 (s, h.total_points, h.extra_fields, m);
+    }
+};
+
+/// Read some of the fields of a spoc file
+/// @param s Input stream
+/// @param m Fields to read, the others are set to zero
+inline spoc::file::spoc_file read_spoc_file (std::istream &s, const columns::field_mask &m)
+{
+    const auto h = header::read_header (s);
+    const auto pc = read_point_columns (s, h, m);
+    return spoc::file::spoc_file (h.wkt, h.compressed, columns::to_point_records (pc));
+}
+
+/// Read the points of a spoc file that may satisfy a filter
+/// @param s Input stream
+/// @param pred Function that takes a 'stats::block_stats' and returns
+/// false when none of the block's points are needed
+///
+/// The caller must still apply its filter to the points, see
+/// read_compressed_columns_if().
+template<typename F>
+inline spoc::file::spoc_file read_spoc_file_if (std::istream &s, F &&pred)
+{
+    const auto h = header::read_header (s);
+    const auto pc = h.compressed
+        ? read_compressed_columns_if (s, h, pred)
+        : read_uncompressed_columns (s, h);
+    return spoc::file::spoc_file (h.wkt, h.compressed, columns::to_point_records (pc));
+}
+
+/// Read the points of a spoc file that lie inside an extent
+/// @param s Input stream
+/// @param e Extent
+///
+/// Blocks that lie outside of the extent are skipped, then the
+/// remaining points are cropped.
+inline spoc::file::spoc_file read_cropped_spoc_file (std::istream &s, const extent::extent &e)
+{
+    auto f = read_spoc_file_if (s, [&](const stats::block_stats &b)
+        { return stats::may_intersect (b, e); });
+    f.set_point_records (utils::crop (f.get_point_records (), e));
+    return f;
+}
+
+/// Get the extent of the points in a spoc file
+/// @param s Input stream
+///
+/// Only the header is read, unless the header doesn't store the
+/// extent. Then x, y, and z are scanned a chunk at a time, and NaN and
+/// infinite coordinates are skipped.
+inline extent::extent read_extent (std::istream &s)
+{
+    const auto h = header::read_header (s);
+    if (h.e)
+        return *h.e;
+    auto e = columns::get_extent (columns::point_columns ());
+    point_columns_reader r (s, h, DEFAULT_BLOCK_SIZE, columns::field_mask {"x", "y", "z"});
+    for (auto pc = r.read (); !pc.empty (); pc = r.read ())
+        e = extent::get_total_extent (e, columns::get_finite_extent (pc));
+    return e;
+}
+
+/// Get the extent to store in a header
+/// @param e The extent of the finite coordinates, see get_finite_extent()
+/// @param total_points Number of points
+///
+/// Files without points don't store an extent. An axis that doesn't
+/// have any finite coordinates gets an unbounded range, since no bound
+/// can exclude a NaN. Every writer stores the same extent for the same
+/// points.
+inline std::optional<extent::extent> get_header_extent (extent::extent e, const size_t total_points)
+{
+    if (total_points == 0)
+        return std::nullopt;
+    const auto unbounded = [](double &lo, double &hi)
+    {
+        if (lo <= hi)
+            return;
+        lo = -std::numeric_limits<double>::infinity ();
+        hi = std::numeric_limits<double>::infinity ();
+    };
+    unbounded (e.minp.x, e.maxp.x);
+    unbounded (e.minp.y, e.maxp.y);
+    unbounded (e.minp.z, e.maxp.z);
+    return e;
+}
+
+/// @brief When a point_record_writer flushes its output stream
+enum class flush_policy
+{
+    block,  ///< Flush the stream only when a full block has been written
+    record, ///< Flush the stream after every record, for interactive pipes
+};
+
+/// @brief Buffered writer for uncompressed point records
+///
+/// Records are serialized into a staging buffer, and the buffer is
+/// written to the stream in one call when it fills up. Call flush()
+/// when done. The DTOR also flushes, but it can't report errors.
+///
+/// The records of a streaming file are framed, see
+/// point_record_reader. Each write of the buffer is one frame, and
+/// close() writes the end marker.
+class point_record_writer
+{
+    private:
+    std::ostream &s;
+    size_t extra_fields;
+    flush_policy policy;
+    std::vector<char> buffer;
+    size_t n = 0;
+    bool framed = false;
+    bool closed = false;
+
+    void write_buffer ()
+    {
+        if (n == 0)
+            return;
+        if (framed)
+        {
+            const uint64_t records = n / get_record_size (extra_fields);
+            s.write (reinterpret_cast<const char*>(&records), sizeof(uint64_t));
+        }
+        s.write (buffer.data (), n);
+        n = 0;
+        if (!s)
+            throw std::runtime_error ("Error writing point records");
+    }
+
+    public:
+    /// @brief CTOR
+    /// @param s Output stream
+    /// @param extra_fields Number of extra fields in each record
+    /// @param policy Stream flush policy
+    /// @param block_size Size of the staging buffer in bytes
+    point_record_writer (std::ostream &s,
+        const size_t extra_fields,
+        const flush_policy policy = flush_policy::block,
+        const size_t block_size = 1 << 20)
+        : s (s)
+        , extra_fields (extra_fields)
+        , policy (policy)
+        , buffer (std::max (block_size, get_record_size (extra_fields)))
+    {
+    }
+    /// @brief CTOR
+    /// @param s Output stream
+    /// @param h Header that has already been written to the stream
+    /// @param policy Stream flush policy
+    point_record_writer (std::ostream &s,
+        const header::header &h,
+        const flush_policy policy = flush_policy::block)
+        : point_record_writer (s, h.extra_fields, policy)
+    {
+        framed = h.streaming;
+    }
+    point_record_writer (const point_record_writer &) = delete;
+    point_record_writer &operator= (const point_record_writer &) = delete;
+    /// @brief DTOR
+    ~point_record_writer ()
+    {
+        try { flush (); }
+        catch (...) { }
+    }
+
+    /// @brief Get the flush policy
+    flush_policy get_flush_policy () const { return policy; }
+
+    /// @brief Get the number of bytes waiting to be written
+    size_t get_pending_bytes () const { return n; }
+
+    /// @brief Serialize a record into the staging buffer
+    /// @param p Point record to write
+    void write (const point_record::point_record &p)
+    {
+        if (p.extra.size () != extra_fields)
+            throw std::runtime_error ("The number of extra fields is incorrect");
+
+        const size_t record_size = get_record_size (extra_fields);
+        if (n + record_size > buffer.size ())
+            write_buffer ();
+
+        char *q = buffer.data () + n;
+        std::memcpy (q, &p.x, sizeof(double)); q += sizeof(double);
+        std::memcpy (q, &p.y, sizeof(double)); q += sizeof(double);
+        std::memcpy (q, &p.z, sizeof(double)); q += sizeof(double);
+        std::memcpy (q, &p.c, sizeof(uint32_t)); q += sizeof(uint32_t);
+        std::memcpy (q, &p.p, sizeof(uint32_t)); q += sizeof(uint32_t);
+        std::memcpy (q, &p.i, sizeof(uint16_t)); q += sizeof(uint16_t);
+        std::memcpy (q, &p.r, sizeof(uint16_t)); q += sizeof(uint16_t);
+        std::memcpy (q, &p.g, sizeof(uint16_t)); q += sizeof(uint16_t);
+        std::memcpy (q, &p.b, sizeof(uint16_t)); q += sizeof(uint16_t);
+        if (extra_fields != 0)
+            std::memcpy (q, p.extra.data (), extra_fields * sizeof(uint64_t));
+        n += record_size;
+
+        if (policy == flush_policy::record)
+            flush ();
+    }
+
+    /// @brief Serialize a range of records
+    /// @param prs Point records to write
+    void write (const point_record::point_records &prs)
+    {
+        for (const auto &p : prs)
+            write (p);
+    }
+
+    /// @brief Serialize points straight from their columns
+    /// @param pc Point columns to write
+    void write (const columns::point_columns &pc)
+    {
+        REQUIRE (pc.is_valid ());
+        if (pc.get_extra_fields () != extra_fields)
+            throw std::runtime_error ("The number of extra fields is incorrect");
+
+        const size_t record_size = get_record_size (extra_fields);
+        for (size_t k = 0; k < pc.size (); ++k)
+        {
+            if (n + record_size > buffer.size ())
+                write_buffer ();
+
+            char *q = buffer.data () + n;
+            std::memcpy (q, &pc.x[k], sizeof(double)); q += sizeof(double);
+            std::memcpy (q, &pc.y[k], sizeof(double)); q += sizeof(double);
+            std::memcpy (q, &pc.z[k], sizeof(double)); q += sizeof(double);
+            std::memcpy (q, &pc.c[k], sizeof(uint32_t)); q += sizeof(uint32_t);
+            std::memcpy (q, &pc.p[k], sizeof(uint32_t)); q += sizeof(uint32_t);
+            std::memcpy (q, &pc.i[k], sizeof(uint16_t)); q += sizeof(uint16_t);
+            std::memcpy (q, &pc.r[k], sizeof(uint16_t)); q += sizeof(uint16_t);
+            std::memcpy (q, &pc.g[k], sizeof(uint16_t)); q += sizeof(uint16_t);
+            std::memcpy (q, &pc.b[k], sizeof(uint16_t)); q += sizeof(uint16_t);
+            for (size_t j = 0; j < extra_fields; ++j, q += sizeof(uint64_t))
+                std::memcpy (q, &pc.extra[j][k], sizeof(uint64_t));
+            n += record_size;
+        }
+
+        if (policy == flush_policy::record)
+            flush ();
+    }
+
+    /// @brief Write any buffered records and flush the stream
+    void flush ()
+    {
+        write_buffer ();
+        s.flush ();
+    }
+
+    /// @brief Flush, and end the records of a streaming file
+    void close ()
+    {
+        flush ();
+        if (!framed || closed)
+            return;
+        closed = true;
+        const uint64_t end = 0;
+        s.write (reinterpret_cast<const char*>(&end), sizeof(uint64_t));
+        s.flush ();
+        if (!s)
+            throw std::runtime_error ("Error writing point records");
+    }
+};
+
 /// Helper I/O function
 /// @param s Output stream
 /// @param f File structure to write
@@ -279,112 +1451,575 @@ inline void write_spoc_file_uncompressed (std::ostream &s, const spoc::file::spo
         throw std::runtime_error ("Uncompressed writer can't write a compressed file");
 
     // Write the header
-    write_header (s, f.get_header ());
+    header::header h = f.get_header ();
+    h.e = get_header_extent (extent::get_finite_extent (f.get_point_records ()),
+        f.get_point_records ().size ());
+    write_header (s, h);
 
     // Write the points
-    for (const auto &p : f.get_point_records ())
-        write_point_record (s, p);
+    point_record_writer w (s, h.extra_fields);
+    w.write (f.get_point_records ());
+    w.flush ();
+}
+
+/// Make sure that a set of compression options can be used for writing
+/// @param opts Compression options
+inline void check_compression_options (const compression_options &opts)
+{
+    if (opts.block_size == 0)
+        throw std::runtime_error ("The compressed block size must be greater than zero");
+    if (opts.codec == compression::codec::zero || opts.float_codec == compression::codec::zero)
+        throw std::runtime_error ("The 'zero' codec can't be used to compress fields");
+    if (opts.codec == compression::codec::gorilla)
+        throw std::runtime_error ("The 'gorilla' codec can only be used for x, y, and z");
+    if (opts.float_codec == compression::codec::gorilla && (opts.float_filter & filters::PACK))
+        throw std::runtime_error ("The 'gorilla' codec can't be used with the 'pack' filter");
 }
 
 /// Helper I/O function
 /// @param s Output stream
-/// @param f File structure to write
-inline void write_spoc_file_compressed (std::ostream &s, const spoc::file::spoc_file &f)
+/// @param pc Point columns to write
+/// @param opts Compression options
+///
+/// The compressed data consists of the block size, the blocks, an
+/// end marker, the block directory, and a trailer that contains the
+/// offset of the block directory. All offsets are relative to the
+/// start of the compressed data.
+inline void write_compressed_columns (std::ostream &s,
+    const columns::point_columns &pc,
+    const compression_options &opts = compression_options ())
 {
-    REQUIRE (f.is_valid ());
+    REQUIRE (pc.is_valid ());
+    check_compression_options (opts);
+    const size_t block_size = opts.block_size;
 
-    // Check compression flag
-    if (!f.get_compressed ())
-        throw std::runtime_error ("Compressed writer can't write an uncompressed file");
+    // Write the block size
+    const uint64_t n = block_size;
+    s.write (reinterpret_cast<const char*>(&n), sizeof(uint64_t));
+    uint64_t offset = sizeof(uint64_t);
 
-    // Get the point records
-    const auto &prs = f.get_point_records ();
-
-    // Stuff the data into vectors
-    const size_t total_points = prs.size ();
-    const size_t extra_fields = prs.empty ()
-        ? 0
-        : prs[0].extra.size ();
-    std::vector<double> x (total_points);
-    std::vector<double> y (total_points);
-    std::vector<double> z (total_points);
-    std::vector<uint32_t> c (total_points);
-    std::vector<uint32_t> p (total_points);
-    std::vector<uint16_t> i (total_points);
-    std::vector<uint16_t> r (total_points);
-    std::vector<uint16_t> g (total_points);
-    std::vector<uint16_t> b (total_points);
-    std::vector<std::vector<uint64_t>> e (extra_fields, std::vector<uint64_t>(total_points));
-
-    for (size_t n = 0; n < total_points; ++n)
-    {
-        x[n] = prs[n].x;
-        y[n] = prs[n].y;
-        z[n] = prs[n].z;
-        c[n] = prs[n].c;
-        p[n] = prs[n].p;
-        i[n] = prs[n].i;
-        r[n] = prs[n].r;
-        g[n] = prs[n].g;
-        b[n] = prs[n].b;
-        for (size_t j = 0; j < extra_fields; ++j)
-            e[j][n] = prs[n].extra[j];
+    // Write the blocks
+    block_directory d;
+    for (size_t first = 0; first < pc.size (); first += block_size)
+    {
+        const size_t total_points = std::min (block_size, pc.size () - first);
+        const auto b = compress_block (pc, first, total_points, opts);
+        d.push_back (block_entry {offset, total_points, stats::get_block_stats (pc, first, total_points)});
+        offset += write_compressed_block (s, b);
     }
+    offset += write_block_end_marker (s);
 
-    // Compress fields in parallel
-    std::vector<std::vector<uint8_t>> fields (9);
-    #pragma omp parallel sections
-    {
-        #pragma omp section
-        { fields[0] = compress_field (x); }
-        #pragma omp section
-        { fields[1] = compress_field (y); }
-        #pragma omp section
-        { fields[2] = compress_field (z); }
-        #pragma omp section
-        { fields[3] = compress_field (c); }
-        #pragma omp section
-        { fields[4] = compress_field (p); }
-        #pragma omp section
-        { fields[5] = compress_field (i); }
-        #pragma omp section
-        { fields[6] = compress_field (r); }
-        #pragma omp section
-        { fields[7] = compress_field (g); }
-        #pragma omp section
-        { fields[8] = compress_field (b); }
-    }
-
-    // Compress extra fields in parallel
-    std::vector<std::vector<uint8_t>> extras (e.size ());
-    #pragma omp parallel for
-    for (size_t j = 0; j < extras.size (); ++j)
-        extras[j] = compress_field (e[j]);
+    // Write the directory
+    write_block_directory (s, d, offset);
+}
+
+/// Helper I/O function
+/// @param s Output stream
+/// @param wkt OGC WKT string
+/// @param pc Point columns to write
+/// @param opts Compression options
+inline void write_spoc_file_compressed (std::ostream &s,
+    const std::string &wkt,
+    const columns::point_columns &pc,
+    const compression_options &opts = compression_options ())
+{
+    REQUIRE (pc.is_valid ());
 
     // Write the header
-    const header::header &h = f.get_header ();
+    header::header h (wkt, pc.get_extra_fields (), pc.size (), true);
+    h.e = get_header_extent (columns::get_finite_extent (pc), pc.size ());
     write_header (s, h);
 
     // Write the compressed data
-    for (size_t j = 0; j < fields.size (); ++j)
-        write_compressed (s, fields[j]);
+    write_compressed_columns (s, pc, opts);
+}
+
+/// Helper I/O function
+/// @param s Output stream
+/// @param f File structure to write
+/// @param opts Compression options
+inline void write_spoc_file_compressed (std::ostream &s,
+    const spoc::file::spoc_file &f,
+    const compression_options &opts = compression_options ())
+{
+    REQUIRE (f.is_valid ());
 
-    for (size_t j = 0; j < extras.size (); ++j)
-        write_compressed (s, extras[j]);
+    // Check compression flag
+    if (!f.get_compressed ())
+        throw std::runtime_error ("Compressed writer can't write an uncompressed file");
+
+    // Write the header. The compressed data is always written in the
+    // current format, so the version must be current, too.
+    const auto pc = columns::to_point_columns (f);
+    header::header h = f.get_header ();
+    h.major_version = MAJOR_VERSION;
+    h.minor_version = MINOR_VERSION;
+    h.e = get_header_extent (columns::get_finite_extent (pc), pc.size ());
+    write_header (s, h);
+
+    // Write the columns
+    write_compressed_columns (s, pc, opts);
 }
 
 /// Helper I/O function
 /// @param s Output stream
 /// @param f File structure to write
-inline void write_spoc_file (std::ostream &s, const spoc::file::spoc_file &f)
+/// @param opts Compression options, used if the file is compressed
+inline void write_spoc_file (std::ostream &s,
+    const spoc::file::spoc_file &f,
+    const compression_options &opts = compression_options ())
 {
     // Check compression flag
     if (f.get_header ().compressed)
-        write_spoc_file_compressed (s, f);
+        write_spoc_file_compressed (s, f, opts);
     else
         write_spoc_file_uncompressed (s, f);
 }
 
+/// Default number of full blocks that a compressed_writer lets wait
+/// for the background thread
+constexpr size_t DEFAULT_WRITE_BEHIND = 4;
+
+/// @brief Writes a compressed file incrementally
+///
+/// Points are staged into blocks, and full blocks are compressed and
+/// written on a background thread while the caller fills the next
+/// ones, so only a few blocks are ever held in memory.
+///
+/// On a seekable stream, close() patches the number of points and the
+/// extent into the header. Otherwise the header is marked as
+/// streaming, and readers count the points in the blocks. The block
+/// directory at the end of the data has the counts, too. The header is
+/// written with the first block, so that a file without points doesn't
+/// reserve room for an extent.
+///
+/// Call close() when done. The file is incomplete if it isn't called.
+class compressed_writer
+{
+    private:
+    std::ostream &s;
+    header::header h;
+    compression_options opts;
+    size_t write_behind;
+    std::streampos start;
+    columns::point_columns block;
+    size_t total_points = 0;
+    bool closed = false;
+
+    // These belong to the background thread until it has been joined
+    bool begun = false;
+    uint64_t offset = 0;
+    block_directory d;
+    extent::extent e = columns::get_extent (columns::point_columns ());
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::deque<columns::point_columns> q;
+    bool done = false;
+    std::exception_ptr error;
+    std::thread t;
+
+    // Write the header and the block size
+    void begin (const bool reserve_extent)
+    {
+        begun = true;
+
+        // Reserve room for the extent
+        if (reserve_extent)
+            h.e = e;
+        header::write_header (s, h);
+
+        const uint64_t n = opts.block_size;
+        s.write (reinterpret_cast<const char*>(&n), sizeof(uint64_t));
+        offset = sizeof(uint64_t);
+        if (!s)
+            throw std::runtime_error ("Error writing compressed file");
+    }
+
+    void write_blocks (const std::vector<columns::point_columns> &pcs)
+    {
+        if (!begun)
+            begin (!h.streaming);
+        const auto bs = compress_blocks (pcs, opts);
+        std::vector<stats::block_stats> ss (pcs.size ());
+        std::vector<extent::extent> es (pcs.size ());
+        utils::parallel_for (pcs.size (), [&](const size_t k)
+        {
+            ss[k] = stats::get_block_stats (pcs[k], 0, pcs[k].size ());
+            es[k] = columns::get_finite_extent (pcs[k]);
+        });
+        for (size_t k = 0; k < bs.size (); ++k)
+        {
+            d.push_back (block_entry {offset, bs[k].total_points, ss[k]});
+            offset += write_compressed_block (s, bs[k]);
+            e = extent::get_total_extent (e, es[k]);
+        }
+        if (!s)
+            throw std::runtime_error ("Error writing compressed blocks");
+    }
+
+    void write_queued_blocks ()
+    {
+        for (;;)
+        {
+            // Take every block that is waiting
+            std::vector<columns::point_columns> pcs;
+            {
+                std::unique_lock<std::mutex> lock (mtx);
+                cv.wait (lock, [&] { return !q.empty () || done; });
+                if (q.empty ())
+                    return;
+                pcs.assign (std::make_move_iterator (q.begin ()),
+                    std::make_move_iterator (q.end ()));
+                q.clear ();
+            }
+            cv.notify_all ();
+
+            write_blocks (pcs);
+        }
+    }
+
+    void flush_block ()
+    {
+        if (block.empty ())
+            return;
+        {
+            // Wait for room in the queue
+            std::unique_lock<std::mutex> lock (mtx);
+            cv.wait (lock, [&] { return error || q.size () < write_behind; });
+            if (error)
+                std::rethrow_exception (error);
+            q.push_back (std::move (block));
+        }
+        cv.notify_all ();
+        block = columns::point_columns (0, h.extra_fields);
+        block.reserve (opts.block_size);
+    }
+
+    void join ()
+    {
+        {
+            std::lock_guard<std::mutex> lock (mtx);
+            done = true;
+        }
+        cv.notify_all ();
+        if (t.joinable ())
+            t.join ();
+    }
+
+    public:
+    /// @brief CTOR
+    /// @param s Output stream. The caller must not use it until the
+    /// writer has been closed.
+    /// @param wkt OGC WKT string
+    /// @param extra_fields Number of extra fields in each record
+    /// @param opts Compression options
+    /// @param write_behind Maximum number of full blocks that wait to
+    /// be compressed
+    compressed_writer (std::ostream &s,
+        const std::string &wkt,
+        const size_t extra_fields,
+        const compression_options &opts = compression_options (),
+        const size_t write_behind = DEFAULT_WRITE_BEHIND)
+        : s (s)
+        , h (wkt, extra_fields, 0, true)
+        , opts (opts)
+        , write_behind (std::max (write_behind, size_t (1)))
+        , start (s.tellp ())
+        , block (0, extra_fields)
+    {
+        check_compression_options (opts);
+
+        // If the header can't be patched, mark the file as streaming
+        h.streaming = start == std::streampos (-1);
+
+        block.reserve (opts.block_size);
+        t = std::thread ([this]
+        {
+            try
+            {
+                write_queued_blocks ();
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock (mtx);
+                error = std::current_exception ();
+            }
+            cv.notify_all ();
+        });
+    }
+    compressed_writer (const compressed_writer &) = delete;
+    compressed_writer &operator= (const compressed_writer &) = delete;
+    /// @brief DTOR
+    ~compressed_writer ()
+    {
+        join ();
+    }
+
+    /// @brief Get the number of points that have been written
+    size_t get_total_points () const { return total_points; }
+
+    /// @brief Get the header, which is only complete after close()
+    const header::header &get_header () const { return h; }
+
+    /// @brief Write a point record
+    /// @param p Point record to write
+    void write (const point_record::point_record &p)
+    {
+        REQUIRE (!closed);
+        if (p.extra.size () != h.extra_fields)
+            throw std::runtime_error ("The number of extra fields is incorrect");
+        block.push_back (p);
+        ++total_points;
+        if (block.size () == opts.block_size)
+            flush_block ();
+    }
+
+    /// @brief Write a range of point records
+    /// @param prs Point records to write
+    void write (const point_record::point_records &prs)
+    {
+        for (const auto &p : prs)
+            write (p);
+    }
+
+    /// @brief Write points in bulk
+    /// @param pc Point columns to write
+    void write (const columns::point_columns &pc)
+    {
+        REQUIRE (!closed);
+        REQUIRE (pc.is_valid ());
+        if (pc.get_extra_fields () != h.extra_fields)
+            throw std::runtime_error ("The number of extra fields is incorrect");
+        for (size_t first = 0; first < pc.size (); )
+        {
+            // Append as many points as fit in the block
+            const size_t n = std::min (opts.block_size - block.size (), pc.size () - first);
+            columns::append (block, pc, first, n);
+            first += n;
+            total_points += n;
+            if (block.size () == opts.block_size)
+                flush_block ();
+        }
+    }
+
+    /// @brief Write the remaining points and finish the file
+    void close ()
+    {
+        if (closed)
+            return;
+        closed = true;
+
+        // Wait for the background thread to write every block
+        flush_block ();
+        join ();
+        if (error)
+            std::rethrow_exception (error);
+
+        // Without points, the header is already complete
+        const bool patch = begun && !h.streaming;
+        if (!begun)
+            begin (false);
+
+        offset += write_block_end_marker (s);
+        write_block_directory (s, d, offset);
+
+        // Go back and fill in the header
+        if (patch)
+        {
+            h.total_points = total_points;
+            h.e = get_header_extent (e, total_points);
+            const auto end = s.tellp ();
+            s.seekp (start);
+            header::write_header (s, h);
+            s.seekp (end);
+        }
+        s.flush ();
+        if (!s)
+            throw std::runtime_error ("Error writing compressed file");
+    }
+};
+
+/// @brief Strided, read-only view of one field in a memory-mapped file
+/// @tparam T Field type
+///
+/// Values are copied out on access because records are packed and
+/// are not guaranteed to be aligned.
+template<typename T>
+class field_view
+{
+    private:
+    const char *base;
+    size_t stride;
+    size_t n;
+
+    public:
+    /// @brief CTOR
+    /// @param base Pointer to the field in the first record
+    /// @param stride Number of bytes between records
+    /// @param n Number of records
+    field_view (const char *base, const size_t stride, const size_t n)
+        : base (base)
+        , stride (stride)
+        , n (n)
+    {
+    }
+    /// @brief Get the number of values in the view
+    size_t size () const { return n; }
+    /// @brief Get the number of bytes between values
+    size_t get_stride () const { return stride; }
+    /// @brief Unchecked value access
+    T operator[] (const size_t i) const
+    {
+        assert (i < n);
+        T v;
+        std::memcpy (&v, base + i * stride, sizeof(T));
+        return v;
+    }
+    /// @brief Checked value access
+    T at (const size_t i) const
+    {
+        if (i >= n)
+            throw std::out_of_range ("field_view::at(): index out of range");
+        return (*this)[i];
+    }
+};
+
+/// @brief Memory-mapped, random-access reader for uncompressed SPOC files
+///
+/// Uncompressed point records have a fixed size, so record 'i' is at
+/// a computable offset after the header. Only the pages that are
+/// touched get read from disk.
+class mapped_spoc_file
+{
+    private:
+    header::header h;
+    size_t record_size = 0;
+    size_t offset = 0;
+    size_t length = 0;
+    void *addr = MAP_FAILED;
+
+    const char *records () const
+    {
+        return static_cast<const char *> (addr) + offset;
+    }
+
+    public:
+    /// @brief CTOR
+    /// @param fn Filename of an uncompressed SPOC file
+    explicit mapped_spoc_file (const std::string &fn)
+    {
+        // Parse the header
+        std::ifstream ifs (fn, std::ios::binary);
+        if (!ifs)
+            throw std::runtime_error ("Could not open file for reading");
+        h = header::read_header (ifs);
+        if (h.streaming)
+            throw std::runtime_error ("Memory-mapped reader can't read a streaming file");
+        if (h.compressed)
+            throw std::runtime_error ("Memory-mapped reader can't read a compressed file");
+        offset = ifs.tellg ();
+        ifs.close ();
+
+        // Make sure all of the records are there
+        record_size = io::get_record_size (h.extra_fields);
+        const size_t expected = offset + h.total_points * record_size;
+        const int fd = ::open (fn.c_str (), O_RDONLY);
+        if (fd < 0)
+            throw std::runtime_error ("Could not open file for reading");
+        struct stat sb;
+        if (::fstat (fd, &sb) != 0 || static_cast<size_t> (sb.st_size) < expected)
+        {
+            ::close (fd);
+            throw std::runtime_error ("The file is smaller than the size given in its header");
+        }
+
+        // Map it
+        length = expected;
+        addr = ::mmap (nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close (fd);
+        if (addr == MAP_FAILED)
+            throw std::runtime_error ("Could not memory-map the file");
+
+        // Access will typically be sparse
+        ::madvise (addr, length, MADV_RANDOM);
+    }
+    mapped_spoc_file (const mapped_spoc_file &) = delete;
+    mapped_spoc_file &operator= (const mapped_spoc_file &) = delete;
+    /// @brief DTOR
+    ~mapped_spoc_file ()
+    {
+        if (addr != MAP_FAILED)
+            ::munmap (addr, length);
+    }
+
+    /// @brief Readonly header access
+    const header::header &get_header () const { return h; }
+
+    /// @brief Get the number of point records
+    size_t size () const { return h.total_points; }
+
+    /// @brief Get the number of bytes in each point record
+    size_t get_record_size () const { return record_size; }
+
+    /// @brief Get a pointer to the raw bytes of a record
+    /// @param i Point record index
+    const char *get_record_data (const size_t i) const
+    {
+        assert (i < size ());
+        return records () + i * record_size;
+    }
+
+    /// @brief Copy a point record out of the file
+    /// @param i Point record index
+    point_record::point_record get_point_record (const size_t i) const
+    {
+        if (i >= size ())
+            throw std::out_of_range ("mapped_spoc_file::get_point_record(): index out of range");
+        const char *q = get_record_data (i);
+        point_record::point_record p (h.extra_fields);
+        std::memcpy (&p.x, q, sizeof(double)); q += sizeof(double);
+        std::memcpy (&p.y, q, sizeof(double)); q += sizeof(double);
+        std::memcpy (&p.z, q, sizeof(double)); q += sizeof(double);
+        std::memcpy (&p.c, q, sizeof(uint32_t)); q += sizeof(uint32_t);
+        std::memcpy (&p.p, q, sizeof(uint32_t)); q += sizeof(uint32_t);
+        std::memcpy (&p.i, q, sizeof(uint16_t)); q += sizeof(uint16_t);
+        std::memcpy (&p.r, q, sizeof(uint16_t)); q += sizeof(uint16_t);
+        std::memcpy (&p.g, q, sizeof(uint16_t)); q += sizeof(uint16_t);
+        std::memcpy (&p.b, q, sizeof(uint16_t)); q += sizeof(uint16_t);
+        if (h.extra_fields != 0)
+            std::memcpy (p.extra.data (), q, h.extra_fields * sizeof(uint64_t));
+        return p;
+    }
+
+    /// @brief Field views
+    field_view<double> get_x () const { return field_view<double> (records () + 0, record_size, size ()); }
+    /// @brief Field views
+    field_view<double> get_y () const { return field_view<double> (records () + 8, record_size, size ()); }
+    /// @brief Field views
+    field_view<double> get_z () const { return field_view<double> (records () + 16, record_size, size ()); }
+    /// @brief Field views
+    field_view<uint32_t> get_c () const { return field_view<uint32_t> (records () + 24, record_size, size ()); }
+    /// @brief Field views
+    field_view<uint32_t> get_p () const { return field_view<uint32_t> (records () + 28, record_size, size ()); }
+    /// @brief Field views
+    field_view<uint16_t> get_i () const { return field_view<uint16_t> (records () + 32, record_size, size ()); }
+    /// @brief Field views
+    field_view<uint16_t> get_r () const { return field_view<uint16_t> (records () + 34, record_size, size ()); }
+    /// @brief Field views
+    field_view<uint16_t> get_g () const { return field_view<uint16_t> (records () + 36, record_size, size ()); }
+    /// @brief Field views
+    field_view<uint16_t> get_b () const { return field_view<uint16_t> (records () + 38, record_size, size ()); }
+    /// @brief Field views
+    /// @param k Extra field index
+    field_view<uint64_t> get_extra (const size_t k) const
+    {
+        if (k >= h.extra_fields)
+            throw std::out_of_range ("mapped_spoc_file::get_extra(): extra field index out of range");
+        return field_view<uint64_t> (records () + io::get_record_size (k), record_size, size ());
+    }
+};
+
 } // namespace io
 
 } // namespace spoc
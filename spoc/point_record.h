@@ -1,5 +1,6 @@
 #pragma once
 #include "spoc/point.h"
+#include "spoc/small_vector.h"
 #include "spoc/utils.h"
 #include <algorithm>
 #include <functional>
@@ -10,6 +11,14 @@ namespace spoc
 namespace point_record
 {
 
+// The number of extra fields that are stored inline in a point record
+//
+// Point records with more extra fields than this store them on the heap
+constexpr size_t INLINE_EXTRA_FIELDS = 8;
+
+// Extra fields storage
+using extra_vector = small_vector::small_vector<uint64_t, INLINE_EXTRA_FIELDS>;
+
 // Point record format
 struct point_record
 {
@@ -22,7 +31,7 @@ struct point_record
     uint16_t r; // red
     uint16_t g; // green
     uint16_t b; // blue
-    std::vector<uint64_t> extra;
+    extra_vector extra;
 
     // CTORs
     point_record ()
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <iterator>
+#include <type_traits>
+#include <vector>
+
+namespace spoc
+{
+
+namespace small_vector
+{
+
+/// @brief A vector with inline storage for up to N elements
+/// @tparam T Element type, which must be trivially copyable
+/// @tparam N Inline capacity
+///
+/// Elements are stored inside the object itself until the size
+/// exceeds N, at which point they are moved to the heap. This
+/// provides the subset of the std::vector interface that point
+/// records use, without a heap allocation per object for small
+/// sizes.
+template<typename T, size_t N>
+class small_vector
+{
+    static_assert (std::is_trivially_copyable_v<T>, "small_vector elements must be trivially copyable");
+    static_assert (N > 0, "small_vector inline capacity must be greater than zero");
+
+    private:
+    T *ptr = buf; // Points to either 'buf' or heap storage
+    uint32_t sz = 0;
+    uint32_t cap = N;
+    T buf[N] = {};
+
+    // Move the contents to heap storage with room for 'n' elements
+    //
+    // This is the slow path, so keep it out of line
+    [[gnu::noinline]] void reallocate (const size_t n)
+    {
+        const size_t new_cap = std::max (n, size_t (2) * cap);
+        T *q = new T[new_cap];
+        std::copy (ptr, ptr + sz, q);
+        if (!is_inline ())
+            delete [] ptr;
+        ptr = q;
+        cap = new_cap;
+    }
+
+    // Make room for at least 'n' elements, preserving contents
+    void grow (const size_t n)
+    {
+        if (n > cap)
+            reallocate (n);
+    }
+
+    public:
+    using value_type = T;
+    using size_type = size_t;
+    using reference = T &;
+    using const_reference = const T &;
+    using iterator = T *;
+    using const_iterator = const T *;
+
+    // CTORs
+    small_vector ()
+    {
+    }
+    explicit small_vector (const size_t n)
+    {
+        resize (n);
+    }
+    small_vector (const size_t n, const T &v)
+    {
+        resize (n, v);
+    }
+    small_vector (std::initializer_list<T> l)
+    {
+        assign (l.begin (), l.end ());
+    }
+    small_vector (const std::vector<T> &v) // cppcheck-suppress noExplicitConstructor
+    {
+        assign (v.begin (), v.end ());
+    }
+    small_vector (const small_vector &other)
+    {
+        assign (other.begin (), other.end ());
+    }
+    small_vector (small_vector &&other) noexcept
+    {
+        swap (other);
+    }
+    ~small_vector ()
+    {
+        if (!is_inline ())
+            delete [] ptr;
+    }
+
+    // Assignment
+    small_vector &operator= (const small_vector &rhs)
+    {
+        if (this != &rhs)
+            assign (rhs.begin (), rhs.end ());
+        return *this;
+    }
+    small_vector &operator= (small_vector &&rhs) noexcept
+    {
+        if (this != &rhs)
+        {
+            small_vector tmp (std::move (rhs));
+            swap (tmp);
+        }
+        return *this;
+    }
+    small_vector &operator= (const std::vector<T> &rhs)
+    {
+        assign (rhs.begin (), rhs.end ());
+        return *this;
+    }
+    template<typename It>
+    void assign (It first, It last)
+    {
+        const size_t n = std::distance (first, last);
+        sz = 0;
+        grow (n);
+        std::copy (first, last, ptr);
+        sz = n;
+    }
+
+    /// @brief Swap contents with another small_vector
+    void swap (small_vector &other) noexcept
+    {
+        const bool a = is_inline ();
+        const bool b = other.is_inline ();
+        std::swap (ptr, other.ptr);
+        std::swap (sz, other.sz);
+        std::swap (cap, other.cap);
+        std::swap (buf, other.buf);
+        // Inline storage does not move with the pointer
+        if (a) other.ptr = other.buf;
+        if (b) ptr = buf;
+    }
+
+    // Capacity
+    size_t size () const { return sz; }
+    bool empty () const { return sz == 0; }
+    size_t capacity () const { return cap; }
+    static constexpr size_t inline_capacity () { return N; }
+    bool is_inline () const { return ptr == buf; }
+    void reserve (const size_t n) { grow (n); }
+
+    /// @brief Change the size, value-initializing new elements
+    void resize (const size_t n, const T &v = T ())
+    {
+        // 'v' may be an element, so copy it before the storage moves
+        const T x = v;
+        grow (n);
+        if (n > sz)
+            std::fill (ptr + sz, ptr + n, x);
+        sz = n;
+    }
+    void clear () { sz = 0; }
+
+    // Modifiers
+    void push_back (const T &v)
+    {
+        // 'v' may be an element, so copy it before the storage moves
+        const T x = v;
+        grow (sz + 1);
+        ptr[sz++] = x;
+    }
+    void pop_back ()
+    {
+        assert (sz > 0);
+        --sz;
+    }
+
+    // Element access
+    T *data () { return ptr; }
+    const T *data () const { return ptr; }
+    T &operator[] (const size_t i) { assert (i < sz); return data ()[i]; }
+    const T &operator[] (const size_t i) const { assert (i < sz); return data ()[i]; }
+    T &front () { assert (sz > 0); return data ()[0]; }
+    const T &front () const { assert (sz > 0); return data ()[0]; }
+    T &back () { assert (sz > 0); return data ()[sz - 1]; }
+    const T &back () const { assert (sz > 0); return data ()[sz - 1]; }
+
+    // Iterators
+    iterator begin () { return data (); }
+    iterator end () { return data () + sz; }
+    const_iterator begin () const { return data (); }
+    const_iterator end () const { return data () + sz; }
+    const_iterator cbegin () const { return data (); }
+    const_iterator cend () const { return data () + sz; }
+
+    /// @brief Copy the contents to a std::vector
+    std::vector<T> to_vector () const
+    {
+        return std::vector<T> (begin (), end ());
+    }
+};
+
+/// Helper relational operator
+template<typename T, size_t N>
+inline bool operator== (const small_vector<T,N> &a, const small_vector<T,N> &b)
+{
+    return a.size () == b.size () && std::equal (a.begin (), a.end (), b.begin ());
+}
+
+/// Helper relational operator
+template<typename T, size_t N>
+inline bool operator!= (const small_vector<T,N> &a, const small_vector<T,N> &b)
+{
+    return !(a == b);
+}
+
+/// Helper relational operator
+template<typename T, size_t N>
+inline bool operator== (const small_vector<T,N> &a, const std::vector<T> &b)
+{
+    return a.size () == b.size () && std::equal (a.begin (), a.end (), b.begin ());
+}
+
+/// Helper relational operator
+template<typename T, size_t N>
+inline bool operator!= (const small_vector<T,N> &a, const std::vector<T> &b)
+{
+    return !(a == b);
+}
+
+} // namespace small_vector
+
+} // namespace spoc
@@ -1,14 +1,20 @@
 #pragma once
 #include "spoc/affine.h"
 #include "spoc/asprs.h"
+#include "spoc/bitpack.h"
+#include "spoc/columns.h"
 #include "spoc/compression.h"
 #include "spoc/contracts.h"
 #include "spoc/extent.h"
 #include "spoc/file.h"
+#include "spoc/filters.h"
+#include "spoc/gorilla.h"
+#include "spoc/index.h"
 #include "spoc/io.h"
 #include "spoc/json.h"
 #include "spoc/point.h"
 #include "spoc/radius_search.h"
+#include "spoc/stats.h"
 #include "spoc/subsampling.h"
 #include "spoc/utils.h"
 #include "spoc/version.h"
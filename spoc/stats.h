@@ -0,0 +1,226 @@
+#pragma once
+
+#include "spoc/columns.h"
+#include "spoc/extent.h"
+#include <algorithm>
+#include <bitset>
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+namespace spoc
+{
+
+namespace stats
+{
+
+/// Number of classifications that have a bit in the class bitmap
+constexpr size_t MAX_BITMAP_CLASSES = 256;
+
+/// @brief Summary of the values in a range of points
+///
+/// Readers use these to skip ranges of points that can't satisfy a
+/// filter without decompressing them.
+struct block_stats
+{
+    /// Bounds of x, y, and z. A NaN widens the bounds to infinity.
+    extent::extent e;
+    /// Minimum values of c, p, i, r, g, b, then the extra fields
+    std::vector<uint64_t> min;
+    /// Maximum values of c, p, i, r, g, b, then the extra fields
+    std::vector<uint64_t> max;
+    /// Bit 'k' is set if classification 'k' is present. Classifications
+    /// that are too large for the bitmap are only covered by the c range.
+    std::bitset<MAX_BITMAP_CLASSES> classes;
+};
+
+/// Number of integer fields in a point record, not counting extra fields
+constexpr size_t INTEGER_FIELDS = columns::FIXED_FIELDS - 3;
+
+/// Get the number of bytes used to store statistics
+/// @param extra_fields Number of extra fields in each record
+inline constexpr size_t get_stats_bytes (const size_t extra_fields)
+{
+    return 6 * sizeof(double)
+        + 2 * (INTEGER_FIELDS + extra_fields) * sizeof(uint64_t)
+        + MAX_BITMAP_CLASSES / 8;
+}
+
+/// Helper relational operator
+inline bool operator== (const block_stats &a, const block_stats &b)
+{
+    const auto same = [](const double x, const double y)
+        { return x == y || (std::isnan (x) && std::isnan (y)); };
+    return same (a.e.minp.x, b.e.minp.x) && same (a.e.minp.y, b.e.minp.y) && same (a.e.minp.z, b.e.minp.z)
+        && same (a.e.maxp.x, b.e.maxp.x) && same (a.e.maxp.y, b.e.maxp.y) && same (a.e.maxp.z, b.e.maxp.z)
+        && a.min == b.min
+        && a.max == b.max
+        && a.classes == b.classes;
+}
+
+namespace detail
+{
+
+template<typename T>
+inline void get_range (const std::vector<T> &v, const size_t first, const size_t n, uint64_t &lo, uint64_t &hi)
+{
+    T a = std::numeric_limits<T>::max ();
+    T b = std::numeric_limits<T>::lowest ();
+    #pragma omp simd reduction(min:a) reduction(max:b)
+    for (size_t i = first; i < first + n; ++i)
+    {
+        a = std::min (a, v[i]);
+        b = std::max (b, v[i]);
+    }
+    lo = a;
+    hi = b;
+}
+
+inline void get_range (const std::vector<double> &v, const size_t first, const size_t n, double &lo, double &hi)
+{
+    double a = std::numeric_limits<double>::infinity ();
+    double b = -std::numeric_limits<double>::infinity ();
+    bool nan = false;
+    for (size_t i = first; i < first + n; ++i)
+    {
+        nan |= std::isnan (v[i]);
+        a = std::min (a, v[i]);
+        b = std::max (b, v[i]);
+    }
+    // A NaN doesn't satisfy any comparison, so no bound can exclude it
+    if (nan)
+    {
+        a = -std::numeric_limits<double>::infinity ();
+        b = std::numeric_limits<double>::infinity ();
+    }
+    lo = a;
+    hi = b;
+}
+
+} // namespace detail
+
+/// Get the statistics for a range of points
+/// @param pc Point columns
+/// @param first Index of the first point
+/// @param n Number of points, which must be greater than zero
+inline block_stats get_block_stats (const columns::point_columns &pc, const size_t first, const size_t n)
+{
+    REQUIRE (pc.is_valid ());
+    REQUIRE (n != 0);
+    REQUIRE (first + n <= pc.size ());
+
+    block_stats s;
+    detail::get_range (pc.x, first, n, s.e.minp.x, s.e.maxp.x);
+    detail::get_range (pc.y, first, n, s.e.minp.y, s.e.maxp.y);
+    detail::get_range (pc.z, first, n, s.e.minp.z, s.e.maxp.z);
+
+    const size_t fields = INTEGER_FIELDS + pc.get_extra_fields ();
+    s.min.resize (fields);
+    s.max.resize (fields);
+    for (size_t j = 0; j < fields; ++j)
+    {
+        columns::visit_column (pc, j + 3, [&](const auto &v)
+        {
+            if constexpr (!std::is_floating_point_v<typename std::decay_t<decltype(v)>::value_type>)
+                detail::get_range (v, first, n, s.min[j], s.max[j]);
+        });
+    }
+
+    for (size_t i = first; i < first + n; ++i)
+        if (pc.c[i] < MAX_BITMAP_CLASSES)
+            s.classes.set (pc.c[i]);
+
+    return s;
+}
+
+/// Check if a range of points may contain a classification
+inline bool may_contain_class (const block_stats &s, const uint64_t c)
+{
+    if (c < MAX_BITMAP_CLASSES)
+        return s.classes.test (c);
+    return s.min[0] <= c && c <= s.max[0];
+}
+
+/// Check if a range of points may contain any of a set of classifications
+/// @tparam T Container of classifications
+template<typename T>
+inline bool may_contain_any_class (const block_stats &s, const T &cs)
+{
+    return std::any_of (cs.begin (), cs.end (),
+        [&](const auto c) { return c >= 0 && may_contain_class (s, c); });
+}
+
+/// Check if every point in a range has one of a set of classifications
+/// @tparam T Container of classifications
+template<typename T>
+inline bool contains_only_classes (const block_stats &s, const T &cs)
+{
+    // Classes that are not in the bitmap could be anything
+    if (s.max[0] >= MAX_BITMAP_CLASSES)
+        return false;
+    for (size_t k = 0; k < MAX_BITMAP_CLASSES; ++k)
+        if (s.classes.test (k) && std::find (cs.begin (), cs.end (), static_cast<typename T::value_type> (k)) == cs.end ())
+            return false;
+    return true;
+}
+
+/// Check if a range of points may have points inside an extent
+inline bool may_intersect (const block_stats &s, const extent::extent &e)
+{
+    return !(s.e.maxp.x < e.minp.x || s.e.minp.x > e.maxp.x
+        || s.e.maxp.y < e.minp.y || s.e.minp.y > e.maxp.y
+        || s.e.maxp.z < e.minp.z || s.e.minp.z > e.maxp.z);
+}
+
+/// Helper I/O function
+/// @param s Output stream
+/// @param b Statistics
+inline void write_block_stats (std::ostream &s, const block_stats &b)
+{
+    const double e[6] { b.e.minp.x, b.e.minp.y, b.e.minp.z, b.e.maxp.x, b.e.maxp.y, b.e.maxp.z };
+    s.write (reinterpret_cast<const char*>(e), sizeof(e));
+    for (size_t j = 0; j < b.min.size (); ++j)
+    {
+        s.write (reinterpret_cast<const char*>(&b.min[j]), sizeof(uint64_t));
+        s.write (reinterpret_cast<const char*>(&b.max[j]), sizeof(uint64_t));
+    }
+    uint8_t bits[MAX_BITMAP_CLASSES / 8] {};
+    for (size_t k = 0; k < MAX_BITMAP_CLASSES; ++k)
+        if (b.classes.test (k))
+            bits[k / 8] |= 1 << (k % 8);
+    s.write (reinterpret_cast<const char*>(bits), sizeof(bits));
+}
+
+/// Helper I/O function
+/// @param s Input stream
+/// @param extra_fields Number of extra fields in each record
+inline block_stats read_block_stats (std::istream &s, const size_t extra_fields)
+{
+    block_stats b;
+    double e[6];
+    s.read (reinterpret_cast<char*>(e), sizeof(e));
+    b.e.minp = { e[0], e[1], e[2] };
+    b.e.maxp = { e[3], e[4], e[5] };
+    b.min.resize (INTEGER_FIELDS + extra_fields);
+    b.max.resize (INTEGER_FIELDS + extra_fields);
+    for (size_t j = 0; j < b.min.size (); ++j)
+    {
+        s.read (reinterpret_cast<char*>(&b.min[j]), sizeof(uint64_t));
+        s.read (reinterpret_cast<char*>(&b.max[j]), sizeof(uint64_t));
+    }
+    uint8_t bits[MAX_BITMAP_CLASSES / 8] {};
+    s.read (reinterpret_cast<char*>(bits), sizeof(bits));
+    if (!s)
+        throw std::runtime_error ("Error reading block statistics");
+    for (size_t k = 0; k < MAX_BITMAP_CLASSES; ++k)
+        if (bits[k / 8] & (1 << (k % 8)))
+            b.classes.set (k);
+    return b;
+}
+
+} // namespace stats
+
+} // namespace spoc
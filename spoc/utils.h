@@ -1,5 +1,8 @@
 #pragma once
 #include "contracts.h"
+#include <cmath>
+#include <cstdint>
+#include <exception>
 #include <functional>
 
 namespace spoc
@@ -89,6 +92,85 @@ T crop (const T &points, const U &extent)
     return q;
 }
 
+// Call 'f(i)' for each 'i' in [0, n) on OpenMP threads
+//
+// Exceptions can't propagate out of an OpenMP region, so the first
+// one that gets thrown is captured and then rethrown on the calling
+// thread.
+template<typename F>
+inline void parallel_for (const size_t n, F &&f)
+{
+    std::exception_ptr e;
+#pragma omp parallel for schedule(dynamic)
+    for (size_t i = 0; i < n; ++i)
+    {
+        try
+        {
+            f (i);
+        }
+        catch (...)
+        {
+#pragma omp critical
+            if (!e)
+                e = std::current_exception ();
+        }
+    }
+    if (e)
+        std::rethrow_exception (e);
+}
+
+// The SplitMix64 mixing function
+//
+// Consecutive inputs give uncorrelated outputs, so it turns a counter
+// into a stream of random numbers.
+inline uint64_t splitmix64 (uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15ull;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9ull;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebull;
+    return x ^ (x >> 31);
+}
+
+// Counter-based random numbers
+//
+// Each number depends only on the seed, the stream, and its counter,
+// and not on the numbers drawn before it. They can be drawn in any
+// order, on any number of threads, and still be reproduced exactly.
+class counter_rng
+{
+    private:
+    uint64_t key;
+
+    public:
+    explicit counter_rng (const uint64_t seed, const uint64_t stream = 0)
+        : key (splitmix64 (splitmix64 (seed) ^ stream))
+    {
+    }
+
+    // Get the random bits for a counter
+    uint64_t operator() (const uint64_t counter) const
+    {
+        return splitmix64 (key ^ splitmix64 (counter));
+    }
+
+    // Get a number that is uniformly distributed in [0, 1)
+    double uniform (const uint64_t counter) const
+    {
+        return ((*this) (counter) >> 11) * 0x1.0p-53;
+    }
+
+    // Get a number from the standard normal distribution
+    //
+    // This uses the Box-Muller transform, which takes the counters
+    // '2 * counter' and '2 * counter + 1'.
+    double gaussian (const uint64_t counter) const
+    {
+        const double u1 = 1.0 - uniform (2 * counter);
+        const double u2 = uniform (2 * counter + 1);
+        return std::sqrt (-2.0 * std::log (u1)) * std::cos (2.0 * M_PI * u2);
+    }
+};
+
 } // namespace utils
 
 } // namespace spoc
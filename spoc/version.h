@@ -9,6 +9,6 @@ namespace spoc
 /// SPOC Version Information
 const uint8_t MAJOR_VERSION = 0;
 /// SPOC Version Information
-const uint8_t MINOR_VERSION = 1;
+const uint8_t MINOR_VERSION = 4;
 
 } // namespace spoc
@@ -85,7 +85,9 @@ PYBIND11_MODULE(spocpy_cpp,m)
         .def_readwrite("r", &spoc::point_record::point_record::r)
         .def_readwrite("g", &spoc::point_record::point_record::g)
         .def_readwrite("b", &spoc::point_record::point_record::b)
-        .def_readwrite("extra", &spoc::point_record::point_record::extra)
+        .def_property("extra",
+            [](const spoc::point_record::point_record &p) { return p.extra.to_vector (); },
+            [](spoc::point_record::point_record &p, const std::vector<uint64_t> &v) { p.extra = v; })
         ;
 
     py::class_<spoc::file::spoc_file>(m, "SpocFile")
@@ -180,6 +180,61 @@ void test_remove_coords ()
     VERIFY (fail);
 }
 
+void test_block_predicate ()
+{
+    struct
+    {
+        unordered_set<int> keep_classes;
+        unordered_set<int> remove_classes;
+        bool unique_xyz = false;
+        double subsample = 0.0;
+        string remove_coords;
+    } args;
+
+    spoc::columns::point_columns pc (10, 0);
+    for (size_t i = 0; i < pc.size (); ++i)
+    {
+        pc.x[i] = i;
+        pc.c[i] = 2 + i % 2;
+    }
+    const auto s = spoc::stats::get_block_stats (pc, 0, pc.size ());
+
+    const auto pred = get_block_predicate (args);
+    VERIFY (pred (s));
+    args.keep_classes = {1};
+    VERIFY (!pred (s));
+    args.keep_classes = {1, 3};
+    VERIFY (pred (s));
+    args.remove_classes = {2};
+    VERIFY (pred (s));
+    args.remove_classes = {2, 3};
+    VERIFY (!pred (s));
+    args.remove_classes.clear ();
+    args.remove_coords = "x > -1";
+    VERIFY (!pred (s));
+    args.remove_coords = "x > 0";
+    VERIFY (pred (s));
+    args.remove_coords = "x < 10";
+    VERIFY (!pred (s));
+    args.remove_coords = "x < 9";
+    VERIFY (pred (s));
+    args.remove_coords = "y < 1";
+    VERIFY (!pred (s));
+
+    // Subsampling depends on the points that come before it
+    args.remove_coords = "x > -1";
+    args.subsample = 1.0;
+    VERIFY (pred (s));
+    args.subsample = 0.0;
+    args.unique_xyz = true;
+    VERIFY (pred (s));
+
+    VERIFY_THROWS (parse_coords_op ("w > 1");)
+    VERIFY_THROWS (parse_coords_op ("x = 1");)
+    VERIFY_THROWS (parse_coords_op ("x > a");)
+    VERIFY_THROWS (parse_coords_op ("x >");)
+}
+
 int main (int argc, char **argv)
 {
     try
@@ -189,6 +244,7 @@ int main (int argc, char **argv)
         test_unique_xyz ();
         test_subsample ();
         test_remove_coords ();
+        test_block_predicate ();
         return 0;
     }
     catch (const exception &e)
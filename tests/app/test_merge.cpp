@@ -7,22 +7,51 @@
 using namespace std;
 using namespace spoc::header;
 using namespace spoc::io;
+using namespace spoc::columns;
 using namespace spoc::file;
 using namespace spoc::point_record;
 using namespace spoc::merge_app;
 using namespace spoc::test_utils;
 
+// Merge files that are held in strings
+string merge_strings (const vector<string> &strs,
+    const int point_id,
+    const size_t jobs,
+    ostream &log,
+    const bool drop_halo = false,
+    const bool quiet = false)
+{
+    vector<stringstream> ss;
+    for (const auto &str : strs)
+        ss.emplace_back (str);
+    vector<istream *> is;
+    for (auto &s : ss)
+        is.push_back (&s);
+    stringstream os;
+    merge (is, os, point_id, compression_options {.block_size = 7}, jobs, drop_halo, quiet, log);
+    return os.str ();
+}
+
+// Write a file to a string
+string to_string (const spoc_file &f)
+{
+    stringstream s;
+    write_spoc_file (s, f);
+    return s.str ();
+}
+
 void test_merge ()
 {
     spoc_file f1 ("A", false, point_records ());
     spoc_file f2 ("B", false, point_records ());
 
-    spoc_file f;
+    // The SRS differ
     const auto id = -1;
-    const auto quiet = false;
     stringstream ss;
-    append (f1, f, id, quiet, ss);
-    append (f2, f, id, quiet, ss);
+    const auto s = merge_strings ({to_string (f1), to_string (f2)}, id, 1, ss);
+    VERIFY (ss.str ().find ("spatial reference systems differ") != string::npos);
+    stringstream t (s);
+    VERIFY (read_spoc_file (t).get_point_records ().empty ());
 }
 
 void test_merge_quiet ()
@@ -31,13 +60,186 @@ void test_merge_quiet ()
     const size_t extra_fields = 8;
     auto f1 = generate_random_spoc_file (100, extra_fields, true);
     auto f2 = generate_random_spoc_file (100, extra_fields, false);
+    f1.set_wkt ("A");
+    f2.set_wkt ("B");
 
-    spoc_file f ("WKT", false, point_records ());
     const auto id = -1;
-    const auto quiet = true;
-    append (f1, f, id, quiet);
-    append (f2, f, id, quiet);
-    VERIFY (f.get_point_records ().size () == 200);
+    stringstream ss;
+    const auto s = merge_strings ({to_string (f1), to_string (f2)}, id, 1, ss, false, true);
+    VERIFY (ss.str ().empty ());
+    stringstream t (s);
+    VERIFY (read_spoc_file (t).get_point_records ().size () == 200);
+}
+
+void test_merge_streams ()
+{
+    const size_t extra_fields = 2;
+    vector<point_records> ps;
+    for (auto n : {100, 0, 33})
+        ps.push_back (generate_random_point_records (n, extra_fields));
+
+    // The expected result
+    point_records expected;
+    for (size_t i = 0; i < ps.size (); ++i)
+        for (auto p : ps[i])
+        {
+            p.p = i;
+            expected.push_back (p);
+        }
+
+    for (auto compressed : {true, false})
+    {
+        vector<string> strs;
+        for (size_t i = 0; i < ps.size (); ++i)
+        {
+            stringstream s;
+            // Mix compressed and uncompressed inputs
+            write_spoc_file (s, spoc_file ("WKT", compressed || i == 0, ps[i]));
+            strs.push_back (s.str ());
+        }
+
+        for (auto jobs : {size_t (1), size_t (2), size_t (10)})
+        {
+            stringstream log;
+            stringstream t (merge_strings (strs, -1, jobs, log));
+            const auto h = read_header (t);
+            VERIFY (h.compressed == compressed);
+            VERIFY (h.total_points == expected.size ());
+            VERIFY (h.e.has_value ());
+            VERIFY (*h.e == spoc::extent::get_extent (expected));
+            VERIFY (to_point_records (read_point_columns (t, h)) == expected);
+            VERIFY (log.str ().empty ());
+        }
+
+        // Set the point IDs
+        {
+        stringstream log;
+        stringstream t (merge_strings (strs, 5, 1, log));
+        const auto f = read_spoc_file (t);
+        for (const auto &p : f.get_point_records ())
+            VERIFY (p.p == 5);
+        }
+    }
+
+    // Streaming inputs give a streaming output
+    {
+    vector<string> strs;
+    for (size_t i = 0; i < ps.size (); ++i)
+    {
+        header h ("WKT", extra_fields, 0, false);
+        h.streaming = i == 1;
+        h.total_points = h.streaming ? 0 : ps[i].size ();
+        stringstream s;
+        write_header (s, h);
+        point_record_writer w (s, h);
+        w.write (ps[i]);
+        w.close ();
+        strs.push_back (s.str ());
+    }
+    stringstream log;
+    stringstream t (merge_strings (strs, -1, 1, log));
+    const auto h = read_header (t);
+    VERIFY (h.streaming);
+    VERIFY (read_uncompressed_points (t, h) == expected);
+    }
+
+    // Warnings
+    {
+    stringstream s1, s2;
+    auto p = generate_random_point_records (10, extra_fields);
+    write_spoc_file (s1, spoc_file ("A", false, p));
+    for (auto &q : p)
+        q.x += 1e6;
+    write_spoc_file (s2, spoc_file ("B", false, p));
+    stringstream log;
+    const vector<string> strs {s1.str (), s2.str ()};
+    merge_strings (strs, -1, 1, log);
+    VERIFY (log.str ().find ("spatial reference systems differ") != string::npos);
+    VERIFY (log.str ().find ("final merged area") != string::npos);
+    }
+
+    // Errors
+    {
+    stringstream s1, s2;
+    write_spoc_file (s1, spoc_file ("WKT", false, generate_random_point_records (10, 1)));
+    write_spoc_file (s2, spoc_file ("WKT", false, generate_random_point_records (10, 2)));
+    stringstream log;
+    const vector<string> strs {s1.str (), s2.str ()};
+    VERIFY_THROWS (merge_strings (strs, -1, 1, log);)
+    }
+}
+
+void test_merge_drop_halo ()
+{
+    // The last extra field is the halo flag
+    const size_t extra_fields = 2;
+    vector<point_records> ps {
+        generate_random_point_records (50, extra_fields, true, 1),
+        generate_random_point_records (40, extra_fields, true, 2),
+        generate_random_point_records (30, extra_fields, true, 3) };
+    point_records expected;
+    for (size_t i = 0; i < ps.size (); ++i)
+    {
+        for (size_t j = 0; j < ps[i].size (); ++j)
+        {
+            auto &p = ps[i][j];
+            p.extra[1] = (j % 3 == 0);
+            if (p.extra[1] != 0)
+                continue;
+            auto q = p;
+            q.p = i;
+            q.extra.resize (1);
+            expected.push_back (q);
+        }
+    }
+
+    for (auto compressed : {false, true})
+    {
+        vector<string> strs;
+        for (const auto &p : ps)
+        {
+            stringstream s;
+            write_spoc_file (s, spoc_file ("WKT", compressed, p));
+            strs.push_back (s.str ());
+        }
+        for (auto jobs : {1ul, 2ul})
+        {
+            stringstream log;
+            stringstream t (merge_strings (strs, -1, jobs, log, true));
+            const auto h = read_header (t);
+            VERIFY (h.compressed == compressed);
+            VERIFY (!h.streaming);
+            VERIFY (h.extra_fields == 1);
+            VERIFY (h.total_points == expected.size ());
+            VERIFY (*h.e == spoc::extent::get_extent (expected));
+            VERIFY (to_point_records (read_point_columns (t, h)) == expected);
+        }
+    }
+
+    // Only halo points
+    for (auto compressed : {false, true})
+    {
+        auto p = ps[0];
+        for (auto &i : p)
+            i.extra[1] = 1;
+        stringstream s;
+        write_spoc_file (s, spoc_file ("WKT", compressed, p));
+        stringstream log;
+        stringstream t (merge_strings ({s.str ()}, -1, 1, log, true));
+        const auto h = read_header (t);
+        VERIFY (h.total_points == 0);
+        VERIFY (!h.e.has_value ());
+        VERIFY (read_point_columns (t, h).empty ());
+    }
+
+    // There must be a halo flag
+    {
+    stringstream s;
+    write_spoc_file (s, spoc_file ("WKT", false, generate_random_point_records (10)));
+    stringstream log;
+    const vector<string> strs {s.str ()};
+    VERIFY_THROWS (merge_strings (strs, -1, 1, log, true);)
+    }
 }
 
 int main (int argc, char **argv)
@@ -46,6 +248,8 @@ int main (int argc, char **argv)
     {
         test_merge ();
         test_merge_quiet ();
+        test_merge_streams ();
+        test_merge_drop_halo ();
         return 0;
     }
     catch (const exception &e)
@@ -0,0 +1,41 @@
+#include "query.h"
+#include "spoc/spoc.h"
+#include "spoc/test_utils.h"
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+
+using namespace std;
+using namespace spoc::query_app;
+
+void test_parse_bbox ()
+{
+    const auto e = parse_bbox ("1,2,3,4");
+    VERIFY (e.minp.x == 1 && e.minp.y == 2 && e.maxp.x == 3 && e.maxp.y == 4);
+    VERIFY (isinf (e.minp.z) && e.minp.z < 0);
+    VERIFY (isinf (e.maxp.z) && e.maxp.z > 0);
+
+    const auto f = parse_bbox ("-1.5,-2,-3,4,5.5,6");
+    VERIFY (f.minp.x == -1.5 && f.minp.y == -2 && f.minp.z == -3);
+    VERIFY (f.maxp.x == 4 && f.maxp.y == 5.5 && f.maxp.z == 6);
+
+    VERIFY_THROWS (parse_bbox ("");)
+    VERIFY_THROWS (parse_bbox ("1,2,3");)
+    VERIFY_THROWS (parse_bbox ("1,2,3,4,5");)
+    VERIFY_THROWS (parse_bbox ("1,2,x,4");)
+    VERIFY_THROWS (parse_bbox ("3,2,1,4");)
+}
+
+int main (int argc, char **argv)
+{
+    try
+    {
+        test_parse_bbox ();
+        return 0;
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what () << endl;
+        return -1;
+    }
+}
@@ -1,8 +1,14 @@
 #include "tile.h"
 #include "spoc/spoc.h"
 #include "spoc/test_utils.h"
+#include <filesystem>
 #include <iostream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <set>
 #include <stdexcept>
+#include <unordered_set>
 
 using namespace std;
 using namespace spoc::extent;
@@ -90,6 +96,13 @@ void test_get_tile_indexes ()
     auto ind = get_tile_indexes (p, e, 1, 1);
     vector<size_t> answer { 0, 1, 1, 2, 3, 3, 0, 1, 3 };
     VERIFY (ind == answer);
+
+    // Points with a NaN or infinite X or Y don't have a tile
+    p[4].x = numeric_limits<double>::quiet_NaN ();
+    VERIFY_THROWS (get_tile_indexes (p, e, 1, 1);)
+    p[4].x = 2;
+    p[4].y = numeric_limits<double>::infinity ();
+    VERIFY_THROWS (get_tile_indexes (p, e, 1, 1);)
     }
 }
 
@@ -190,6 +203,364 @@ void test_get_tile_map_xy ()
     }
 }
 
+void test_tile_spooler ()
+{
+    using namespace spoc::columns;
+
+    const auto prs = generate_random_point_records (1000, 3);
+    const auto e = get_extent (prs);
+    const auto m = get_tile_map (get_tile_indexes (prs, e, 0.5, 0.5));
+
+    // Spool the points a few at a time, spilling most of them to disk
+    for (auto max_points : {150ul, 1000000ul})
+    {
+        tile_spooler s (std::filesystem::temp_directory_path (), 3, max_points);
+        for (size_t i = 0; i < prs.size (); i += 100)
+        {
+            const spoc::point_record::point_records q (prs.begin () + i, prs.begin () + i + 100);
+            const auto pc = to_point_columns (q);
+            s.add (pc, get_tile_indexes (pc, e, 0.5, 0.5));
+            VERIFY (s.get_buffered_points () <= max_points);
+        }
+
+        // Each tile should have the same points, in the same order, as
+        // when the whole file is tiled in memory
+        VERIFY (s.get_tiles ().size () == m.size ());
+        for (const auto t : s.get_tiles ())
+        {
+            const auto &v = m.at (t);
+            VERIFY (s.get_total_points (t) == v.size ());
+            spoc::point_record::point_records tile_prs;
+            s.read_tile (t, [&] (const point_columns &pc)
+                {
+                    const auto q = to_point_records (pc);
+                    tile_prs.insert (tile_prs.end (), q.begin (), q.end ());
+                }, 7);
+            VERIFY (tile_prs.size () == v.size ());
+            for (size_t i = 0; i < v.size (); ++i)
+                VERIFY (tile_prs[i] == prs[v[i]]);
+            VERIFY (s.get_extent (t) == get_extent (tile_prs));
+        }
+    }
+
+    // The wrong number of extra fields
+    {
+    tile_spooler s (std::filesystem::temp_directory_path (), 2);
+    const auto pc = to_point_columns (prs);
+    VERIFY_THROWS (s.add (pc, get_tile_indexes (pc, e, 0.5, 0.5));)
+    }
+}
+
+void test_get_tile_order ()
+{
+    const auto prs = generate_random_point_records (1000);
+    const auto e = get_extent (prs);
+    const auto indexes = get_tile_indexes (prs, e, 0.3, 0.3);
+
+    // Sparse tile indexes
+    auto sparse = indexes;
+    for (auto &i : sparse)
+        i *= 1000000;
+
+    for (const auto &v : {indexes, sparse})
+    {
+        const auto m = get_tile_map (v);
+        for (auto jobs : {1ul, 3ul, 2000ul})
+        {
+            const auto t = get_tile_order (v, jobs);
+            VERIFY (t.tiles.size () == m.size ());
+            VERIFY (t.offsets.size () == t.tiles.size () + 1);
+            VERIFY (is_sorted (t.tiles.begin (), t.tiles.end ()));
+            for (size_t k = 0; k < t.tiles.size (); ++k)
+            {
+                const vector<size_t> q (t.order.begin () + t.offsets[k], t.order.begin () + t.offsets[k + 1]);
+                VERIFY (q == m.at (t.tiles[k]));
+            }
+        }
+    }
+
+    const auto t = get_tile_order (vector<size_t> ());
+    VERIFY (t.tiles.empty ());
+    VERIFY (t.order.empty ());
+}
+
+void test_write_tiles ()
+{
+    using namespace spoc::columns;
+
+    const auto prs = generate_random_point_records (1000, 2);
+    const auto pc = to_point_columns (prs);
+    const auto e = get_extent (prs);
+    const auto t = get_tile_order (get_tile_indexes (pc, e, 0.3, 0.3));
+
+    for (auto jobs : {1ul, 4ul})
+    {
+        mutex m;
+        map<size_t, point_columns> tiles;
+        write_tiles (pc, t, [&] (const size_t tile, const point_columns &q)
+            {
+                lock_guard<mutex> lock (m);
+                VERIFY (tiles.count (tile) == 0);
+                tiles[tile] = q;
+            }, jobs, 20);
+        VERIFY (tiles.size () == t.tiles.size ());
+        for (size_t k = 0; k < t.tiles.size (); ++k)
+        {
+            const auto &q = tiles.at (t.tiles[k]);
+            VERIFY (q.size () == t.offsets[k + 1] - t.offsets[k]);
+            for (size_t i = 0; i < q.size (); ++i)
+                VERIFY (q.get_point_record (i) == prs[t.order[t.offsets[k] + i]]);
+        }
+    }
+
+    // Errors are passed back to the caller
+    VERIFY_THROWS (write_tiles (pc, t, [&] (const size_t, const point_columns &)
+        { throw runtime_error ("write failed"); }, 4);)
+}
+
+void test_get_quadtree_tiles ()
+{
+    // Dense in one corner
+    auto p = generate_random_point_records (1000);
+    for (size_t i = 0; i < 800; ++i)
+    {
+        p[i].x = p[i].x / 100.0 - 0.99;
+        p[i].y = p[i].y / 100.0 - 0.99;
+    }
+    const auto e = get_extent (p);
+
+    for (auto max_points : {1ul, 50ul, 999ul, 1000ul})
+    {
+        const auto q = get_quadtree_tiles (p, e, max_points);
+        VERIFY (q.indexes.size () == p.size ());
+        size_t total = 0;
+        for (size_t k = 0; k < q.leaves.size (); ++k)
+        {
+            const auto &l = q.leaves[k];
+            VERIFY (l.total_points != 0);
+            VERIFY (l.total_points <= max_points);
+            total += l.total_points;
+
+            // Each point is inside its leaf's cell
+            size_t n = 0;
+            for (size_t i = 0; i < p.size (); ++i)
+            {
+                if (q.indexes[i] != k)
+                    continue;
+                ++n;
+                VERIFY (p[i].x >= l.e.minp.x && p[i].x <= l.e.maxp.x);
+                VERIFY (p[i].y >= l.e.minp.y && p[i].y <= l.e.maxp.y);
+            }
+            VERIFY (n == l.total_points);
+        }
+        VERIFY (total == p.size ());
+        VERIFY (max_points == 1000
+            ? q.leaves.size () == 1
+            : q.leaves.size () >= p.size () / max_points);
+    }
+
+    // The dense corner is split deeper
+    {
+    const auto q = get_quadtree_tiles (p, e, 50);
+    VERIFY (q.leaves.front ().depth > q.leaves.back ().depth);
+    }
+
+    // Points that can't be separated
+    {
+    vector<point<double>> d (10, point<double> {1, 2, 3});
+    auto q = get_quadtree_tiles (d, get_extent (d), 2);
+    VERIFY (q.leaves.size () == 1);
+    d.push_back ({2, 3, 3});
+    q = get_quadtree_tiles (d, get_extent (d), 2, 5);
+    VERIFY (q.leaves.size () == 2);
+    VERIFY (q.leaves[0].depth == 5);
+    VERIFY (q.leaves[0].total_points == 10);
+    }
+
+    // Columns give the same tiling
+    {
+    const auto q = get_quadtree_tiles (p, e, 50);
+    const auto r = get_quadtree_tiles (spoc::columns::to_point_columns (p), e, 50);
+    VERIFY (q.indexes == r.indexes);
+    }
+}
+
+void test_get_manifest ()
+{
+    const auto p = generate_random_point_records (100);
+    const auto q = get_quadtree_tiles (p, get_extent (p), 30);
+    vector<string> filenames;
+    for (size_t k = 0; k < q.leaves.size (); ++k)
+        filenames.push_back ("tile" + to_string (k) + ".spoc");
+    const auto m = get_manifest (q, filenames);
+    const auto &tiles = any_cast<const spoc::json::array &> (m.at ("tiles"));
+    VERIFY (tiles.size () == q.leaves.size ());
+    const auto &t = any_cast<const spoc::json::object &> (tiles.back ());
+    VERIFY (any_cast<string> (t.at ("filename")) == filenames.back ());
+    VERIFY (any_cast<uint64_t> (t.at ("total_points")) == q.leaves.back ().total_points);
+    VERIFY (any_cast<double> (t.at ("max_x")) == q.leaves.back ().e.maxp.x);
+}
+
+void test_halo ()
+{
+    using halo_set = set<pair<size_t, size_t>>;
+
+    const auto prs = generate_random_point_records (500, 1);
+    const auto e = get_extent (prs);
+    const double buffer = 0.1;
+
+    // Is a point within 'buffer' of a box?
+    const auto near = [&] (const auto &p, const double x0, const double y0, const double x1, const double y1)
+    {
+        return p.x >= x0 - buffer && p.x <= x1 + buffer && p.y >= y0 - buffer && p.y <= y1 + buffer;
+    };
+
+    // Grid tiles
+    for (auto sizes : vector<pair<double, double>> {{0.3, 0.3}, {0.5, 0.0}, {0.0, 0.7}})
+    {
+        const double tx = sizes.first;
+        const double ty = sizes.second;
+        const auto indexes = get_tile_indexes (prs, e, tx, ty);
+        const auto halo = get_halo_indexes (prs, indexes, e, tx, ty, buffer);
+        const size_t stride = tx > 0.0 ? (e.maxp.x - e.minp.x) / tx + 1.0 : 1.0;
+        const size_t rows = ty > 0.0 ? (e.maxp.y - e.minp.y) / ty + 1.0 : 1.0;
+        halo_set expected;
+        for (size_t i = 0; i < prs.size (); ++i)
+        {
+            for (size_t t = 0; t < stride * rows; ++t)
+            {
+                if (t == indexes[i])
+                    continue;
+                const double x0 = tx > 0.0 ? e.minp.x + (t % stride) * tx : -1e9;
+                const double y0 = ty > 0.0 ? e.minp.y + (t / stride) * ty : -1e9;
+                const double x1 = tx > 0.0 ? x0 + tx : 1e9;
+                const double y1 = ty > 0.0 ? y0 + ty : 1e9;
+                if (near (prs[i], x0, y0, x1, y1))
+                    expected.insert ({i, t});
+            }
+        }
+        VERIFY (!expected.empty ());
+        VERIFY (halo_set (halo.begin (), halo.end ()) == expected);
+        VERIFY (halo.size () == expected.size ());
+    }
+
+    // Quadtree tiles
+    {
+    const auto q = get_quadtree_tiles (prs, e, 40, DEFAULT_MAX_QUADTREE_DEPTH, buffer);
+    halo_set expected;
+    for (size_t i = 0; i < prs.size (); ++i)
+    {
+        for (size_t k = 0; k < q.leaves.size (); ++k)
+        {
+            const auto &c = q.leaves[k].e;
+            if (q.indexes[i] != k && near (prs[i], c.minp.x, c.minp.y, c.maxp.x, c.maxp.y))
+                expected.insert ({i, k});
+        }
+    }
+    VERIFY (!expected.empty ());
+    VERIFY (halo_set (q.halo.begin (), q.halo.end ()) == expected);
+    VERIFY (q.halo.size () == expected.size ());
+    size_t total = 0;
+    for (const auto &l : q.leaves)
+        total += l.halo_points;
+    VERIFY (total == q.halo.size ());
+
+    // Without a buffer
+    const auto r = get_quadtree_tiles (prs, e, 40);
+    VERIFY (r.halo.empty ());
+    VERIFY (r.indexes == q.indexes);
+    }
+
+    // Points with non-finite coordinates have no halo tiles
+    {
+    auto q = prs;
+    q[0].x = numeric_limits<double>::quiet_NaN ();
+    q[1].y = numeric_limits<double>::infinity ();
+    q[2].x = -numeric_limits<double>::infinity ();
+    const vector<size_t> indexes (q.size (), 0);
+    for (const auto &h : get_halo_indexes (q, indexes, e, 0.3, 0.3, buffer))
+        VERIFY (h.first > 2);
+    }
+
+    // Add the halo points
+    {
+    auto pc = spoc::columns::to_point_columns (prs);
+    auto indexes = get_tile_indexes (pc, e, 0.3, 0.3);
+    const auto halo = get_halo_indexes (pc, indexes, e, 0.3, 0.3, buffer);
+    const auto original = indexes;
+    add_halo_points (pc, indexes, halo);
+    VERIFY (pc.get_extra_fields () == 2);
+    VERIFY (pc.size () == prs.size () + halo.size ());
+    VERIFY (indexes.size () == pc.size ());
+    for (size_t i = 0; i < prs.size (); ++i)
+    {
+        VERIFY (pc.extra[1][i] == 0);
+        VERIFY (indexes[i] == original[i]);
+    }
+    for (size_t k = 0; k < halo.size (); ++k)
+    {
+        const size_t i = prs.size () + k;
+        VERIFY (pc.extra[1][i] == 1);
+        VERIFY (indexes[i] == halo[k].second);
+        VERIFY (pc.x[i] == prs[halo[k].first].x);
+        VERIFY (pc.extra[0][i] == prs[halo[k].first].extra[0]);
+    }
+    }
+}
+
+void test_halo_streaming ()
+{
+    using namespace spoc::columns;
+
+    const auto prs = generate_random_point_records (1000, 1);
+    const auto e = get_extent (prs);
+    const double ts = 0.3;
+    const double buffer = 0.1;
+
+    // Tile the points in memory
+    map<size_t, point_columns> expected;
+    {
+    auto pc = to_point_columns (prs);
+    auto indexes = get_tile_indexes (pc, e, ts, ts);
+    const unordered_set<size_t> owned (indexes.begin (), indexes.end ());
+    auto halo = get_halo_indexes (pc, indexes, e, ts, ts, buffer);
+    erase_if (halo, [&] (const auto &i) { return owned.count (i.second) == 0; });
+    add_halo_points (pc, indexes, halo);
+    mutex m;
+    write_tiles (pc, get_tile_order (indexes), [&] (const size_t tile, const point_columns &q)
+        {
+            lock_guard<mutex> lock (m);
+            expected[tile] = q;
+        });
+    }
+
+    // Stream the points a chunk at a time, spilling some of them
+    for (auto max_points : {150ul, 1000000ul})
+    {
+        tile_spooler s (std::filesystem::temp_directory_path (), 2, max_points);
+        for (size_t i = 0; i < prs.size (); i += 100)
+        {
+            const spoc::point_record::point_records q (prs.begin () + i, prs.begin () + i + 100);
+            auto pc = to_point_columns (q);
+            const size_t n = pc.size ();
+            auto indexes = get_tile_indexes (pc, e, ts, ts);
+            add_halo_points (pc, indexes, get_halo_indexes (pc, indexes, e, ts, ts, buffer));
+            s.add (pc, indexes, n);
+        }
+
+        // The tiles are the same in either mode
+        VERIFY (s.get_tiles ().size () == expected.size ());
+        for (const auto t : s.get_tiles ())
+        {
+            point_columns q (0, 2);
+            s.read_tile (t, [&] (const point_columns &pc) { append (q, pc); }, 7);
+            VERIFY (q == expected.at (t));
+            VERIFY (s.get_total_points (t) == q.size ());
+            VERIFY (s.get_extent (t) == get_extent (q));
+        }
+    }
+}
+
 int main (int argc, char **argv)
 {
     try
@@ -200,6 +571,13 @@ int main (int argc, char **argv)
         test_get_tile_indexes_xy ();
         test_get_tile_map ();
         test_get_tile_map_xy ();
+        test_tile_spooler ();
+        test_get_tile_order ();
+        test_write_tiles ();
+        test_get_quadtree_tiles ();
+        test_get_manifest ();
+        test_halo ();
+        test_halo_streaming ();
         return 0;
     }
     catch (const exception &e)
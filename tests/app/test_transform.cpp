@@ -2,7 +2,9 @@
 #include "spoc/test_utils.h"
 #include "transform.h"
 #include "transform_cmd.h"
+#include <cmath>
 #include <iostream>
+#include <limits>
 #include <stdexcept>
 
 using namespace std;
@@ -649,6 +651,51 @@ void test_transform_multiple_ops ()
     VERIFY (about_equal (p1.back ().z, p3.back ().z));
 }
 
+void test_transform_compress ()
+{
+    const auto p = generate_random_point_records (1000, 2);
+    const string wkt ("Test WKT");
+    vector<command> commands (1);
+    commands[0] = command ("add-x", "1.5");
+
+    stringstream is1, os1, is2, os2;
+    write_spoc_file_uncompressed (is1, spoc_file (wkt, false, p));
+    write_spoc_file_uncompressed (is2, spoc_file (wkt, false, p));
+    apply (is1, os1, commands, 0);
+    apply (is2, os2, commands, 0, true);
+
+    // The compressed output has the same points
+    const auto f1 = read_spoc_file_uncompressed (os1);
+    const auto f2 = read_spoc_file_compressed (os2);
+    VERIFY (f2.get_header ().compressed);
+    VERIFY (f2.get_header ().wkt == wkt);
+    VERIFY (f1.get_point_records () == f2.get_point_records ());
+}
+
+void test_transform_streaming ()
+{
+    const auto p = generate_random_point_records (1000, 2);
+    vector<command> commands (1);
+    commands[0] = command ("add-x", "1.5");
+
+    // Write a streaming file
+    spoc::header::header h ("Test WKT", 2, 0, false);
+    h.streaming = true;
+    stringstream is1, is2, os1, os2;
+    write_header (is1, h);
+    point_record_writer w (is1, h);
+    w.write (p);
+    w.close ();
+    write_spoc_file_uncompressed (is2, spoc_file ("Test WKT", false, p));
+
+    // The output streams, too
+    apply (is1, os1, commands, 0);
+    apply (is2, os2, commands, 0);
+    const auto g = spoc::header::read_header (os1);
+    VERIFY (g.streaming);
+    VERIFY (read_uncompressed_points (os1, g) == read_spoc_file (os2).get_point_records ());
+}
+
 void test_transform_bad_command ()
 {
     bool failed = false;
@@ -662,6 +709,134 @@ void test_transform_bad_command ()
     VERIFY (failed);
 }
 
+void test_transform_jobs ()
+{
+    // More points than fit in a block
+    const auto f = generate_random_spoc_file (3 * spoc::io::DEFAULT_BLOCK_SIZE + 10, 2, false);
+    const vector<command> commands {
+        command ("rotate-z", "30.0"),
+        command ("gaussian-noise", "1.0"),
+        command ("uniform-noise-z", "0.5"),
+        command ("set", "e1,3") };
+
+    // The output does not depend on the number of jobs
+    string s1;
+    for (auto jobs : { 1, 2, 4, 7 })
+    {
+        stringstream is, os;
+        write_spoc_file_uncompressed (is, f);
+        apply (is, os, commands, 123, false, jobs);
+        if (jobs == 1)
+            s1 = os.str ();
+        VERIFY (os.str () == s1);
+    }
+}
+
+void test_block_transform ()
+{
+    const auto p = generate_random_point_records (1000, 2);
+    const auto pc = spoc::columns::to_point_columns (p);
+
+    // Runs of affine commands are composed
+    vector<command> commands {
+        command ("add-x", "10.0"),
+        command ("rotate-z", "30.0"),
+        command ("scale-y", "2.0"),
+        command ("set", "c,5"),
+        command ("add-z", "-3.0"),
+        command ("rotate-x", "-45.0"),
+        command ("rotate-y", "60.0") };
+    auto t = get_block_transform (commands, 0, 2);
+    VERIFY (t.size () == 3);
+
+    // They give the same results as the affine functions
+    auto b = pc;
+    t (b);
+    auto q = p;
+    spoc::affine::add_x (q, 10.0);
+    spoc::affine::rotate_z (q, 30.0);
+    spoc::affine::scale_y (q, 2.0);
+    spoc::affine::add_z (q, -3.0);
+    spoc::affine::rotate_x (q, -45.0);
+    spoc::affine::rotate_y (q, 60.0);
+    for (size_t i = 0; i < q.size (); ++i)
+    {
+        VERIFY (about_equal (b.x[i], q[i].x));
+        VERIFY (about_equal (b.y[i], q[i].y));
+        VERIFY (about_equal (b.z[i], q[i].z));
+        VERIFY (b.c[i] == 5);
+        VERIFY (b.p[i] == p[i].p);
+        VERIFY (b.extra[1][i] == p[i].extra[1]);
+    }
+
+    // Noise is the same no matter how the points are split into blocks
+    commands.push_back (command ("gaussian-noise", "1.0"));
+    commands.push_back (command ("uniform-noise-y", "1.0"));
+    auto t1 = get_block_transform (commands, 123, 2);
+    auto t2 = get_block_transform (commands, 123, 2);
+    auto b1 = pc;
+    t1 (b1);
+    spoc::columns::point_columns b2 (0, 2);
+    for (size_t i = 0; i < pc.size (); i += 7)
+    {
+        spoc::columns::point_columns c (0, 2);
+        spoc::columns::append (c, pc, i, min (size_t (7), pc.size () - i));
+        t2 (c, i);
+        spoc::columns::append (b2, c);
+    }
+    VERIFY (b1 == b2);
+
+    // Blocks can be transformed out of order
+    spoc::columns::point_columns c1 (0, 2);
+    spoc::columns::point_columns c2 (0, 2);
+    spoc::columns::append (c1, pc, 0, 500);
+    spoc::columns::append (c2, pc, 500, 500);
+    t2 (c2, 500);
+    t2 (c1, 0);
+    spoc::columns::append (c1, c2);
+    VERIFY (b1 == c1);
+
+    // Repeating a noise command adds different noise
+    auto n1 = get_block_transform (vector<command> {
+        command ("gaussian-noise-x", "1.0"),
+        command ("gaussian-noise-x", "1.0") }, 123, 2);
+    auto n2 = get_block_transform (vector<command> {
+        command ("gaussian-noise-x", "2.0") }, 123, 2);
+    auto d1 = pc;
+    auto d2 = pc;
+    n1 (d1);
+    n2 (d2);
+    VERIFY (d1.x != d2.x);
+
+    // Replace the values in the field that was named
+    {
+    auto c = pc;
+    auto r = get_block_transform (vector<command> { command ("replace-not", "i,1,2,7") }, 0, 2);
+    r (c);
+    for (size_t i = 0; i < c.size (); ++i)
+    {
+        VERIFY (c.c[i] == pc.c[i]);
+        VERIFY (c.i[i] == ((pc.i[i] == 1 || pc.i[i] == 2) ? pc.i[i] : 7));
+    }
+    }
+
+    // Non-finite values don't spread to the other axes
+    {
+    spoc::columns::point_columns c (1, 2);
+    c.x[0] = 1.0;
+    c.y[0] = -0.0;
+    c.z[0] = numeric_limits<double>::quiet_NaN ();
+    auto a = get_block_transform (vector<command> { command ("add-x", "10.0") }, 0, 2);
+    a (c);
+    VERIFY (c.x[0] == 11.0);
+    VERIFY (c.y[0] == 0.0 && signbit (c.y[0]));
+    VERIFY (isnan (c.z[0]));
+    }
+
+    // The extra field must exist
+    VERIFY_THROWS (get_block_transform (vector<command> { command ("set", "e2,1") }, 0, 2);)
+}
+
 int main (int argc, char **argv)
 {
     try
@@ -678,7 +853,11 @@ int main (int argc, char **argv)
         test_transform_set ();
         test_transform_uniform_noise ();
         test_transform_multiple_ops ();
+        test_transform_compress ();
+        test_transform_streaming ();
         test_transform_bad_command ();
+        test_transform_jobs ();
+        test_block_transform ();
         return 0;
     }
     catch (const exception &e)
@@ -23,3 +23,12 @@ diff \
 
 spoc_tile -p ${TMPDIR}/spoc_tile ./test_data/lidar/juarez50.zpoc
 spoc_merge ${TMPDIR}/spoc_tile*.zpoc > ${TMPDIR}/spoc_merged.zpoc
+
+# Other codecs
+spoc_tile -f -c none -p ${TMPDIR}/spoc_tile ./test_data/lidar/juarez50.zpoc
+spoc_merge -c none ${TMPDIR}/spoc_tile*.zpoc > ${TMPDIR}/spoc_merged_none.zpoc
+spoc_info -s ${TMPDIR}/spoc_merged.zpoc > ${TMPDIR}/spoc_merge_header1.txt
+spoc_info -s ${TMPDIR}/spoc_merged_none.zpoc > ${TMPDIR}/spoc_merge_header2.txt
+diff \
+    ${TMPDIR}/spoc_merge_header1.txt \
+    ${TMPDIR}/spoc_merge_header2.txt
@@ -1,10 +1,14 @@
 #include "spoc/affine.h"
 #include "spoc/test_utils.h"
+#include <cstring>
 #include <iostream>
+#include <limits>
 #include <stdexcept>
 
 using namespace std;
 using namespace spoc::affine;
+using namespace spoc::point;
+using namespace spoc::test_utils;
 
 void test_add ()
 {
@@ -78,7 +82,7 @@ void test_rotate ()
     }
 }
 
-void test_transform_rotate2 ()
+void test_rotate2 ()
 {
     default_random_engine g;
     uniform_real_distribution<double> d (0.0, 1.0);
@@ -147,8 +151,8 @@ void test_transform_rotate2 ()
         // Y
         rotate_y (q, 90);
         VERIFY (p[0].y == q[0].y);
-        VERIFY (about_equal (p[0].x, q[0].z));
-        VERIFY (about_equal (p[0].z, -q[0].x));
+        VERIFY (about_equal (p[0].x, -q[0].z));
+        VERIFY (about_equal (p[0].z, q[0].x));
 
         rotate_y (q, -90);
         VERIFY (p[0].y == q[0].y);
@@ -217,6 +221,95 @@ void test_scale ()
     }
 }
 
+void test_matrix ()
+{
+    const auto p = generate_random_point_records (100);
+
+    // Apply the transforms one at a time
+    auto q (p);
+    add_x (q, 10.0);
+    rotate_x (q, 17.5);
+    scale_y (q, 3.0);
+    rotate_z (q, -40.0);
+    add_z (q, -5.0);
+    rotate_y (q, 123.0);
+
+    // Compose them
+    matrix m = identity_matrix ();
+    m = multiply (translation (10.0, 0.0, 0.0), m);
+    m = multiply (rotation_x (17.5), m);
+    m = multiply (scaling (1.0, 3.0, 1.0), m);
+    m = multiply (rotation_z (-40.0), m);
+    m = multiply (translation (0.0, 0.0, -5.0), m);
+    m = multiply (rotation_y (123.0), m);
+
+    vector<double> x, y, z;
+    for (const auto &i : p)
+    {
+        x.push_back (i.x);
+        y.push_back (i.y);
+        z.push_back (i.z);
+    }
+    transform (m, x, y, z);
+    for (size_t i = 0; i < p.size (); ++i)
+    {
+        VERIFY (about_equal (x[i], q[i].x));
+        VERIFY (about_equal (y[i], q[i].y));
+        VERIFY (about_equal (z[i], q[i].z));
+    }
+
+    // Single transforms give the same results
+    x = y = z = vector<double> (1, 2.5);
+    transform (translation (1.0, 2.0, 3.0), x, y, z);
+    VERIFY (x[0] == 3.5 && y[0] == 4.5 && z[0] == 5.5);
+    transform (scaling (2.0, 3.0, 4.0), x, y, z);
+    VERIFY (x[0] == 7.0 && y[0] == 13.5 && z[0] == 22.0);
+    VERIFY (multiply (identity_matrix (), rotation_x (10.0)) == rotation_x (10.0));
+}
+
+void test_matrix_non_finite ()
+{
+    // Bitwise equality, so that NaN == NaN and -0.0 != 0.0
+    const auto same = [](const double a, const double b)
+        { return memcmp (&a, &b, sizeof (double)) == 0; };
+
+    const double nan = numeric_limits<double>::quiet_NaN ();
+    const double inf = numeric_limits<double>::infinity ();
+    for (auto v : { nan, inf, -inf, -0.0 })
+    {
+        // Put the value in each axis, and move the other axes
+        for (size_t axis = 0; axis < 3; ++axis)
+        {
+            vector<double> p { 1.0, 2.0, 3.0 };
+            p[axis] = v;
+
+            // add-x only changes X
+            vector<double> x (1, p[0]), y (1, p[1]), z (1, p[2]);
+            transform (translation (10.0, 0.0, 0.0), x, y, z);
+            VERIFY (same (x[0], p[0] + 10.0));
+            VERIFY (same (y[0], p[1]));
+            VERIFY (same (z[0], p[2]));
+
+            // scale-y only changes Y
+            x[0] = p[0]; y[0] = p[1]; z[0] = p[2];
+            transform (scaling (1.0, 2.0, 1.0), x, y, z);
+            VERIFY (same (x[0], p[0]));
+            VERIFY (same (y[0], p[1] * 2.0));
+            VERIFY (same (z[0], p[2]));
+
+            // rotate-z only changes X and Y
+            x[0] = p[0]; y[0] = p[1]; z[0] = p[2];
+            transform (rotation_z (30.0), x, y, z);
+            VERIFY (same (z[0], p[2]));
+            if (axis == 2)
+            {
+                VERIFY (!isnan (x[0]) && !isinf (x[0]));
+                VERIFY (!isnan (y[0]) && !isinf (y[0]));
+            }
+        }
+    }
+}
+
 int main (int argc, char **argv)
 {
     try
@@ -225,6 +318,8 @@ int main (int argc, char **argv)
         test_rotate ();
         test_rotate2 ();
         test_scale ();
+        test_matrix ();
+        test_matrix_non_finite ();
         return 0;
     }
     catch (const exception &e)
@@ -0,0 +1,115 @@
+#include "spoc/bitpack.h"
+#include "spoc/test_utils.h"
+#include <iostream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+using namespace spoc::bitpack;
+
+template<typename U>
+vector<U> round_trip (const vector<U> &x, const frame &f)
+{
+    vector<uint8_t> y (get_packed_bytes (x.size (), f.width));
+    pack (x.data (), x.size (), f, y.data ());
+    vector<U> z (x.size ());
+    unpack (y.data (), z.size (), f, z.data ());
+    return z;
+}
+
+template<typename U>
+void test_round_trip (const vector<U> &x)
+{
+    const auto f = get_frame (x.data (), x.size ());
+    VERIFY (round_trip (x, f) == x);
+
+    // Through the stored frame
+    vector<uint8_t> b (FRAME_BYTES);
+    write_frame (f, b.data ());
+    const auto g = read_frame<U> (b.data (), b.size ());
+    VERIFY (g.min == f.min);
+    VERIFY (g.width == f.width);
+}
+
+void test_bitpack ()
+{
+    default_random_engine g;
+
+    // Classifications fit in a few bits
+    {
+    vector<uint32_t> x (1000);
+    uniform_int_distribution<uint32_t> d (0, 18);
+    for (auto &i : x)
+        i = d (g);
+    x[0] = 0;
+    x[1] = 18;
+    const auto f = get_frame (x.data (), x.size ());
+    VERIFY (f.min == 0);
+    VERIFY (f.width == 5);
+    VERIFY (get_packed_bytes (x.size (), f.width) == 625);
+    test_round_trip (x);
+    }
+
+    // Values close together, far from zero
+    {
+    vector<uint64_t> x (1000);
+    uniform_int_distribution<uint64_t> d (1'000'000'000'000, 1'000'000'000'100);
+    for (auto &i : x)
+        i = d (g);
+    const auto f = get_frame (x.data (), x.size ());
+    VERIFY (f.width <= 7);
+    test_round_trip (x);
+    }
+
+    // Every width
+    for (unsigned w = 0; w <= 64; ++w)
+    {
+        const uint64_t mask = w == 64 ? ~uint64_t (0) : (uint64_t (1) << w) - 1;
+        vector<uint64_t> x (257);
+        for (size_t i = 0; i < x.size (); ++i)
+            x[i] = (i * 0x9E3779B97F4A7C15) & mask;
+        x[1] = mask;
+        VERIFY (get_frame (x.data (), x.size ()).width == w);
+        test_round_trip (x);
+    }
+
+    // All the same
+    test_round_trip (vector<uint16_t> (100, 12345));
+    VERIFY (get_frame (vector<uint16_t> (100, 7).data (), 100).width == 0);
+
+    // Full range
+    test_round_trip (vector<uint16_t> {0, 0xFFFF, 1, 0xFFFE});
+    test_round_trip (vector<uint8_t> {0, 0xFF, 1});
+
+    // Empty and single values
+    test_round_trip (vector<uint32_t> ());
+    test_round_trip (vector<uint32_t> {123});
+}
+
+void test_bitpack_errors ()
+{
+    vector<uint8_t> b (FRAME_BYTES);
+    write_frame (frame {0, 33}, b.data ());
+    VERIFY_THROWS (read_frame<uint32_t> (b.data (), b.size ());)
+    VERIFY (read_frame<uint64_t> (b.data (), b.size ()).width == 33);
+    write_frame (frame {0x10000, 1}, b.data ());
+    VERIFY_THROWS (read_frame<uint16_t> (b.data (), b.size ());)
+    VERIFY_THROWS (read_frame<uint64_t> (b.data (), b.size () - 1);)
+}
+
+int main (int argc, char **argv)
+{
+    try
+    {
+        test_bitpack ();
+        test_bitpack_errors ();
+        return 0;
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what () << endl;
+        return -1;
+    }
+}
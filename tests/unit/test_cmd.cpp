@@ -22,11 +22,26 @@ void test_cmd ()
     print_help (ss, usage, 0, long_options);
 }
 
+void test_get_jobs ()
+{
+    VERIFY (get_jobs ("1") == 1);
+    VERIFY (get_jobs ("16") == 16);
+
+    // Only positive numbers are valid
+    VERIFY_THROWS (get_jobs ("0");)
+    VERIFY_THROWS (get_jobs ("-1");)
+    VERIFY_THROWS (get_jobs ("");)
+    VERIFY_THROWS (get_jobs ("x");)
+    VERIFY_THROWS (get_jobs ("4x");)
+    VERIFY_THROWS (get_jobs ("99999999999999999999");)
+}
+
 int main (int argc, char **argv)
 {
     try
     {
         test_cmd ();
+        test_get_jobs ();
         return 0;
     }
     catch (const exception &e)
@@ -0,0 +1,258 @@
+#include "spoc/columns.h"
+#include "spoc/io.h"
+#include "spoc/test_utils.h"
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+using namespace spoc::columns;
+using namespace spoc::file;
+using namespace spoc::header;
+using namespace spoc::io;
+using namespace spoc::point_record;
+using namespace spoc::test_utils;
+
+void test_point_columns ()
+{
+    {
+    point_columns pc;
+    VERIFY (pc.empty ());
+    VERIFY (pc.size () == 0);
+    VERIFY (pc.get_extra_fields () == 0);
+    VERIFY (pc.is_valid ());
+    }
+
+    {
+    point_columns pc (100, 3);
+    VERIFY (pc.size () == 100);
+    VERIFY (pc.get_extra_fields () == 3);
+    VERIFY (pc.is_valid ());
+    pc.resize (10);
+    VERIFY (pc.size () == 10);
+    VERIFY (pc.extra[2].size () == 10);
+    VERIFY (pc.is_valid ());
+    pc.resize_extra_fields (5);
+    VERIFY (pc.get_extra_fields () == 5);
+    VERIFY (pc.is_valid ());
+    pc.c.push_back (0);
+    VERIFY (!pc.is_valid ());
+    }
+}
+
+void test_point_columns_get_set ()
+{
+    const size_t total_points = 100;
+    const size_t extra_fields = 4;
+    const auto prs = generate_random_point_records (total_points, extra_fields);
+
+    point_columns pc;
+    for (const auto &p : prs)
+        pc.push_back (p);
+
+    VERIFY (pc.size () == total_points);
+    VERIFY (pc.get_extra_fields () == extra_fields);
+    for (size_t n = 0; n < prs.size (); ++n)
+        VERIFY (pc.get_point_record (n) == prs[n]);
+
+    // Wrong number of extra fields
+    VERIFY_THROWS (pc.push_back (point_record (extra_fields + 1));)
+    VERIFY_THROWS (pc.set_point_record (0, point_record (extra_fields - 1));)
+
+    pc.set_point_record (10, prs[20]);
+    VERIFY (pc.get_point_record (10) == prs[20]);
+}
+
+void test_point_columns_conversion ()
+{
+    const size_t total_points = 1000;
+    const size_t extra_fields = 8;
+    const auto prs = generate_random_point_records (total_points, extra_fields);
+
+    const auto pc = to_point_columns (prs);
+    VERIFY (pc.size () == total_points);
+    VERIFY (pc.get_extra_fields () == extra_fields);
+    VERIFY (pc.x == get_x (prs));
+    VERIFY (pc.c == get_c (prs));
+    VERIFY (pc.b == get_b (prs));
+    VERIFY (pc.extra[7] == get_extra (7, prs));
+    VERIFY (to_point_records (pc) == prs);
+
+    const spoc_file f ("WKT", true, prs);
+    const auto qc = to_point_columns (f);
+    VERIFY (pc == qc);
+    const auto g = to_spoc_file ("WKT", true, qc);
+    VERIFY (g.get_point_records () == prs);
+    VERIFY (g.get_header () == f.get_header ());
+
+    // Empty
+    VERIFY (to_point_records (point_columns ()).empty ());
+    VERIFY (to_point_columns (point_records ()).empty ());
+}
+
+void test_point_columns_append ()
+{
+    const size_t total_points = 1000;
+    const size_t extra_fields = 3;
+    const auto prs = generate_random_point_records (total_points, extra_fields);
+    const auto pc = to_point_columns (prs);
+
+    point_columns qc (0, extra_fields);
+    append (qc, pc, 0, 10);
+    append (qc, pc, 10, 0);
+    append (qc, pc, 10, 500);
+    append (qc, to_point_columns (point_records (prs.begin () + 510, prs.end ())));
+    VERIFY (qc == pc);
+
+    VERIFY_THROWS (append (qc, point_columns (1, extra_fields + 1));)
+}
+
+void test_point_columns_gather ()
+{
+    const size_t extra_fields = 3;
+    const auto prs = generate_random_point_records (1000, extra_fields);
+    const auto pc = to_point_columns (prs);
+
+    // Gather every third point, in reverse
+    vector<size_t> indexes;
+    for (size_t i = 0; i < prs.size (); i += 3)
+        indexes.insert (indexes.begin (), i);
+    point_columns qc (0, extra_fields);
+    gather (qc, pc, indexes.begin (), indexes.begin ());
+    VERIFY (qc.empty ());
+    gather (qc, pc, indexes.begin (), indexes.end ());
+    VERIFY (qc.size () == indexes.size ());
+    for (size_t i = 0; i < indexes.size (); ++i)
+        VERIFY (qc.get_point_record (i) == prs[indexes[i]]);
+
+    VERIFY_THROWS (gather (qc, point_columns (1, extra_fields + 1), indexes.begin (), indexes.begin () + 1);)
+}
+
+void test_point_columns_extent ()
+{
+    const auto prs = generate_random_point_records (1000);
+    const auto pc = to_point_columns (prs);
+    VERIFY (get_extent (pc) == spoc::extent::get_extent (prs));
+}
+
+void test_field_mask ()
+{
+    {
+    const field_mask m;
+    for (size_t j = 0; j < FIXED_FIELDS + 10; ++j)
+        VERIFY (!m.test (j));
+    VERIFY (m.test_all (0));
+    VERIFY (!m.test_all (1));
+    }
+
+    {
+    const auto m = field_mask::all ();
+    for (size_t j = 0; j < FIXED_FIELDS + 10; ++j)
+        VERIFY (m.test (j));
+    VERIFY (m.test_all (FIXED_FIELDS + 10));
+    }
+
+    {
+    const field_mask m {"x", "c", "b", "e2"};
+    VERIFY (m.test (0));
+    VERIFY (!m.test (1));
+    VERIFY (m.test (3));
+    VERIFY (m.test (8));
+    VERIFY (!m.test (FIXED_FIELDS + 1));
+    VERIFY (m.test (FIXED_FIELDS + 2));
+    VERIFY (!m.test (FIXED_FIELDS + 3));
+    }
+
+    {
+    field_mask m {"extra"};
+    VERIFY (!m.test (0));
+    VERIFY (m.test (FIXED_FIELDS + 100));
+    m.set ("y");
+    VERIFY (m.test (1));
+    }
+
+    VERIFY_THROWS (field_mask {"q"};)
+    VERIFY_THROWS (field_mask {"e"};)
+    VERIFY_THROWS (field_mask {"exyz"};)
+    VERIFY_THROWS (field_mask {"xy"};)
+
+    // Clear
+    const auto prs = generate_random_point_records (100, 2);
+    auto pc = to_point_columns (prs);
+    const auto qc = pc;
+    clear_unselected (pc, field_mask {"z", "e1"});
+    VERIFY (pc.z == qc.z);
+    VERIFY (pc.extra[1] == qc.extra[1]);
+    VERIFY (pc.x == vector<double> (100));
+    VERIFY (pc.i == vector<uint16_t> (100));
+    VERIFY (pc.extra[0] == vector<uint64_t> (100));
+}
+
+void test_point_columns_io ()
+{
+    const size_t total_points = 1000;
+    const size_t extra_fields = 3;
+    auto prs = generate_random_point_records (total_points, extra_fields);
+
+    // Zero some fields
+    for (auto &p : prs)
+    {
+        p.r = 0;
+        p.extra[1] = 0;
+    }
+
+    const auto pc = to_point_columns (prs);
+
+    // Compressed
+    {
+    stringstream s;
+    write_spoc_file_compressed (s, "WKT", pc);
+    const auto h = read_header (s);
+    VERIFY (h.compressed);
+    VERIFY (h.wkt == "WKT");
+    VERIFY (h.total_points == total_points);
+    VERIFY (h.extra_fields == extra_fields);
+    const auto qc = read_point_columns (s, h);
+    VERIFY (pc == qc);
+    }
+
+    // Compatible with the point record reader
+    {
+    stringstream s;
+    write_spoc_file_compressed (s, "WKT", pc);
+    const auto f = read_spoc_file (s);
+    VERIFY (f.get_point_records () == prs);
+    }
+
+    // Uncompressed
+    {
+    stringstream s;
+    write_spoc_file_uncompressed (s, spoc_file ("WKT", false, prs));
+    const auto h = read_header (s);
+    VERIFY (!h.compressed);
+    const auto qc = read_point_columns (s, h);
+    VERIFY (pc == qc);
+    }
+}
+
+int main (int argc, char **argv)
+{
+    try
+    {
+        test_point_columns ();
+        test_point_columns_get_set ();
+        test_point_columns_conversion ();
+        test_point_columns_append ();
+        test_point_columns_gather ();
+        test_point_columns_extent ();
+        test_field_mask ();
+        test_point_columns_io ();
+        return 0;
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what () << endl;
+        return -1;
+    }
+}
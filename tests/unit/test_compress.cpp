@@ -1,5 +1,6 @@
 #include "spoc/compression.h"
 #include "spoc/test_utils.h"
+#include <algorithm>
 #include <cassert>
 #include <fstream>
 #include <iostream>
@@ -59,6 +60,16 @@ void test_compress (const char *fn)
             VERIFY (x == z);
             }
 
+            // Caller-provided memory
+            {
+            vector<uint8_t> y (compress_bound (x.size (), l));
+            const size_t n = compress (x.data (), x.size (), y.data (), y.size (), l);
+            VERIFY (n <= y.size ());
+            vector<uint8_t> z (x.size ());
+            decompress (y.data (), n, z.data (), z.size ());
+            VERIFY (x == z);
+            }
+
             // Stream interface
             {
             stringstream is1 (string (x.begin (), x.end ()));
@@ -75,11 +86,125 @@ void test_compress (const char *fn)
     }
 }
 
+void test_compress_direct ()
+{
+    vector<uint8_t> x (100'000);
+    for (size_t i = 0; i < x.size (); ++i)
+        x[i] = i % 7;
+    const auto y = compress (x);
+
+    // Exact size
+    {
+    vector<uint8_t> z (x.size ());
+    decompress (y.data (), y.size (), z.data (), z.size ());
+    VERIFY (x == z);
+    }
+
+    // Wrong sizes
+    {
+    vector<uint8_t> z (x.size () - 1);
+    VERIFY_THROWS (decompress (y.data (), y.size (), z.data (), z.size ());)
+    z.resize (x.size () + 1);
+    VERIFY_THROWS (decompress (y.data (), y.size (), z.data (), z.size ());)
+    z.resize (x.size ());
+    VERIFY_THROWS (decompress (y, z.data (), z.size () + 1);)
+    }
+
+    // Truncated input
+    {
+    vector<uint8_t> z (x.size ());
+    VERIFY_THROWS (decompress (y.data (), y.size () / 2, z.data (), z.size ());)
+    }
+
+    // Output buffer is too small
+    {
+    vector<uint8_t> z (10);
+    VERIFY_THROWS (compress (x.data (), x.size (), z.data (), z.size ());)
+    }
+
+    // Empty input
+    {
+    const auto e = compress (nullptr, 0);
+    VERIFY (!e.empty ());
+    decompress (e.data (), e.size (), nullptr, 0);
+    }
+}
+
+void test_codecs ()
+{
+    // Names
+    for (auto c : {codec::zlib, codec::zstd, codec::lz4, codec::gorilla, codec::none})
+        VERIFY (get_codec (get_codec_name (c)) == c);
+    VERIFY_THROWS (get_codec ("zip");)
+    VERIFY (is_available (codec::zlib));
+    VERIFY (is_available (codec::none));
+    VERIFY (is_available (codec::gorilla));
+    VERIFY (!is_available (static_cast<codec> (0xFF)));
+
+    vector<uint8_t> x (100'000);
+    for (size_t i = 0; i < x.size (); ++i)
+        x[i] = (i / 100) % 13;
+
+    for (auto c : {codec::zlib, codec::zstd, codec::lz4, codec::none})
+    {
+        if (!is_available (c))
+        {
+            VERIFY_THROWS (compress (c, x.data (), x.size ());)
+            continue;
+        }
+        for (auto level : {-1, 1, 5})
+        {
+            const auto y = compress (c, x.data (), x.size (), level);
+            VERIFY (y.size () <= compress_bound (c, x.size (), level));
+            if (c != codec::none)
+                VERIFY (y.size () < x.size ());
+            vector<uint8_t> z (x.size ());
+            decompress (c, y.data (), y.size (), z.data (), z.size ());
+            VERIFY (x == z);
+
+            // Wrong size
+            z.resize (x.size () + 1);
+            VERIFY_THROWS (decompress (c, y.data (), y.size (), z.data (), z.size ());)
+        }
+    }
+
+    // Gorilla only works on 8 byte values
+    {
+    vector<double> d (1000);
+    for (size_t i = 0; i < d.size (); ++i)
+        d[i] = 1000.0 + i / 8;
+    const auto p = reinterpret_cast<const uint8_t *> (d.data ());
+    const size_t nbytes = d.size () * sizeof(double);
+    const auto y = compress (codec::gorilla, p, nbytes);
+    VERIFY (y.size () <= compress_bound (codec::gorilla, nbytes));
+    VERIFY (y.size () < nbytes / 4);
+    vector<double> z (d.size ());
+    decompress (codec::gorilla, y.data (), y.size (), reinterpret_cast<uint8_t *> (z.data ()), nbytes);
+    VERIFY (d == z);
+    VERIFY_THROWS (compress (codec::gorilla, x.data (), 7);)
+    }
+
+    // The zero codec doesn't store anything
+    {
+    vector<uint8_t> z (100, 1);
+    decompress (codec::zero, nullptr, 0, z.data (), z.size ());
+    VERIFY (all_of (z.begin (), z.end (), [](uint8_t i) { return i == 0; }));
+    }
+
+    // Unknown codec
+    {
+    vector<uint8_t> z (100);
+    VERIFY_THROWS (decompress (static_cast<codec> (0xFF), x.data (), x.size (), z.data (), z.size ());)
+    }
+}
+
 int main (int argc, char **argv)
 {
     try
     {
         test_compress (argv[0]);
+        test_compress_direct ();
+        test_codecs ();
 
         return 0;
     }
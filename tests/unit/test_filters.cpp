@@ -0,0 +1,136 @@
+#include "spoc/filters.h"
+#include "spoc/test_utils.h"
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+using namespace spoc::filters;
+
+const vector<uint8_t> all_filters {
+    NONE, DELTA, XOR, ZIGZAG,
+    SHUFFLE, DELTA | SHUFFLE, XOR | SHUFFLE, ZIGZAG | SHUFFLE};
+
+template<typename T>
+void test_round_trip (const vector<T> &x)
+{
+    for (auto f : all_filters)
+    {
+        vector<uint8_t> y (x.size () * sizeof(T));
+        apply (f, x.data (), x.size (), y.data ());
+        vector<T> z (x.size ());
+        unapply (f, y.data (), z.size (), z.data ());
+        // Compare bit patterns, so that NaNs compare equal
+        VERIFY (memcmp (x.data (), z.data (), x.size () * sizeof(T)) == 0);
+    }
+}
+
+void test_filters ()
+{
+    default_random_engine g;
+
+    // Coordinates
+    {
+    vector<double> x (1000);
+    normal_distribution<double> d (1e6, 10.0);
+    for (auto &i : x)
+        i = d (g);
+    x[10] = numeric_limits<double>::quiet_NaN ();
+    x[11] = numeric_limits<double>::infinity ();
+    x[12] = -0.0;
+    test_round_trip (x);
+    }
+
+    // Integers, including wrap-around
+    {
+    vector<uint16_t> x (1000);
+    uniform_int_distribution<uint16_t> d;
+    for (auto &i : x)
+        i = d (g);
+    x[0] = 0xFFFF;
+    x[1] = 0;
+    test_round_trip (x);
+    }
+    {
+    vector<uint32_t> x (1000);
+    for (size_t i = 0; i < x.size (); ++i)
+        x[i] = (i * 7) % 19;
+    test_round_trip (x);
+    }
+    {
+    vector<uint64_t> x {numeric_limits<uint64_t>::max (), 0, 1, numeric_limits<uint64_t>::max ()};
+    test_round_trip (x);
+    }
+
+    // Empty and single values
+    test_round_trip (vector<double> ());
+    test_round_trip (vector<uint32_t> {123});
+}
+
+void test_filter_values ()
+{
+    // Slowly increasing values have small deltas
+    const vector<uint32_t> x {100, 101, 103, 102};
+    vector<uint32_t> y (x.size ());
+    apply (DELTA, x.data (), x.size (), reinterpret_cast<uint8_t *> (y.data ()));
+    VERIFY (y == (vector<uint32_t> {100, 1, 2, 0xFFFFFFFF}));
+    apply (ZIGZAG, x.data (), x.size (), reinterpret_cast<uint8_t *> (y.data ()));
+    VERIFY (y == (vector<uint32_t> {200, 2, 4, 1}));
+    apply (XOR, x.data (), x.size (), reinterpret_cast<uint8_t *> (y.data ()));
+    VERIFY (y == (vector<uint32_t> {100, 1, 2, 1}));
+
+    // Shuffle groups bytes by significance
+    const vector<uint16_t> s {0x0102, 0x0304};
+    vector<uint8_t> t (4);
+    apply (SHUFFLE, s.data (), s.size (), t.data ());
+    VERIFY (t == (vector<uint8_t> {0x02, 0x04, 0x01, 0x03}));
+}
+
+void test_filter_names ()
+{
+    for (auto f : all_filters)
+    {
+        VERIFY (is_valid (f));
+        VERIFY (get_filter (get_filter_name (f)) == f);
+    }
+    for (int f : {PACK | NONE, PACK | DELTA, PACK | XOR, PACK | ZIGZAG})
+    {
+        VERIFY (is_valid (f));
+        VERIFY (get_filter (get_filter_name (f)) == f);
+    }
+    VERIFY (!is_valid (SHUFFLE | PACK));
+    VERIFY_THROWS (get_filter ("pack+shuffle");)
+    VERIFY_THROWS (get_filter ("delta+");)
+    VERIFY_THROWS (get_filter ("none+pack");)
+    VERIFY (!is_valid (0x04));
+    VERIFY (!is_valid (0x40));
+    VERIFY (get_filter_name (0x80) == "unknown");
+    VERIFY_THROWS (get_filter ("foo");)
+
+    vector<uint8_t> y (8);
+    const double x = 1.0;
+    VERIFY_THROWS (apply (0x80, &x, 1, y.data ());)
+
+    // Packing changes the size, so it isn't applied here
+    VERIFY_THROWS (apply (PACK, &x, 1, y.data ());)
+}
+
+int main (int argc, char **argv)
+{
+    try
+    {
+        test_filters ();
+        test_filter_values ();
+        test_filter_names ();
+        return 0;
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what () << endl;
+        return -1;
+    }
+}
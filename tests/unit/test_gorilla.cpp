@@ -0,0 +1,149 @@
+#include "spoc/gorilla.h"
+#include "spoc/test_utils.h"
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+using namespace spoc::gorilla;
+
+vector<uint8_t> encode (const vector<double> &x)
+{
+    const auto p = reinterpret_cast<const uint8_t *> (x.data ());
+    const size_t nbytes = x.size () * sizeof(double);
+    vector<uint8_t> y (encode_bound (nbytes));
+    y.resize (encode (p, nbytes, y.data (), y.size ()));
+    return y;
+}
+
+vector<double> decode (const vector<uint8_t> &y, const size_t n)
+{
+    vector<double> x (n);
+    decode (y.data (), y.size (), reinterpret_cast<uint8_t *> (x.data ()), n * sizeof(double));
+    return x;
+}
+
+void test_round_trip (const vector<double> &x)
+{
+    const auto y = encode (x);
+    VERIFY (y.size () <= encode_bound (x.size () * sizeof(double)));
+    const auto z = decode (y, x.size ());
+    // Compare bit patterns, so that NaNs compare equal
+    VERIFY (memcmp (x.data (), z.data (), x.size () * sizeof(double)) == 0);
+}
+
+void test_gorilla ()
+{
+    // Empty
+    test_round_trip (vector<double> ());
+    VERIFY (encode (vector<double> ()).empty ());
+
+    // Single values
+    test_round_trip (vector<double> {0.0});
+    test_round_trip (vector<double> {1.0});
+    test_round_trip (vector<double> {-1.0});
+
+    // Repeated values take one bit each
+    {
+    const vector<double> x (800, 123.456);
+    test_round_trip (x);
+    VERIFY (encode (x).size () < 120);
+    }
+
+    // Special values
+    test_round_trip (vector<double> {
+        numeric_limits<double>::quiet_NaN (),
+        numeric_limits<double>::infinity (),
+        -numeric_limits<double>::infinity (),
+        -0.0, 0.0,
+        numeric_limits<double>::denorm_min (),
+        numeric_limits<double>::max (),
+        numeric_limits<double>::lowest ()});
+
+    // Every bit pattern width
+    {
+    vector<double> x;
+    for (unsigned i = 0; i < 64; ++i)
+    {
+        const uint64_t u = (i == 63 ? ~uint64_t (0) : (uint64_t (1) << (i + 1)) - 1) << (63 - i);
+        double d;
+        memcpy (&d, &u, sizeof(double));
+        x.push_back (d);
+        x.push_back (0.0);
+    }
+    test_round_trip (x);
+    }
+
+    // Coordinates
+    {
+    default_random_engine g;
+    normal_distribution<double> d (0.0, 1.0);
+    vector<double> x (10'000);
+    double v = 500'000.0;
+    for (auto &i : x)
+    {
+        v += d (g);
+        i = round (v * 1000.0) / 1000.0;
+    }
+    test_round_trip (x);
+    VERIFY (encode (x).size () < x.size () * sizeof(double));
+
+    // Random bit patterns
+    uniform_int_distribution<uint64_t> b;
+    for (auto &i : x)
+    {
+        const uint64_t u = b (g);
+        memcpy (&i, &u, sizeof(double));
+    }
+    test_round_trip (x);
+    }
+}
+
+void test_gorilla_errors ()
+{
+    const vector<double> x {1.0, 2.0, 3.0, 4.0};
+    const auto y = encode (x);
+    vector<uint8_t> z (x.size () * sizeof(double));
+
+    // Not a multiple of 8 bytes
+    VERIFY_THROWS (decode (y.data (), y.size (), z.data (), z.size () - 1);)
+    vector<uint8_t> w (100);
+    VERIFY_THROWS (encode (z.data (), 7, w.data (), w.size ());)
+
+    // Output too small
+    VERIFY_THROWS (encode (reinterpret_cast<const uint8_t *> (x.data ()), z.size (), w.data (), 2);)
+
+    // Truncated
+    VERIFY_THROWS (decode (y.data (), y.size () - 1, z.data (), z.size ());)
+
+    // Too many bytes
+    auto t = y;
+    t.push_back (0);
+    VERIFY_THROWS (decode (t.data (), t.size (), z.data (), z.size ());)
+
+    // Too few values
+    VERIFY_THROWS (decode (y.data (), y.size (), z.data (), z.size () - 8);)
+
+    // A window before the first window
+    const vector<uint8_t> u {0x01, 0x00};
+    VERIFY_THROWS (decode (u.data (), u.size (), z.data (), 8);)
+}
+
+int main (int argc, char **argv)
+{
+    try
+    {
+        test_gorilla ();
+        test_gorilla_errors ();
+        return 0;
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what () << endl;
+        return -1;
+    }
+}
@@ -93,6 +93,22 @@ void test_relational ()
     h1.compressed = !h1.compressed;
     test_not_equal (h1, h2);
     h1 = h2;
+
+    // Change extent
+    test_equal (h1, h2);
+    h1.e = spoc::extent::extent { { 1, 2, 3 }, { 4, 5, 6 } };
+    test_not_equal (h1, h2);
+    h2.e = h1.e;
+    test_equal (h1, h2);
+    h1.e->maxp.z += 1;
+    test_not_equal (h1, h2);
+    h1 = h2;
+
+    // Change streaming
+    test_equal (h1, h2);
+    h1.streaming = !h1.streaming;
+    test_not_equal (h1, h2);
+    h1 = h2;
 }
 
 void test_read_write ()
@@ -110,6 +126,70 @@ void test_read_write ()
     VERIFY (h == g);
     }
 
+    // Test read/write with an extent
+    {
+    header h ("Test WKT", 2, 100, true);
+    h.e = spoc::extent::extent { { -1, -2, -3 }, { 4, 5, 6 } };
+    stringstream s;
+    write_header (s, h);
+    const auto g = read_header (s);
+    VERIFY (h == g);
+    VERIFY (g.e->minp.y == -2);
+    }
+
+    // Older headers don't store the extent
+    {
+    header h ("Test WKT", 2, 100, true);
+    h.minor_version = EXTENT_MINOR_VERSION - 1;
+    h.e = spoc::extent::extent { { -1, -2, -3 }, { 4, 5, 6 } };
+    stringstream s;
+    write_header (s, h);
+    s << 'X';
+    const auto g = read_header (s);
+    VERIFY (!g.e.has_value ());
+    VERIFY (s.get () == 'X');
+    }
+
+    // Streaming headers don't know the number of points
+    {
+    header h ("Test WKT", 2, 0, true);
+    h.streaming = true;
+    stringstream s;
+    write_header (s, h);
+    const auto g = read_header (s);
+    VERIFY (h == g);
+    VERIFY (g.streaming);
+    }
+
+    // Uncompressed files can be streamed, too
+    {
+    header h ("Test WKT", 2, 0, false);
+    h.streaming = true;
+    stringstream s;
+    write_header (s, h);
+    VERIFY (read_header (s) == h);
+    }
+
+    // Older headers can't be streamed
+    {
+    header h ("Test WKT", 2, 0, true);
+    h.minor_version = EXTENT_MINOR_VERSION - 1;
+    h.streaming = true;
+    stringstream s;
+    VERIFY_THROWS (write_header (s, h);)
+    }
+
+    // Fail on unknown flags
+    {
+    header h ("Test WKT", 2, 0, true);
+    stringstream s;
+    write_header (s, h);
+    auto str = s.str ();
+    str.back () = 0x80;
+    stringstream t (str);
+    VERIFY_THROWS (read_header (t);)
+    }
+
     // Fail when reading signature
     {
     stringstream s;
@@ -118,19 +198,13 @@ void test_read_write ()
     VERIFY_THROWS (read_header (s);)
     }
 
-    // It's not OK if the minor versions don't match, but that's
-    // only because we are still in beta (MAJOR_VERSION == 0).
-    //
-    // When the major version goes to 1, this behavior will need to
-    // change. For example, we can choose to allow reading files with
-    // any minor version, as long as the major versions match, or we
-    // can choose to allow reading files with only the same or older
-    // minor versions.
+    // It's OK to read a file with an older minor version, because
+    // the readers know how to decode older layouts, but it's not OK to
+    // read a file with a newer minor version.
     //
     // This next verify statement will ensure that our tests break
     // when we bump the version up from 0. When that happens, we will
-    // have to fix this test and change the `header::read_header()`
-    // function appropriately to allow for minor version mismatches.
+    // have to revisit the version rules in `header::read_header()`.
     VERIFY (spoc::MAJOR_VERSION == 0);
     {
     stringstream s;
@@ -139,6 +213,14 @@ void test_read_write ()
     write_header (s, h);
     VERIFY_THROWS (read_header (s);)
     }
+    {
+    stringstream s;
+    header h;
+    --h.minor_version;
+    write_header (s, h);
+    const auto g = read_header (s);
+    VERIFY (g.minor_version == spoc::MINOR_VERSION - 1);
+    }
 
     // It's not OK if the major versions don't match
     {
@@ -0,0 +1,184 @@
+#include "spoc/index.h"
+#include "spoc/test_utils.h"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+using E = spoc::extent::extent;
+using namespace spoc::file;
+using namespace spoc::index;
+using namespace spoc::io;
+using namespace spoc::point_record;
+using namespace spoc::test_utils;
+
+void test_build_index ()
+{
+    // Empty
+    {
+    point_records p;
+    const auto idx = build_index (p);
+    VERIFY (idx.is_valid ());
+    VERIFY (idx.get_total_points () == 0);
+    }
+
+    auto p = generate_random_point_records (10000);
+    const auto q = p;
+    const auto idx = build_index (p, 0.1);
+    VERIFY (idx.is_valid ());
+    VERIFY (idx.get_total_points () == p.size ());
+    VERIFY (idx.nx == 20);
+    VERIFY (idx.ny == 20);
+
+    // Every point is in its cell's range
+    for (size_t k = 0; k + 1 < idx.offsets.size (); ++k)
+        for (size_t i = idx.offsets[k]; i < idx.offsets[k + 1]; ++i)
+            VERIFY (get_cell (idx, p[i]) == k);
+
+    // It's a permutation, and the sort is stable
+    auto r = q;
+    stable_sort (r.begin (), r.end (), [&](const auto &a, const auto &b)
+        { return get_cell (idx, a) < get_cell (idx, b); });
+    VERIFY (r == p);
+
+    // The default cell size gives about the default number of points
+    // in each cell
+    auto s = generate_random_point_records (100 * DEFAULT_POINTS_PER_CELL);
+    const auto jdx = build_index (s);
+    VERIFY (jdx.nx * jdx.ny >= 100);
+    VERIFY (jdx.nx * jdx.ny <= 121);
+
+    // Too many cells
+    VERIFY_THROWS (build_index (p, 1e-9);)
+}
+
+void test_degenerate ()
+{
+    // All the same point
+    {
+    point_records p (100, point_record (1, 2, 3, 0, 0, 0, 0, 0, 0));
+    const auto idx = build_index (p);
+    VERIFY (idx.is_valid ());
+    VERIFY (idx.nx == 1 && idx.ny == 1);
+    VERIFY (get_ranges (idx, E { { 0, 0, 0 }, { 2, 2, 2 } }).size () == 1);
+    VERIFY (get_ranges (idx, E { { 5, 5, 0 }, { 6, 6, 2 } }).empty ());
+    }
+
+    // NaNs go in the first cell, and don't break the extent
+    {
+    auto p = generate_random_point_records (1000);
+    p[10].x = numeric_limits<double>::quiet_NaN ();
+    p[20].y = numeric_limits<double>::quiet_NaN ();
+    const auto idx = build_index (p, 0.5);
+    VERIFY (idx.is_valid ());
+    VERIFY (idx.nx == 4 && idx.ny == 4);
+    VERIFY (get_cell (idx, p[0]) == 0);
+    }
+}
+
+void test_get_ranges ()
+{
+    auto p = generate_random_point_records (10000);
+    const auto idx = build_index (p, 0.1);
+
+    // A range for each row
+    const auto r = get_ranges (idx, E { { -0.95, -0.95, 0 }, { -0.75, -0.55, 0 } });
+    VERIFY (r.size () == 5);
+    VERIFY (is_sorted (r.begin (), r.end ()));
+
+    // Whole rows merge
+    const auto a = get_ranges (idx, E { { -2, -2, 0 }, { 2, 2, 0 } });
+    VERIFY (a.size () == 1);
+    VERIFY (a[0].first == 0);
+    VERIFY (a[0].second == p.size ());
+
+    // Outside
+    VERIFY (get_ranges (idx, E { { 2, 2, 0 }, { 3, 3, 0 } }).empty ());
+    VERIFY (get_ranges (idx, E { { -3, -3, 0 }, { -2, -2, 0 } }).empty ());
+}
+
+void test_read_write ()
+{
+    auto p = generate_random_point_records (1000);
+    const auto idx = build_index (p, 0.3);
+    stringstream s;
+    write_index (s, idx);
+    VERIFY (read_index (s) == idx);
+
+    // Invalid
+    stringstream t;
+    t << "SIDY";
+    VERIFY_THROWS (read_index (t);)
+
+    // Truncated
+    const auto str = s.str ();
+    stringstream u (str.substr (0, str.size () - 1));
+    VERIFY_THROWS (read_index (u);)
+}
+
+void test_query_box ()
+{
+    auto p = generate_random_point_records (20000, 2);
+    const auto idx = build_index (p, 0.05);
+
+    for (auto compressed : {false, true})
+    {
+        const string fn = generate_tmp_filename ();
+        {
+        ofstream ofs (fn, ios::binary);
+        compression_options opts;
+        opts.block_size = 1000;
+        write_spoc_file (ofs, spoc_file ("Test wkt", compressed, p), opts);
+        ofstream ifs (get_index_filename (fn), ios::binary);
+        write_index (ifs, idx);
+        }
+
+        for (const auto &e : {
+            E { { -0.5, -0.5, -1 }, { 0.5, 0.5, 1 } },
+            E { { 0.1, -0.9, -0.2 }, { 0.2, 0.9, 0.2 } },
+            E { { -2, -2, -2 }, { 2, 2, 2 } },
+            E { { 2, 2, 2 }, { 3, 3, 3 } } })
+        {
+            const auto f = query_box (fn, e);
+            VERIFY (f.get_wkt () == "Test wkt");
+            VERIFY (f.get_compressed () == compressed);
+            VERIFY (f.get_point_records () == spoc::utils::crop (p, e));
+        }
+
+        // The index must match the file
+        {
+        ofstream ofs (fn, ios::binary);
+        write_spoc_file (ofs, spoc_file ("Test wkt", compressed, point_records (p.begin (), p.begin () + 10)));
+        }
+        VERIFY_THROWS (query_box (fn, E { { -1, -1, -1 }, { 1, 1, 1 } });)
+
+        filesystem::remove (fn);
+        filesystem::remove (get_index_filename (fn));
+    }
+
+    // No index
+    VERIFY_THROWS (query_box (generate_tmp_filename (), E ());)
+}
+
+int main (int argc, char **argv)
+{
+    try
+    {
+        test_build_index ();
+        test_degenerate ();
+        test_get_ranges ();
+        test_read_write ();
+        test_query_box ();
+        return 0;
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what () << endl;
+        return -1;
+    }
+}
@@ -3,7 +3,12 @@
 #include "spoc/header.h"
 #include "spoc/io.h"
 #include "spoc/test_utils.h"
+#include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <limits>
 #include <random>
 #include <vector>
 #include <stdexcept>
@@ -76,6 +81,14 @@ void test_spoc_file_compressed_io ()
     VERIFY (p == f.get_point_records ());
     }
 
+    // Read the points with the number of points and extra fields
+    {
+    stringstream s;
+    write_spoc_file_compressed (s, spoc_file (wkt, true, p));
+    const auto h = read_header (s);
+    VERIFY (p == read_compressed_points (s, h.total_points, h.extra_fields));
+    }
+
     // Compare sizes
     {
     stringstream s1;
@@ -136,6 +149,978 @@ void test_spoc_file_compressed_io ()
     }
 }
 
+void test_point_record_writer ()
+{
+    const size_t total_points = 1000;
+
+    for (auto extra_fields : {0, 3})
+    for (auto policy : {flush_policy::block, flush_policy::record})
+    for (auto block_size : {0, 100, 1 << 20})
+    {
+        const auto p = generate_random_point_records (total_points, extra_fields);
+
+        // Must match the unbuffered writer
+        stringstream s1;
+        for (const auto &i : p)
+            spoc::point_record::write_point_record (s1, i);
+
+        stringstream s2;
+        point_record_writer w (s2, extra_fields, policy, block_size);
+        w.write (p);
+        if (policy == flush_policy::record)
+            VERIFY (w.get_pending_bytes () == 0);
+        w.flush ();
+        VERIFY (w.get_pending_bytes () == 0);
+        VERIFY (s1.str () == s2.str ());
+
+        // Wrong number of extra fields
+        VERIFY_THROWS (w.write (spoc::point_record::point_record (extra_fields + 1));)
+    }
+
+    // The DTOR flushes
+    {
+    const auto p = generate_random_point_records (10);
+    stringstream s;
+    {
+    point_record_writer w (s, 0);
+    w.write (p);
+    }
+    VERIFY (s.str ().size () == p.size () * get_record_size (0));
+    }
+}
+
+void test_mapped_spoc_file ()
+{
+    const size_t total_points = 1000;
+
+    for (auto extra_fields : {0, 3})
+    {
+        const auto p = generate_random_point_records (total_points, extra_fields);
+        const string fn = generate_tmp_filename ();
+        {
+        ofstream ofs (fn, ios::binary);
+        write_spoc_file_uncompressed (ofs, spoc_file ("Test wkt", false, p));
+        }
+
+        {
+        const mapped_spoc_file m (fn);
+        VERIFY (m.get_header ().wkt == "Test wkt");
+        VERIFY (m.size () == total_points);
+        VERIFY (m.get_record_size () == get_record_size (extra_fields));
+
+        // Random access
+        for (auto i : {size_t (0), size_t (500), total_points - 1})
+            VERIFY (m.get_point_record (i) == p[i]);
+        VERIFY_THROWS (m.get_point_record (total_points);)
+
+        // Field views
+        const auto x = m.get_x ();
+        const auto c = m.get_c ();
+        const auto b = m.get_b ();
+        VERIFY (x.size () == total_points);
+        for (size_t i = 0; i < total_points; ++i)
+        {
+            VERIFY (x[i] == p[i].x);
+            VERIFY (c[i] == p[i].c);
+            VERIFY (b[i] == p[i].b);
+        }
+        VERIFY_THROWS (x.at (total_points);)
+        for (size_t k = 0; k < size_t (extra_fields); ++k)
+        {
+            const auto e = m.get_extra (k);
+            for (size_t i = 0; i < total_points; ++i)
+                VERIFY (e[i] == p[i].extra[k]);
+        }
+        VERIFY_THROWS (m.get_extra (extra_fields);)
+        }
+
+        std::filesystem::remove (fn);
+    }
+
+    // Compressed files can't be mapped
+    {
+    const string fn = generate_tmp_filename ();
+    {
+    ofstream ofs (fn, ios::binary);
+    write_spoc_file_compressed (ofs, spoc_file ("Test wkt", true, generate_random_point_records (10)));
+    }
+    VERIFY_THROWS (mapped_spoc_file m (fn);)
+    std::filesystem::remove (fn);
+    }
+
+    // Truncated file
+    {
+    const string fn = generate_tmp_filename ();
+    {
+    ofstream ofs (fn, ios::binary);
+    header h ("Test wkt", 0, 100, false);
+    write_header (ofs, h);
+    }
+    VERIFY_THROWS (mapped_spoc_file m (fn);)
+    std::filesystem::remove (fn);
+    }
+
+    // Missing file
+    VERIFY_THROWS (mapped_spoc_file m (generate_tmp_filename ());)
+}
+
+void test_compressed_blocks ()
+{
+    const string wkt = "Test wkt";
+
+    for (auto total_points : {0, 1, 1000})
+    for (auto block_size : {size_t (1), size_t (7), size_t (1000), DEFAULT_BLOCK_SIZE})
+    {
+        const size_t extra_fields = 3;
+        auto p = generate_random_point_records (total_points, extra_fields);
+        for (auto &i : p)
+            i.extra[1] = 0;
+
+        stringstream s;
+        write_spoc_file_compressed (s, spoc_file (wkt, true, p), compression_options {.block_size = block_size});
+
+        // Sequential read
+        {
+        stringstream t (s.str ());
+        const auto f = read_spoc_file (t);
+        VERIFY (f.get_point_records () == p);
+        }
+
+        // Random access
+        const auto h = read_header (s);
+        VERIFY (h.minor_version == spoc::MINOR_VERSION);
+        const auto start = s.tellg ();
+        const auto d = read_block_directory (s, h);
+        VERIFY (s.tellg () == start);
+        VERIFY (d.size () == (total_points + block_size - 1) / block_size);
+        size_t n = 0;
+        for (const auto &e : d)
+        {
+            VERIFY (e.total_points <= block_size);
+            VERIFY (e.stats.has_value ());
+            VERIFY (e.stats->min.size () == spoc::stats::INTEGER_FIELDS + extra_fields);
+            n += e.total_points;
+        }
+        VERIFY (n == size_t (total_points));
+
+        // Decode the last block by itself
+        if (!d.empty ())
+        {
+            const auto &e = d.back ();
+            s.seekg (start + static_cast<streamoff> (e.offset));
+            const auto b = read_compressed_block (s, extra_fields);
+            VERIFY (b.total_points == e.total_points);
+            VERIFY (b.fields[spoc::columns::FIXED_FIELDS + 1].codec == field_codec::zero);
+            spoc::columns::point_columns pc (b.total_points, extra_fields);
+            decompress_block (b, pc, 0);
+            for (size_t i = 0; i < pc.size (); ++i)
+                VERIFY (pc.get_point_record (i) == p[total_points - pc.size () + i]);
+
+            // Doesn't fit
+            spoc::columns::point_columns qc (b.total_points, extra_fields);
+            VERIFY_THROWS (decompress_block (b, qc, 1);)
+        }
+    }
+
+    // Decompress all of the blocks together
+    {
+    const size_t total_points = 1000;
+    const size_t extra_fields = 2;
+    const auto pc = spoc::columns::to_point_columns (generate_random_point_records (total_points, extra_fields));
+    vector<compressed_block> bs;
+    for (size_t first = 0; first < total_points; first += 300)
+        bs.push_back (compress_block (pc, first, min (size_t (300), total_points - first)));
+    spoc::columns::point_columns qc (total_points, extra_fields);
+    decompress_blocks (bs, qc);
+    VERIFY (pc == qc);
+
+    // Doesn't fit
+    VERIFY_THROWS (decompress_blocks (bs, qc, 1);)
+
+    // Corrupt codec
+    bs[2].fields[4].codec = static_cast<field_codec> (0xFF);
+    VERIFY_THROWS (decompress_blocks (bs, qc);)
+    }
+
+    // Other codecs
+    for (auto c : {spoc::compression::codec::none,
+        spoc::compression::codec::zstd,
+        spoc::compression::codec::lz4})
+    {
+        const auto p = generate_random_point_records (1000, 2);
+        stringstream s;
+        compression_options opts;
+        opts.codec = c;
+        if (!spoc::compression::is_available (c))
+        {
+            VERIFY_THROWS (write_spoc_file_compressed (s, spoc_file (wkt, true, p), opts);)
+            continue;
+        }
+        write_spoc_file_compressed (s, spoc_file (wkt, true, p), opts);
+        const auto f = read_spoc_file (s);
+        VERIFY (f.get_point_records () == p);
+    }
+
+    // Pre-compression filters
+    for (auto c : {spoc::compression::codec::zlib, spoc::compression::codec::none})
+    {
+        const auto p = generate_random_point_records (1000, 2);
+        stringstream s;
+        compression_options opts;
+        opts.codec = c;
+        opts.float_filter = spoc::filters::XOR | spoc::filters::SHUFFLE;
+        opts.integer_filter = spoc::filters::ZIGZAG | spoc::filters::SHUFFLE;
+        write_spoc_file_compressed (s, spoc_file (wkt, true, p), opts);
+        const auto f = read_spoc_file (s);
+        VERIFY (f.get_point_records () == p);
+
+        // Unknown filter
+        const auto pc = spoc::columns::to_point_columns (p);
+        auto b = compress_block (pc, 0, pc.size (), opts);
+        VERIFY (b.fields[0].filter == opts.float_filter);
+        VERIFY (b.fields[3].filter == opts.integer_filter);
+        b.fields[0].filter = 0xFF;
+        spoc::columns::point_columns qc (pc.size (), pc.get_extra_fields ());
+        VERIFY_THROWS (decompress_block (b, qc, 0);)
+    }
+
+    // Bit packing, with and without a codec
+    for (auto c : {spoc::compression::codec::zlib, spoc::compression::codec::none})
+    for (auto filter : {spoc::filters::PACK, uint8_t (spoc::filters::ZIGZAG | spoc::filters::PACK)})
+    {
+        auto p = generate_random_point_records (1000, 2);
+        for (size_t i = 0; i < p.size (); ++i)
+        {
+            p[i].c = i % 19;
+            p[i].p = 1000 + i;
+            p[i].extra[1] = ~uint64_t (0) - i % 3;
+        }
+        compression_options opts;
+        opts.codec = c;
+        opts.integer_filter = filter;
+        stringstream s1, s2;
+        write_spoc_file_compressed (s1, spoc_file (wkt, true, p), opts);
+        opts.integer_filter = spoc::filters::NONE;
+        write_spoc_file_compressed (s2, spoc_file (wkt, true, p), opts);
+        VERIFY (s1.str ().size () < s2.str ().size ());
+        const auto f = read_spoc_file (s1);
+        VERIFY (f.get_point_records () == p);
+
+        // Corrupt frame
+        opts.integer_filter = filter;
+        const auto pc = spoc::columns::to_point_columns (p);
+        auto b = compress_block (pc, 0, pc.size (), opts);
+        VERIFY (b.fields[3].filter == filter);
+        spoc::columns::point_columns qc (pc.size (), pc.get_extra_fields ());
+        b.fields[3].bytes[8] = 40;
+        VERIFY_THROWS (decompress_block (b, qc, 0);)
+        b.fields[3].bytes.resize (4);
+        VERIFY_THROWS (decompress_block (b, qc, 0);)
+    }
+
+    // A separate codec for x, y, and z
+    {
+    const auto p = generate_random_point_records (1000, 2);
+    compression_options opts;
+    opts.float_codec = spoc::compression::codec::gorilla;
+    stringstream s;
+    write_spoc_file_compressed (s, spoc_file (wkt, true, p), opts);
+    const auto f = read_spoc_file (s);
+    VERIFY (f.get_point_records () == p);
+
+    const auto pc = spoc::columns::to_point_columns (p);
+    const auto b = compress_block (pc, 0, pc.size (), opts);
+    VERIFY (b.fields[0].codec == spoc::compression::codec::gorilla);
+    VERIFY (b.fields[2].codec == spoc::compression::codec::gorilla);
+    VERIFY (b.fields[3].codec == spoc::compression::codec::zlib);
+
+    // Gorilla can't be used for the integer fields
+    opts.codec = spoc::compression::codec::gorilla;
+    VERIFY_THROWS (write_spoc_file_compressed (s, spoc_file (wkt, true, p), opts);)
+
+    // Packed bits aren't 8 byte values, so gorilla can't encode them
+    opts.codec = spoc::compression::codec::zlib;
+    opts.float_filter = spoc::filters::XOR | spoc::filters::PACK;
+    VERIFY_THROWS (check_compression_options (opts);)
+    opts.float_filter = spoc::filters::XOR | spoc::filters::SHUFFLE;
+    check_compression_options (opts);
+    }
+
+    // Stored without compression is bigger than zlib
+    {
+    const auto p = generate_random_point_records (1000, 2);
+    stringstream s1, s2;
+    write_spoc_file_compressed (s1, spoc_file (wkt, true, p));
+    write_spoc_file_compressed (s2, spoc_file (wkt, true, p), compression_options {.codec = spoc::compression::codec::none});
+    VERIFY (s1.str ().size () < s2.str ().size ());
+    }
+
+    // The zero codec can't be used for writing
+    {
+    stringstream s;
+    VERIFY_THROWS (write_spoc_file_compressed (s, spoc_file (wkt, true, generate_random_point_records (10)), compression_options {.codec = spoc::compression::codec::zero});)
+    }
+
+    // Invalid block size
+    {
+    stringstream s;
+    VERIFY_THROWS (write_spoc_file_compressed (s, spoc_file (wkt, true, generate_random_point_records (10)), compression_options {.block_size = 0});)
+    }
+
+    // Truncated
+    {
+    stringstream s;
+    write_spoc_file_compressed (s, spoc_file (wkt, true, generate_random_point_records (100)), compression_options {.block_size = 10});
+    auto str = s.str ();
+    str.resize (str.size () / 2);
+    stringstream t (str);
+    VERIFY_THROWS (read_spoc_file (t);)
+    }
+
+    // Header disagrees with the data
+    {
+    stringstream s;
+    const auto pc = spoc::columns::to_point_columns (generate_random_point_records (100));
+    write_header (s, header (wkt, 0, 101, true));
+    write_compressed_columns (s, pc);
+    VERIFY_THROWS (read_spoc_file (s);)
+    }
+}
+
+// A stream buffer that can't seek, like a pipe
+class pipe_buffer : public std::streambuf
+{
+    public:
+    explicit pipe_buffer (const string &s)
+        : str (s)
+    {
+        setg (str.data (), str.data (), str.data () + str.size ());
+    }
+    private:
+    string str;
+};
+
+// An output stream buffer that can't seek, like a pipe
+class pipe_sink : public std::streambuf
+{
+    public:
+    string str;
+    protected:
+    int_type overflow (int_type c) override
+    {
+        if (!traits_type::eq_int_type (c, traits_type::eof ()))
+            str.push_back (traits_type::to_char_type (c));
+        return traits_type::not_eof (c);
+    }
+    std::streamsize xsputn (const char *s, std::streamsize n) override
+    {
+        str.append (s, n);
+        return n;
+    }
+};
+
+void test_block_reader ()
+{
+    const size_t total_points = 1000;
+    const size_t extra_fields = 2;
+    const auto p = generate_random_point_records (total_points, extra_fields);
+    const auto pc = spoc::columns::to_point_columns (p);
+
+    stringstream s;
+    write_spoc_file_compressed (s, "Test wkt", pc, compression_options {.block_size = 10});
+    const auto str = s.str ();
+
+    // Any amount of read-ahead gives the same points, in order
+    for (auto read_ahead : {size_t (0), size_t (1), size_t (3), size_t (1000)})
+    {
+        stringstream t (str);
+        const auto h = read_header (t);
+        VERIFY (read_compressed_columns (t, h, spoc::columns::field_mask::all (), read_ahead) == pc);
+        // The stream is left where a full read would leave it
+        VERIFY (t.tellg () == streampos (str.size ()));
+
+        // Blocks come out in order
+        stringstream u (str);
+        read_header (u);
+        block_reader r (u, h, read_ahead);
+        size_t n = 0;
+        for (auto bs = r.pop (); !bs.empty (); bs = r.pop ())
+        {
+            VERIFY (bs.size () <= max (read_ahead, size_t (1)));
+            for (const auto &b : bs)
+            {
+                spoc::columns::point_columns q (b.total_points, extra_fields);
+                decompress_block (b, q, 0);
+                VERIFY (q.x.front () == pc.x[n]);
+                n += b.total_points;
+            }
+        }
+        VERIFY (n == total_points);
+    }
+
+    // Pipes
+    {
+    pipe_buffer b (str);
+    istream t (&b);
+    const auto h = read_header (t);
+    VERIFY (read_compressed_columns (t, h) == pc);
+    }
+
+    // Stop early
+    {
+    stringstream t (str);
+    const auto h = read_header (t);
+    block_reader r (t, h, 1);
+    VERIFY (!r.pop ().empty ());
+    }
+
+    // Errors on the reading thread get rethrown
+    {
+    stringstream t (str.substr (0, str.size () / 2));
+    const auto h = read_header (t);
+    VERIFY_THROWS (read_compressed_columns (t, h);)
+    }
+    {
+    stringstream t (str);
+    auto h = read_header (t);
+    h.total_points -= 1;
+    VERIFY_THROWS (read_compressed_columns (t, h);)
+    }
+}
+
+void test_compressed_writer ()
+{
+    const size_t total_points = 1000;
+    const size_t extra_fields = 2;
+    const auto p = generate_random_point_records (total_points, extra_fields);
+    const auto pc = spoc::columns::to_point_columns (p);
+    const compression_options opts {.block_size = 10};
+
+    // The result is the same as writing all of the points at once, no
+    // matter how they arrive
+    stringstream expected;
+    write_spoc_file_compressed (expected, "Test wkt", pc, opts);
+    for (auto write_behind : {size_t (0), size_t (1), size_t (3), size_t (1000)})
+    {
+        stringstream s;
+        compressed_writer w (s, "Test wkt", extra_fields, opts, write_behind);
+        for (size_t i = 0; i < 15; ++i)
+            w.write (p[i]);
+        w.write (spoc::columns::to_point_columns (spoc::point_record::point_records (p.begin () + 15, p.begin () + 500)));
+        w.write (spoc::point_record::point_records (p.begin () + 500, p.end ()));
+        VERIFY (w.get_total_points () == total_points);
+        w.close ();
+        VERIFY (s.str () == expected.str ());
+        VERIFY (w.get_header ().total_points == total_points);
+        VERIFY (!w.get_header ().streaming);
+    }
+
+    // Pipes can't be patched, so the header is marked as streaming
+    {
+    pipe_sink b;
+    ostream s (&b);
+    compressed_writer w (s, "Test wkt", extra_fields, opts);
+    w.write (pc);
+    w.close ();
+
+    stringstream t (b.str);
+    const auto h = read_header (t);
+    VERIFY (h.streaming);
+    VERIFY (h.total_points == 0);
+    VERIFY (!h.e.has_value ());
+    VERIFY (read_compressed_columns (t, h) == pc);
+
+    stringstream u (b.str);
+    VERIFY (read_spoc_file (u).get_point_records () == p);
+    stringstream v (b.str);
+    VERIFY (read_extent (v) == spoc::columns::get_extent (pc));
+    stringstream x (b.str);
+    VERIFY (read_spoc_file_if (x, [](const auto &) { return true; }).get_point_records () == p);
+    pipe_buffer c (b.str);
+    istream y (&c);
+    VERIFY (read_spoc_file (y).get_point_records () == p);
+    }
+
+    // Empty files
+    {
+    stringstream s;
+    compressed_writer w (s, "Test wkt", extra_fields, opts);
+    w.close ();
+    const auto h = read_header (s);
+    VERIFY (h.total_points == 0);
+    VERIFY (h.extra_fields == extra_fields);
+    VERIFY (read_compressed_columns (s, h).empty ());
+    }
+
+    // Closing twice does nothing
+    {
+    stringstream s;
+    compressed_writer w (s, "Test wkt", extra_fields, opts);
+    w.write (p);
+    w.close ();
+    w.close ();
+    VERIFY (s.str () == expected.str ());
+    }
+
+    // Errors
+    {
+    stringstream s;
+    VERIFY_THROWS (compressed_writer w (s, "Test wkt", extra_fields, compression_options {.block_size = 0});)
+    compressed_writer w (s, "Test wkt", extra_fields, opts);
+    VERIFY_THROWS (w.write (spoc::point_record::point_record (extra_fields + 1));)
+    VERIFY_THROWS (w.write (spoc::columns::point_columns (1, extra_fields + 1));)
+    }
+}
+
+void test_streaming_records ()
+{
+    const size_t total_points = 1000;
+    const size_t extra_fields = 2;
+    const auto p = generate_random_point_records (total_points, extra_fields);
+    const auto pc = spoc::columns::to_point_columns (p);
+
+    // Write the records in frames of different sizes
+    header h ("Test wkt", extra_fields, 0, false);
+    h.streaming = true;
+    stringstream s;
+    write_header (s, h);
+    {
+    point_record_writer w (s, h);
+    for (size_t i = 0; i < p.size (); ++i)
+    {
+        w.write (p[i]);
+        if (i % 37 == 0)
+            w.flush ();
+    }
+    w.close ();
+    w.close ();
+    }
+    const auto str = s.str ();
+
+    // Whole files
+    {
+    stringstream t (str);
+    const auto f = read_spoc_file (t);
+    VERIFY (f.get_point_records () == p);
+    VERIFY (t.peek () == char_traits<char>::eof ());
+    }
+    {
+    stringstream t (str);
+    VERIFY (read_spoc_file_uncompressed (t).get_point_records () == p);
+    }
+    {
+    stringstream t (str);
+    const auto g = read_header (t);
+    VERIFY (g.streaming);
+    VERIFY (read_point_columns (t, g, spoc::columns::field_mask::all ()) == pc);
+    }
+    {
+    pipe_buffer b (str);
+    istream t (&b);
+    VERIFY (read_spoc_file (t).get_point_records () == p);
+    }
+
+    // One at a time
+    {
+    stringstream t (str);
+    point_record_reader r (t, read_header (t));
+    spoc::point_record::point_record q;
+    spoc::point_record::point_records qs;
+    while (r.read (q))
+        qs.push_back (q);
+    VERIFY (qs == p);
+    VERIFY (!r.read (q));
+    }
+
+    // In chunks that don't line up with the frames
+    {
+    stringstream t (str);
+    point_record_reader r (t, read_header (t));
+    spoc::columns::point_columns qc (0, extra_fields);
+    for (auto c = r.read_columns (100); !c.empty (); c = r.read_columns (100))
+    {
+        VERIFY (c.size () <= 100);
+        spoc::columns::append (qc, c);
+    }
+    VERIFY (qc == pc);
+    }
+
+    // Files that know their size read the same way
+    {
+    stringstream t;
+    write_spoc_file_uncompressed (t, spoc_file ("Test wkt", false, p));
+    point_record_reader r (t, read_header (t));
+    VERIFY (r.read_columns (100).size () == 100);
+    VERIFY (r.read_columns ().size () == total_points - 100);
+    VERIFY (r.read_columns ().empty ());
+    }
+
+    // The end marker is required
+    {
+    stringstream t (str.substr (0, str.size () - sizeof(uint64_t)));
+    VERIFY_THROWS (read_spoc_file (t);)
+    }
+
+    // Streaming files can't be mapped
+    {
+    const string fn ("test_io_streaming.spoc");
+    {
+    ofstream ofs (fn, ios::binary);
+    ofs << str;
+    }
+    VERIFY_THROWS (mapped_spoc_file f (fn);)
+    std::filesystem::remove (fn);
+    }
+}
+
+void test_point_columns_reader ()
+{
+    const size_t total_points = 1000;
+    const size_t extra_fields = 2;
+    const auto p = generate_random_point_records (total_points, extra_fields);
+    const auto pc = spoc::columns::to_point_columns (p);
+
+    // Compressed and uncompressed files give the same chunks
+    for (auto compressed : {false, true})
+    {
+        stringstream s;
+        write_spoc_file (s, spoc_file ("Test wkt", compressed, p), compression_options {.block_size = 10});
+        point_columns_reader r (s, read_header (s), 64);
+        VERIFY (r.get_header ().compressed == compressed);
+        spoc::columns::point_columns qc (0, extra_fields);
+        for (auto c = r.read (); !c.empty (); c = r.read ())
+        {
+            VERIFY (compressed || c.size () <= 64);
+            spoc::columns::append (qc, c);
+        }
+        VERIFY (qc == pc);
+        VERIFY (r.read ().empty ());
+    }
+
+    // Unselected fields are zero
+    {
+    stringstream s;
+    write_spoc_file (s, spoc_file ("Test wkt", false, p));
+    point_columns_reader r (s, read_header (s), 64, spoc::columns::field_mask {"x"});
+    const auto c = r.read ();
+    VERIFY (c.size () == 64);
+    VERIFY (c.x[0] == p[0].x);
+    VERIFY (c.y[0] == 0);
+    }
+}
+
+void test_point_record_writer_columns ()
+{
+    const auto p = generate_random_point_records (1000, 3);
+    stringstream s1, s2;
+    {
+    point_record_writer w (s1, 3, flush_policy::block, 1000);
+    w.write (p);
+    }
+    {
+    point_record_writer w (s2, 3, flush_policy::block, 1000);
+    w.write (spoc::columns::to_point_columns (p));
+    VERIFY_THROWS (w.write (spoc::columns::point_columns (1, 2));)
+    }
+    VERIFY (s1.str () == s2.str ());
+}
+
+void test_compressed_v1 ()
+{
+    // Files written with minor version 1 store each field as one
+    // compressed stream
+    const size_t total_points = 1000;
+    const size_t extra_fields = 2;
+    auto p = generate_random_point_records (total_points, extra_fields);
+    for (auto &i : p)
+        i.g = 0;
+    const auto pc = spoc::columns::to_point_columns (p);
+
+    stringstream s;
+    write_header (s, header (spoc::MAJOR_VERSION, 1, "Test wkt", extra_fields, total_points, true));
+    for (size_t j = 0; j < spoc::columns::FIXED_FIELDS + extra_fields; ++j)
+    {
+        spoc::columns::visit_column (pc, j, [&](const auto &v)
+        {
+            const bool zero = all_of (v.begin (), v.end (), [](auto x) { return x == 0; });
+            const auto c = zero
+                ? vector<uint8_t> ()
+                : spoc::compression::compress (reinterpret_cast<const uint8_t *> (v.data ()), v.size () * sizeof(v[0]));
+            const uint64_t n = c.size ();
+            s.write (reinterpret_cast<const char *> (&n), sizeof(uint64_t));
+            s.write (reinterpret_cast<const char *> (c.data ()), n);
+        });
+    }
+
+    const auto f = read_spoc_file (s);
+    VERIFY (f.get_point_records () == p);
+
+    // Projected
+    s.seekg (0);
+    const auto g = read_spoc_file (s, spoc::columns::field_mask {"y", "e1"});
+    const auto qc = spoc::columns::to_point_columns (g.get_point_records ());
+    VERIFY (qc.y == pc.y);
+    VERIFY (qc.extra[1] == pc.extra[1]);
+    VERIFY (all_of (qc.x.begin (), qc.x.end (), [](double x) { return x == 0.0; }));
+    VERIFY (all_of (qc.extra[0].begin (), qc.extra[0].end (), [](uint64_t x) { return x == 0; }));
+
+    // The header doesn't have the extent, so the points are scanned
+    s.clear ();
+    s.seekg (0);
+    VERIFY (read_extent (s) == spoc::extent::get_extent (p));
+}
+
+void test_header_extent ()
+{
+    const size_t total_points = 1000;
+    const size_t extra_fields = 2;
+    const auto p = generate_random_point_records (total_points, extra_fields);
+    const auto e = spoc::extent::get_extent (p);
+
+    // The writers store the extent
+    for (auto compressed : {false, true})
+    {
+        stringstream s;
+        write_spoc_file (s, spoc_file ("Test wkt", compressed, p));
+        const auto str = s.str ();
+        stringstream t (str);
+        const auto h = read_header (t);
+        VERIFY (h.e.has_value ());
+        VERIFY (*h.e == e);
+        VERIFY (read_point_columns (t, h) == spoc::columns::to_point_columns (p));
+        stringstream u (str);
+        VERIFY (read_extent (u) == e);
+    }
+
+    // From columns
+    {
+    stringstream s;
+    write_spoc_file_compressed (s, "Test wkt", spoc::columns::to_point_columns (p));
+    VERIFY (read_header (s).e == e);
+    }
+
+    // An empty file doesn't have one
+    for (auto compressed : {false, true})
+    {
+        stringstream s;
+        write_spoc_file (s, spoc_file ("Test wkt", compressed));
+        VERIFY (!read_header (s).e.has_value ());
+    }
+
+    // Nor does an empty file from the block writer
+    {
+    stringstream s;
+    compressed_writer w (s, "Test wkt", extra_fields);
+    w.close ();
+    const auto h = read_header (s);
+    VERIFY (!h.e.has_value ());
+    VERIFY (h.total_points == 0);
+    VERIFY (read_point_columns (s, h).empty ());
+    }
+
+    // NaN and infinite coordinates are left out of the extent, and
+    // every writer stores the same one
+    {
+    auto q = p;
+    q[10].x = numeric_limits<double>::quiet_NaN ();
+    q[20].y = numeric_limits<double>::infinity ();
+    q[30].z = -numeric_limits<double>::infinity ();
+    const auto f = spoc::extent::get_finite_extent (q);
+    VERIFY (isfinite (f.minp.x) && isfinite (f.maxp.x));
+    VERIFY (isfinite (f.minp.y) && isfinite (f.maxp.y));
+    VERIFY (isfinite (f.minp.z) && isfinite (f.maxp.z));
+    VERIFY (f == spoc::columns::get_finite_extent (spoc::columns::to_point_columns (q)));
+
+    vector<spoc::header::header> hs;
+    for (auto compressed : {false, true})
+    {
+        stringstream s;
+        write_spoc_file (s, spoc_file ("Test wkt", compressed, q));
+        hs.push_back (read_header (s));
+    }
+    {
+    stringstream s;
+    compressed_writer w (s, "Test wkt", extra_fields, compression_options {.block_size = 64});
+    w.write (q);
+    w.close ();
+    hs.push_back (read_header (s));
+    }
+    for (const auto &h : hs)
+    {
+        VERIFY (h.e.has_value ());
+        VERIFY (*h.e == f);
+    }
+
+    // An axis without finite coordinates is unbounded
+    for (auto &i : q)
+        i.z = numeric_limits<double>::quiet_NaN ();
+    stringstream s;
+    compressed_writer w (s, "Test wkt", extra_fields, compression_options {.block_size = 64});
+    w.write (q);
+    w.close ();
+    const auto h = read_header (s);
+    VERIFY (h.e->minp.x == f.minp.x && h.e->maxp.y == f.maxp.y);
+    VERIFY (h.e->minp.z == -numeric_limits<double>::infinity ());
+    VERIFY (h.e->maxp.z == numeric_limits<double>::infinity ());
+    }
+}
+
+void test_projection ()
+{
+    const size_t total_points = 1000;
+    const size_t extra_fields = 3;
+    const auto p = generate_random_point_records (total_points, extra_fields);
+    const auto pc = spoc::columns::to_point_columns (p);
+
+    const vector<spoc::columns::field_mask> masks {
+        spoc::columns::field_mask (),
+        spoc::columns::field_mask {"c"},
+        spoc::columns::field_mask {"x", "y", "z"},
+        spoc::columns::field_mask {"b", "e2"},
+        spoc::columns::field_mask {"extra"},
+        spoc::columns::field_mask::all ()};
+
+    for (auto compressed : {false, true})
+    for (const auto &m : masks)
+    {
+        // The expected values
+        auto expected = pc;
+        spoc::columns::clear_unselected (expected, m);
+
+        stringstream s;
+        write_spoc_file (s, spoc_file ("Test wkt", compressed, p), compression_options {.block_size = 300});
+
+        // Seekable
+        const auto f = read_spoc_file (s, m);
+        VERIFY (f.get_header ().total_points == total_points);
+        VERIFY (f.get_header ().extra_fields == extra_fields);
+        VERIFY (spoc::columns::to_point_columns (f.get_point_records ()) == expected);
+
+        // Not seekable
+        pipe_buffer b (s.str ());
+        istream t (&b);
+        const auto h = read_header (t);
+        VERIFY (read_point_columns (t, h, m) == expected);
+    }
+
+    // Truncated in a skipped field
+    {
+    stringstream s;
+    write_spoc_file (s, spoc_file ("Test wkt", true, p));
+    auto str = s.str ();
+    str.resize (str.size () - 2000);
+    stringstream t (str);
+    VERIFY_THROWS (read_spoc_file (t, spoc::columns::field_mask {"x"});)
+    pipe_buffer b (str);
+    istream u (&b);
+    VERIFY_THROWS (read_spoc_file (u, spoc::columns::field_mask {"x"});)
+    }
+}
+
+void test_block_predicates ()
+{
+    // Points sorted by x, with one class per block
+    const size_t total_points = 1000;
+    const size_t block_size = 100;
+    auto p = generate_random_point_records (total_points, 1);
+    for (size_t i = 0; i < p.size (); ++i)
+    {
+        p[i].x = i;
+        p[i].c = i / block_size;
+    }
+
+    stringstream s;
+    write_spoc_file_compressed (s, spoc_file ("Test wkt", true, p), compression_options {.block_size = block_size});
+
+    const auto keep_class = [](const spoc::stats::block_stats &b)
+        { return spoc::stats::may_contain_class (b, 3); };
+
+    // Seekable
+    {
+    stringstream t (s.str ());
+    const auto f = read_spoc_file_if (t, keep_class);
+    const auto &q = f.get_point_records ();
+    VERIFY (q.size () == block_size);
+    VERIFY (q.front () == p[300]);
+    VERIFY (q.back () == p[399]);
+    // The stream is consumed
+    VERIFY (t.tellg () == streampos (s.str ().size ()));
+    }
+
+    // Not seekable
+    {
+    pipe_buffer b (s.str ());
+    istream t (&b);
+    const auto f = read_spoc_file_if (t, keep_class);
+    VERIFY (f.get_point_records ().size () == block_size);
+    VERIFY (f.get_point_records ().front () == p[300]);
+    }
+
+    // Nothing
+    {
+    stringstream t (s.str ());
+    const auto f = read_spoc_file_if (t, [](const spoc::stats::block_stats &) { return false; });
+    VERIFY (f.get_point_records ().empty ());
+    }
+
+    // Crop
+    {
+    stringstream t (s.str ());
+    auto e = spoc::extent::get_extent (p);
+    e.minp.x = 250.5;
+    e.maxp.x = 420;
+    const auto f = read_cropped_spoc_file (t, e);
+    const auto &q = f.get_point_records ();
+    VERIFY (q.size () == 170);
+    VERIFY (q.front () == p[251]);
+    VERIFY (q.back () == p[420]);
+    }
+
+    // Uncompressed files don't have statistics
+    {
+    stringstream t;
+    write_spoc_file_uncompressed (t, spoc_file ("Test wkt", false, p));
+    const auto f = read_spoc_file_if (t, keep_class);
+    VERIFY (f.get_point_records () == p);
+    }
+
+    // Neither do version 0.2 files
+    {
+    const auto str = s.str ();
+    stringstream t (str);
+    auto h = read_header (t);
+    const auto pos = t.tellg ();
+    const auto d = read_block_directory (t, h);
+    // Rewrite the directory without statistics
+    t.seekg (pos);
+    const auto bs = read_compressed_blocks (t, h);
+    stringstream u;
+    h.minor_version = 2;
+    write_header (u, h);
+    uint64_t offset = sizeof(uint64_t);
+    u.write (reinterpret_cast<const char *> (&block_size), sizeof(uint64_t));
+    for (const auto &b : bs)
+        offset += write_compressed_block (u, b);
+    offset += write_block_end_marker (u);
+    const uint64_t n = d.size ();
+    u.write (reinterpret_cast<const char *> (&n), sizeof(uint64_t));
+    for (const auto &e : d)
+    {
+        u.write (reinterpret_cast<const char *> (&e.offset), sizeof(uint64_t));
+        u.write (reinterpret_cast<const char *> (&e.total_points), sizeof(uint64_t));
+    }
+    u.write (reinterpret_cast<const char *> (&offset), sizeof(uint64_t));
+
+    stringstream v (u.str ());
+    VERIFY (read_spoc_file (v).get_point_records () == p);
+    stringstream w (u.str ());
+    VERIFY (read_spoc_file_if (w, keep_class).get_point_records () == p);
+    stringstream x (u.str ());
+    h = read_header (x);
+    VERIFY (!read_block_directory (x, h).front ().stats.has_value ());
+    }
+}
+
 void test_field_name ()
 {
     string s = "e100";
@@ -160,6 +1145,18 @@ int main (int argc, char **argv)
     {
         test_spoc_file_io ();
         test_spoc_file_compressed_io ();
+        test_compressed_blocks ();
+        test_block_reader ();
+        test_compressed_writer ();
+        test_compressed_v1 ();
+        test_header_extent ();
+        test_projection ();
+        test_block_predicates ();
+        test_point_record_writer ();
+        test_streaming_records ();
+        test_point_columns_reader ();
+        test_point_record_writer_columns ();
+        test_mapped_spoc_file ();
         test_field_name ();
         return 0;
     }
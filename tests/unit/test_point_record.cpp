@@ -91,6 +91,34 @@ void test_point_record_fields ()
     }
 }
 
+void test_point_record_inline_extra ()
+{
+    // Small numbers of extra fields do not use the heap
+    const point_record p (INLINE_EXTRA_FIELDS);
+    VERIFY (p.extra.is_inline ());
+
+    // Larger numbers of extra fields still work
+    point_record q (INLINE_EXTRA_FIELDS + 1);
+    VERIFY (!q.extra.is_inline ());
+    q.extra.back () = 123;
+    const auto r (q);
+    VERIFY (r == q);
+    VERIFY (r.extra.back () == 123);
+
+    // Records can still be written and read back
+    const auto prs = generate_random_point_records (10, INLINE_EXTRA_FIELDS + 3);
+    stringstream s;
+    for (const auto &i : prs)
+        write_point_record (s, i);
+    for (const auto &i : prs)
+        VERIFY (read_point_record (s, INLINE_EXTRA_FIELDS + 3) == i);
+
+    // Construct from a std::vector
+    const vector<uint64_t> e {1, 2, 3};
+    const point_record t (1, 2, 3, 4, 5, 6, 7, 8, 9, e);
+    VERIFY (t.extra == e);
+}
+
 void test_point_record_hash ()
 {
     unordered_set<point_record,point_record_hash> s;
@@ -184,6 +212,7 @@ int main (int argc, char **argv)
     {
         test_point_record_ctors ();
         test_point_record_fields ();
+        test_point_record_inline_extra ();
         test_point_record_hash ();
         test_point_record_hash_load ();
         test_point_record_all_zero ();
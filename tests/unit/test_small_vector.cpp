@@ -0,0 +1,169 @@
+#include "spoc/small_vector.h"
+#include "spoc/test_utils.h"
+#include <iostream>
+#include <numeric>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+using namespace std;
+using namespace spoc::small_vector;
+
+using SV = small_vector<uint64_t, 4>;
+
+void test_small_vector_ctors ()
+{
+    {
+    SV v;
+    VERIFY (v.empty ());
+    VERIFY (v.size () == 0);
+    VERIFY (v.is_inline ());
+    VERIFY (v.capacity () == SV::inline_capacity ());
+    }
+
+    {
+    SV v (3);
+    VERIFY (v.size () == 3);
+    VERIFY (v.is_inline ());
+    for (auto i : v)
+        VERIFY (i == 0);
+    }
+
+    {
+    SV v (10, 7);
+    VERIFY (v.size () == 10);
+    VERIFY (!v.is_inline ());
+    for (auto i : v)
+        VERIFY (i == 7);
+    }
+
+    {
+    SV v {1, 2, 3};
+    VERIFY (v.size () == 3);
+    VERIFY (v[0] == 1);
+    VERIFY (v.back () == 3);
+    }
+
+    {
+    const vector<uint64_t> x {1, 2, 3, 4, 5, 6};
+    SV v (x);
+    VERIFY (v == x);
+    VERIFY (v.to_vector () == x);
+    SV w;
+    w = x;
+    VERIFY (w == v);
+    }
+}
+
+void test_small_vector_copy_move ()
+{
+    for (auto n : {0, 2, 4, 5, 100})
+    {
+        SV v (n);
+        iota (v.begin (), v.end (), 100);
+
+        // Copy
+        SV w (v);
+        VERIFY (w == v);
+        if (n != 0)
+        {
+            w[0] = 0;
+            VERIFY (w != v);
+        }
+
+        // Copy assign
+        w = v;
+        VERIFY (w == v);
+        w = w; // cppcheck-suppress selfAssignment
+        VERIFY (w == v);
+
+        // Move
+        SV x (std::move (w));
+        VERIFY (x == v);
+        VERIFY (w.empty ()); // cppcheck-suppress accessMoved
+
+        // Move assign
+        SV y {1, 2, 3, 4, 5, 6, 7};
+        y = std::move (x);
+        VERIFY (y == v);
+
+        // Swap
+        SV z {9};
+        z.swap (y);
+        VERIFY (z == v);
+        VERIFY (y.size () == 1);
+        VERIFY (y[0] == 9);
+    }
+}
+
+void test_small_vector_resize ()
+{
+    SV v;
+    for (size_t i = 0; i < 20; ++i)
+    {
+        v.push_back (i);
+        VERIFY (v.size () == i + 1);
+        VERIFY (v.is_inline () == (v.size () <= SV::inline_capacity ()));
+    }
+    for (size_t i = 0; i < v.size (); ++i)
+        VERIFY (v[i] == i);
+
+    // Shrinking keeps the values
+    v.resize (3);
+    VERIFY (v.size () == 3);
+    VERIFY (v[2] == 2);
+
+    // Growing zero fills
+    v.resize (6);
+    VERIFY (v[5] == 0);
+
+    v.pop_back ();
+    VERIFY (v.size () == 5);
+    v.clear ();
+    VERIFY (v.empty ());
+
+    v.reserve (100);
+    VERIFY (v.capacity () >= 100);
+}
+
+void test_small_vector_self_insert ()
+{
+    // Fill the heap storage
+    SV v;
+    for (size_t i = 0; v.size () <= SV::inline_capacity () || v.size () < v.capacity (); ++i)
+        v.push_back (i + 100);
+    VERIFY (!v.is_inline ());
+    VERIFY (v.size () == v.capacity ());
+
+    // Insert one of its own elements, which moves the storage
+    const size_t n = v.size ();
+    v.push_back (v[0]);
+    VERIFY (v.size () == n + 1);
+    VERIFY (v[n] == 100);
+
+    // And again when resizing
+    while (v.size () < v.capacity ())
+        v.push_back (0);
+    const size_t m = v.size ();
+    v.resize (m + 10, v[1]);
+    VERIFY (v.size () == m + 10);
+    for (size_t i = m; i < v.size (); ++i)
+        VERIFY (v[i] == 101);
+}
+
+int main (int argc, char **argv)
+{
+    try
+    {
+        test_small_vector_ctors ();
+        test_small_vector_copy_move ();
+        test_small_vector_resize ();
+        test_small_vector_self_insert ();
+        return 0;
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what () << endl;
+        return -1;
+    }
+}
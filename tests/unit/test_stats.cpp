@@ -0,0 +1,104 @@
+#include "spoc/stats.h"
+#include "spoc/test_utils.h"
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+using namespace spoc::columns;
+using namespace spoc::stats;
+using namespace spoc::test_utils;
+
+void test_block_stats ()
+{
+    const size_t extra_fields = 2;
+    auto pc = to_point_columns (generate_random_point_records (1000, extra_fields));
+    for (size_t i = 0; i < pc.size (); ++i)
+    {
+        pc.c[i] = i % 10;
+        pc.extra[1][i] = 1000 + i;
+    }
+
+    const auto s = get_block_stats (pc, 100, 200);
+    VERIFY (s.e.minp.x == *min_element (pc.x.begin () + 100, pc.x.begin () + 300));
+    VERIFY (s.e.maxp.z == *max_element (pc.z.begin () + 100, pc.z.begin () + 300));
+    VERIFY (s.min.size () == INTEGER_FIELDS + extra_fields);
+    VERIFY (s.min[0] == 0);
+    VERIFY (s.max[0] == 9);
+    VERIFY (s.min[INTEGER_FIELDS + 1] == 1100);
+    VERIFY (s.max[INTEGER_FIELDS + 1] == 1299);
+    VERIFY (s.classes.count () == 10);
+
+    // Classes
+    VERIFY (may_contain_class (s, 9));
+    VERIFY (!may_contain_class (s, 10));
+    VERIFY (!may_contain_class (s, 1000));
+    VERIFY (may_contain_any_class (s, unordered_set<int> {-1, 3}));
+    VERIFY (!may_contain_any_class (s, unordered_set<int> {-1, 11, 12}));
+    VERIFY (contains_only_classes (s, vector<int> {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10}));
+    VERIFY (!contains_only_classes (s, vector<int> {0, 1, 2, 3, 4, 5, 6, 7, 8}));
+
+    // Large classes are covered by the range
+    pc.c[150] = 1000;
+    const auto t = get_block_stats (pc, 100, 200);
+    VERIFY (may_contain_class (t, 1000));
+    VERIFY (!may_contain_class (t, 1001));
+    VERIFY (!contains_only_classes (t, vector<int> {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 1000}));
+
+    // Extents
+    VERIFY (may_intersect (s, s.e));
+    auto e = s.e;
+    e.minp.x = s.e.maxp.x + 1.0;
+    e.maxp.x = s.e.maxp.x + 2.0;
+    VERIFY (!may_intersect (s, e));
+
+    // A NaN can't be excluded
+    pc.y[120] = numeric_limits<double>::quiet_NaN ();
+    const auto u = get_block_stats (pc, 100, 200);
+    VERIFY (isinf (u.e.minp.y) && u.e.minp.y < 0);
+    VERIFY (isinf (u.e.maxp.y) && u.e.maxp.y > 0);
+    VERIFY (u.e.minp.x == s.e.minp.x);
+}
+
+void test_block_stats_io ()
+{
+    for (auto extra_fields : {0, 3})
+    {
+        auto pc = to_point_columns (generate_random_point_records (100, extra_fields));
+        pc.c[5] = 255;
+        pc.c[6] = 17;
+        const auto s = get_block_stats (pc, 0, pc.size ());
+        stringstream ss;
+        write_block_stats (ss, s);
+        VERIFY (ss.str ().size () == get_stats_bytes (extra_fields));
+        const auto t = read_block_stats (ss, extra_fields);
+        VERIFY (s == t);
+        VERIFY (t.classes.test (255));
+        VERIFY (t.classes.test (17));
+
+        // Truncated
+        auto str = ss.str ();
+        str.pop_back ();
+        stringstream u (str);
+        VERIFY_THROWS (read_block_stats (u, extra_fields);)
+    }
+}
+
+int main (int argc, char **argv)
+{
+    try
+    {
+        test_block_stats ();
+        test_block_stats_io ();
+        return 0;
+    }
+    catch (const exception &e)
+    {
+        cerr << e.what () << endl;
+        return -1;
+    }
+}
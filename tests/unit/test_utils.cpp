@@ -5,6 +5,7 @@
 #include <sstream>
 #include <stdexcept>
 #include <unordered_set>
+#include <vector>
 
 using namespace std;
 using namespace spoc::utils;
@@ -62,6 +63,59 @@ void test_quantize ()
     quantize (q, 1.0);
 }
 
+void test_parallel_for ()
+{
+    vector<int> x (1000);
+    parallel_for (x.size (), [&](const size_t i) { x[i] = i; });
+    for (size_t i = 0; i < x.size (); ++i)
+        VERIFY (x[i] == static_cast<int> (i));
+
+    // Exceptions get passed back to the caller
+    VERIFY_THROWS (parallel_for (x.size (), [&](const size_t i)
+        { if (i == 500) throw runtime_error ("test"); });)
+
+    // Nothing to do
+    parallel_for (0, [&](const size_t) { VERIFY (false); });
+}
+
+void test_counter_rng ()
+{
+    const counter_rng a (123);
+    const counter_rng b (123);
+    const counter_rng c (124);
+    const counter_rng d (123, 1);
+
+    // The same seed and stream give the same numbers in any order
+    VERIFY (a (10) == b (10));
+    VERIFY (a (5) == b (5));
+    VERIFY (a (10) != a (11));
+    VERIFY (a (10) != c (10));
+    VERIFY (a (10) != d (10));
+
+    // Check the distributions
+    const size_t n = 100000;
+    double sum = 0.0;
+    double sum2 = 0.0;
+    double umin = 1.0;
+    double umax = 0.0;
+    double usum = 0.0;
+    for (size_t i = 0; i < n; ++i)
+    {
+        const double g = a.gaussian (i);
+        sum += g;
+        sum2 += g * g;
+        const double u = a.uniform (i);
+        VERIFY (u >= 0.0 && u < 1.0);
+        umin = std::min (umin, u);
+        umax = std::max (umax, u);
+        usum += u;
+    }
+    VERIFY (std::fabs (sum / n) < 0.02);
+    VERIFY (std::fabs (sum2 / n - 1.0) < 0.02);
+    VERIFY (umin < 0.001 && umax > 0.999);
+    VERIFY (std::fabs (usum / n - 0.5) < 0.01);
+}
+
 int main (int argc, char **argv)
 {
     try
@@ -73,6 +127,8 @@ int main (int argc, char **argv)
         test_hash_combine<float> ();
         test_hash_combine<double> ();
         test_quantize ();
+        test_parallel_for ();
+        test_counter_rng ();
         return 0;
     }
     catch (const exception &e)